@@ -0,0 +1,988 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+// Build-time tool that writes the packages, AppImages, installers and AppStream catalogue the benchmarks analyse.
+// Usage: fixturegenerator <output directory> <payload size> <metainfo count> <catalogue size>
+//
+// The output only depends on the arguments: timestamps are zero and filler data comes from a fixed seed,
+// so results from different builds measure the same work.
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QList>
+#include <QSaveFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <tuple>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+const QByteArray APP_ID = "org.example.BenchmarkApp";
+const QByteArray PACKAGE_NAME = "benchmark-app";
+
+struct PackageFile {
+    // The path without a leading "/" or "./", e.g. "usr/share/metainfo/org.example.BenchmarkApp.metainfo.xml".
+    QByteArray path;
+    QByteArray data;
+};
+
+// Bytes that look random enough not to compress away, like a real executable's, from a fixed seed.
+QByteArray fillerData(qint64 size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    quint32 state = 0x2545f491;
+    for (char &byte : data) {
+        state = state * 1664525u + 1013904223u;
+        byte = char(state >> 24);
+    }
+    return data;
+}
+
+QByteArray gzip(const QByteArray &data)
+{
+    z_stream stream = {};
+    // A window size of 15 plus 16 asks for a gzip header, which zlib leaves without a timestamp.
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+    }
+
+    QByteArray compressed(deflateBound(&stream, data.size()), Qt::Uninitialized);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+    stream.avail_out = compressed.size();
+    const int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END ? compressed : QByteArray();
+}
+
+QByteArray metainfo(const QByteArray &id, const QByteArray &name)
+{
+    // Descriptions, screenshots and releases make up most of a real metainfo file, and the parser has to get past them.
+    QByteArray xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<component type=\"desktop-application\">\n";
+    xml += "  <id>" + id + "</id>\n  <metadata_license>CC0-1.0</metadata_license>\n";
+    for (const char *lang : {"de", "es", "fr", "it", "ja", "nl", "pl", "pt_BR", "ru", "zh_CN"}) {
+        xml += "  <name xml:lang=\"" + QByteArray(lang) + "\">" + name + " (" + lang + ")</name>\n";
+    }
+    xml += "  <name>" + name + "</name>\n  <summary>Measures how long analysis takes</summary>\n  <description>\n";
+    for (int i = 0; i < 20; ++i) {
+        xml += "    <p>Paragraph " + QByteArray::number(i) + " of a long description that nobody needs for matching.</p>\n";
+    }
+    xml += "  </description>\n  <releases>\n";
+    for (int i = 0; i < 50; ++i) {
+        xml += "    <release version=\"1." + QByteArray::number(i) + "\" date=\"2025-01-01\"><description><p>Fixes.</p></description></release>\n";
+    }
+    xml += "  </releases>\n  <launchable type=\"desktop-id\">" + id + ".desktop</launchable>\n</component>\n";
+    return xml;
+}
+
+// The files of the benchmark package, in the order package builders usually write them: the big executable first,
+// so reading the metainfo means getting past it.
+QList<PackageFile> packageFiles(qint64 payloadSize, int metainfoCount)
+{
+    QList<PackageFile> files;
+    files.append({"usr/bin/" + PACKAGE_NAME, fillerData(payloadSize)});
+    files.append({"usr/share/applications/" + APP_ID + ".desktop",
+                  "[Desktop Entry]\nType=Application\nName=Benchmark App\nExec=" + PACKAGE_NAME + " %U\nIcon=" + APP_ID + "\n"});
+
+    // The first metainfo file is the application, and the rest are add-ons shipped alongside it.
+    for (int i = 0; i < metainfoCount; ++i) {
+        const QByteArray id = i == 0 ? APP_ID : APP_ID + ".Plugin" + QByteArray::number(i);
+        const QByteArray name = i == 0 ? QByteArray("Benchmark App") : "Benchmark Plugin " + QByteArray::number(i);
+        files.append({"usr/share/metainfo/" + id + ".metainfo.xml", metainfo(id, name)});
+    }
+    return files;
+}
+
+QByteArray octal(qint64 value, int width)
+{
+    return QByteArray::number(value, 8).rightJustified(width - 1, '0') + '\0';
+}
+
+QByteArray tarArchive(const QList<PackageFile> &files)
+{
+    QByteArray archive;
+    for (const PackageFile &file : files) {
+        QByteArray header(512, '\0');
+        const QByteArray path = "./" + file.path;
+        header.replace(0, path.size(), path);
+        header.replace(100, 8, octal(0644, 8));
+        header.replace(108, 8, octal(0, 8));
+        header.replace(116, 8, octal(0, 8));
+        header.replace(124, 12, octal(file.data.size(), 12));
+        header.replace(136, 12, octal(0, 12));
+        header[156] = '0';
+        header.replace(257, 8, QByteArray("ustar\0" "00", 8));
+
+        // The checksum is calculated with its own field filled with spaces.
+        header.replace(148, 8, QByteArray(8, ' '));
+        quint32 checksum = 0;
+        for (const char c : std::as_const(header)) {
+            checksum += quint8(c);
+        }
+        header.replace(148, 8, QByteArray::number(checksum, 8).rightJustified(6, '0') + QByteArray("\0 ", 2));
+
+        archive += header;
+        archive += file.data;
+        archive += QByteArray((512 - file.data.size() % 512) % 512, '\0');
+    }
+    archive += QByteArray(1024, '\0');
+    return archive;
+}
+
+QByteArray cpioArchive(const QList<PackageFile> &files)
+{
+    QByteArray archive;
+    const auto appendMember = [&archive](const QByteArray &path, const QByteArray &data, quint32 inode, quint32 mode) {
+        const QList<quint32> fields = {inode, mode, 0, 0, 1, 0, quint32(data.size()), 0, 0, 0, 0, quint32(path.size() + 1), 0};
+        archive += "070701";
+        for (const quint32 field : fields) {
+            archive += QByteArray::number(field, 16).rightJustified(8, '0');
+        }
+        archive += path + '\0';
+        archive += QByteArray((4 - archive.size() % 4) % 4, '\0');
+        archive += data;
+        archive += QByteArray((4 - archive.size() % 4) % 4, '\0');
+    };
+
+    quint32 inode = 1;
+    for (const PackageFile &file : files) {
+        appendMember("./" + file.path, file.data, inode++, 0100644);
+    }
+    appendMember("TRAILER!!!", QByteArray(), 0, 0);
+    return archive;
+}
+
+QByteArray arMember(const QByteArray &name, const QByteArray &data)
+{
+    QByteArray header = name.leftJustified(16, ' ');
+    header += QByteArray("0").leftJustified(12, ' ');
+    header += QByteArray("0").leftJustified(6, ' ');
+    header += QByteArray("0").leftJustified(6, ' ');
+    header += QByteArray("100644").leftJustified(8, ' ');
+    header += QByteArray::number(data.size()).leftJustified(10, ' ');
+    header += "`\n";
+    return header + data + (data.size() % 2 ? "\n" : "");
+}
+
+QByteArray debPackage(const QList<PackageFile> &files)
+{
+    QByteArray md5sums;
+    for (const PackageFile &file : files) {
+        md5sums += QCryptographicHash::hash(file.data, QCryptographicHash::Md5).toHex() + "  " + file.path + '\n';
+    }
+
+    const QByteArray control = "Package: " + PACKAGE_NAME
+        + "\nVersion: 1.0\nArchitecture: amd64\nSection: utils\nMaintainer: Benchmark <benchmark@example.org>\n"
+          "Description: Measures how long analysis takes\n Long description.\n";
+    const QByteArray controlArchive = gzip(tarArchive({{"control", control}, {"md5sums", md5sums}}));
+
+    return "!<arch>\n" + arMember("debian-binary", "2.0\n") + arMember("control.tar.gz", controlArchive) + arMember("data.tar.gz", gzip(tarArchive(files)));
+}
+
+// Writes a header structure: its intro, index entries and data store.
+QByteArray rpmHeader(const QList<std::tuple<quint32, quint32, quint32, QByteArray>> &tags)
+{
+    QByteArray index;
+    QByteArray store;
+    for (const auto &[tag, type, count, data] : tags) {
+        // Integers are aligned to their size within the store.
+        if (type == 4) {
+            store += QByteArray((4 - store.size() % 4) % 4, '\0');
+        }
+
+        char entry[16];
+        qToBigEndian<quint32>(tag, entry);
+        qToBigEndian<quint32>(type, entry + 4);
+        qToBigEndian<quint32>(store.size(), entry + 8);
+        qToBigEndian<quint32>(count, entry + 12);
+        index.append(entry, sizeof(entry));
+        store += data;
+    }
+
+    char intro[16] = {char(0x8e), char(0xad), char(0xe8), 0x01, 0, 0, 0, 0};
+    qToBigEndian<quint32>(tags.size(), intro + 8);
+    qToBigEndian<quint32>(store.size(), intro + 12);
+    return QByteArray(intro, sizeof(intro)) + index + store;
+}
+
+QByteArray rpmPackage(const QList<PackageFile> &files)
+{
+    QStringList directories;
+    QByteArray baseNames;
+    QByteArray dirIndexes;
+    for (const PackageFile &file : files) {
+        const qsizetype slash = file.path.lastIndexOf('/');
+        const QString directory = u'/' + QString::fromUtf8(file.path.first(slash + 1));
+        if (!directories.contains(directory)) {
+            directories.append(directory);
+        }
+        baseNames += file.path.sliced(slash + 1) + '\0';
+
+        char dirIndex[4];
+        qToBigEndian<quint32>(directories.indexOf(directory), dirIndex);
+        dirIndexes.append(dirIndex, sizeof(dirIndex));
+    }
+
+    QByteArray dirNames;
+    for (const QString &directory : std::as_const(directories)) {
+        dirNames += directory.toUtf8() + '\0';
+    }
+
+    // RPMTAG_NAME, RPMTAG_DIRINDEXES, RPMTAG_BASENAMES, RPMTAG_DIRNAMES, RPMTAG_PAYLOADFORMAT and RPMTAG_PAYLOADCOMPRESSOR.
+    const QByteArray header = rpmHeader({
+        {1000, 6, 1, PACKAGE_NAME + '\0'},
+        {1116, 4, quint32(files.size()), dirIndexes},
+        {1117, 8, quint32(files.size()), baseNames},
+        {1118, 8, quint32(directories.size()), dirNames},
+        {1124, 6, 1, QByteArrayLiteral("cpio\0")},
+        {1125, 6, 1, QByteArrayLiteral("gzip\0")},
+    });
+
+    // The lead is obsolete, but still has to be there.
+    QByteArray lead(96, '\0');
+    lead.replace(0, 4, "\xed\xab\xee\xdb");
+    lead[4] = 3;
+    lead[9] = 1;
+    lead.replace(10, PACKAGE_NAME.size(), PACKAGE_NAME);
+    lead[77] = 1;
+    lead[79] = 5;
+
+    // An empty signature header, which needs no padding.
+    return lead + rpmHeader({}) + header + gzip(cpioArchive(files));
+}
+
+// A VS_VERSIONINFO node: its header, key and value, followed by its children.
+QByteArray versionBlock(const QString &key, const QByteArray &value, quint16 valueLength, quint16 type, const QList<QByteArray> &children = {})
+{
+    QByteArray block(6, '\0');
+    block.append(reinterpret_cast<const char *>(key.utf16()), (key.size() + 1) * 2);
+    block += QByteArray((4 - block.size() % 4) % 4, '\0');
+    block += value;
+    for (const QByteArray &child : children) {
+        block += QByteArray((4 - block.size() % 4) % 4, '\0');
+        block += child;
+    }
+
+    qToLittleEndian<quint16>(block.size(), block.data());
+    qToLittleEndian<quint16>(valueLength, block.data() + 2);
+    qToLittleEndian<quint16>(type, block.data() + 4);
+    return block;
+}
+
+QByteArray versionString(const QString &key, const QString &value)
+{
+    const QByteArray text(reinterpret_cast<const char *>(value.utf16()), (value.size() + 1) * 2);
+    return versionBlock(key, text, value.size() + 1, 1);
+}
+
+// A PE32 executable whose only section holds a version resource, with `overlaySize` bytes appended like an installer's payload.
+QByteArray peExecutable(const QString &productName, const QString &companyName, qint64 overlaySize)
+{
+    constexpr quint32 PE_OFFSET = 0x40;
+    constexpr quint32 OPTIONAL_HEADER_SIZE = 224;
+    constexpr quint32 SECTION_OFFSET = 0x200;
+    constexpr quint32 SECTION_RVA = 0x1000;
+
+    QByteArray fixedFileInfo(52, '\0');
+    qToLittleEndian<quint32>(0xfeef04bd, fixedFileInfo.data());
+    const QByteArray stringTable = versionBlock(u"040904B0"_s,
+                                                QByteArray(),
+                                                0,
+                                                1,
+                                                {versionString(u"CompanyName"_s, companyName),
+                                                 versionString(u"ProductName"_s, productName),
+                                                 versionString(u"ProductVersion"_s, u"1.0"_s)});
+    const QByteArray versionInfo = versionBlock(u"VS_VERSION_INFO"_s, fixedFileInfo, 52, 0, {versionBlock(u"StringFileInfo"_s, QByteArray(), 0, 1, {stringTable})});
+
+    // The resource tree: RT_VERSION, then resource 1, then US English, then the data entry describing versionInfo.
+    QByteArray resources(0x58, '\0');
+    const auto writeDirectory = [&resources](quint32 offset, quint32 id, quint32 target) {
+        qToLittleEndian<quint16>(1, resources.data() + offset + 14);
+        qToLittleEndian<quint32>(id, resources.data() + offset + 16);
+        qToLittleEndian<quint32>(target, resources.data() + offset + 20);
+    };
+    writeDirectory(0x00, 16, 0x80000000 | 0x18);
+    writeDirectory(0x18, 1, 0x80000000 | 0x30);
+    writeDirectory(0x30, 0x409, 0x48);
+    qToLittleEndian<quint32>(SECTION_RVA + resources.size(), resources.data() + 0x48);
+    qToLittleEndian<quint32>(versionInfo.size(), resources.data() + 0x4c);
+    resources += versionInfo;
+
+    QByteArray image(SECTION_OFFSET, '\0');
+    image.replace(0, 2, "MZ");
+    qToLittleEndian<quint32>(PE_OFFSET, image.data() + 0x3c);
+    image.replace(PE_OFFSET, 4, QByteArray("PE\0\0", 4));
+
+    char *coffHeader = image.data() + PE_OFFSET + 4;
+    qToLittleEndian<quint16>(0x14c, coffHeader);
+    qToLittleEndian<quint16>(1, coffHeader + 2);
+    qToLittleEndian<quint16>(OPTIONAL_HEADER_SIZE, coffHeader + 16);
+    qToLittleEndian<quint16>(0x0102, coffHeader + 18);
+
+    char *optionalHeader = coffHeader + 20;
+    qToLittleEndian<quint16>(0x10b, optionalHeader);
+    qToLittleEndian<quint32>(16, optionalHeader + 92);
+    qToLittleEndian<quint32>(SECTION_RVA, optionalHeader + 96 + 2 * 8);
+    qToLittleEndian<quint32>(resources.size(), optionalHeader + 96 + 2 * 8 + 4);
+
+    char *section = optionalHeader + OPTIONAL_HEADER_SIZE;
+    memcpy(section, ".rsrc", 5);
+    qToLittleEndian<quint32>(resources.size(), section + 8);
+    qToLittleEndian<quint32>(SECTION_RVA, section + 12);
+    qToLittleEndian<quint32>(resources.size(), section + 16);
+    qToLittleEndian<quint32>(SECTION_OFFSET, section + 20);
+
+    return image + resources + fillerData(overlaySize);
+}
+
+// Packs a stream name the way Windows Installer does, two characters to a code point. See MsiPropertyReader.
+QString msiStreamName(const QByteArray &name, bool isTable)
+{
+    static constexpr char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz._";
+    const auto indexOf = [](char c) {
+        return char16_t(strchr(alphabet, c) - alphabet);
+    };
+
+    QString packed = isTable ? QString(QChar(0x4840)) : QString();
+    for (qsizetype i = 0; i < name.size(); i += 2) {
+        if (i + 1 < name.size()) {
+            packed += QChar(char16_t(0x3800 + indexOf(name.at(i)) + (indexOf(name.at(i + 1)) << 6)));
+        } else {
+            packed += QChar(char16_t(0x4800 + indexOf(name.at(i))));
+        }
+    }
+    return packed;
+}
+
+// A Windows Installer package: a version 3 compound file whose Property table names the product, with a cabinet
+// stream of `cabinetSize` bytes. The tables are small enough to live in the mini stream, and a big enough cabinet
+// needs more FAT sectors than the header lists, so the DIFAT chain is read too.
+QByteArray msiPackage(const QString &productName, const QString &manufacturer, qint64 cabinetSize)
+{
+    constexpr qsizetype SECTOR_SIZE = 512;
+    constexpr qsizetype MINI_SECTOR_SIZE = 64;
+    constexpr quint32 MINI_STREAM_CUTOFF = 4096;
+    constexpr quint32 ENTRIES_PER_SECTOR = SECTOR_SIZE / 4;
+    constexpr quint32 HEADER_DIFAT_ENTRIES = 109;
+    constexpr quint32 DIFAT_SECTOR = 0xfffffffc;
+    constexpr quint32 FAT_SECTOR = 0xfffffffd;
+    constexpr quint32 END_OF_CHAIN = 0xfffffffe;
+    constexpr quint32 FREE_SECTOR = 0xffffffff;
+
+    // The string pool holds the length of each string after the codepage, and the string data holds the strings.
+    const QStringList strings = {u"ProductName"_s, productName, u"Manufacturer"_s, manufacturer, u"ProductVersion"_s, u"130.0"_s};
+    QByteArray pool(4, '\0');
+    qToLittleEndian<quint16>(1252, pool.data());
+    QByteArray stringData;
+    for (const QString &string : strings) {
+        const QByteArray latin1 = string.toLatin1();
+        QByteArray entry(4, '\0');
+        qToLittleEndian<quint16>(latin1.size(), entry.data());
+        qToLittleEndian<quint16>(1, entry.data() + 2);
+        pool += entry;
+        stringData += latin1;
+    }
+
+    // The Property table is stored a column at a time, as string IDs: the properties, then their values.
+    QByteArray properties(strings.size() * 2, '\0');
+    const qsizetype rowCount = strings.size() / 2;
+    for (qsizetype row = 0; row < rowCount; ++row) {
+        qToLittleEndian<quint16>(row * 2 + 1, properties.data() + row * 2);
+        qToLittleEndian<quint16>(row * 2 + 2, properties.data() + (rowCount + row) * 2);
+    }
+
+    struct Stream {
+        QString name;
+        QByteArray data;
+        quint32 startSector = END_OF_CHAIN;
+    };
+    QList<Stream> streams = {
+        {msiStreamName("_StringPool", true), pool},
+        {msiStreamName("_StringData", true), stringData},
+        {msiStreamName("Property", true), properties},
+        {msiStreamName("Data1.cab", false), fillerData(cabinetSize)},
+    };
+
+    QList<QByteArray> sectors;
+    QList<quint32> fat;
+    const auto appendChain = [&sectors, &fat](const QByteArray &data) {
+        if (data.isEmpty()) {
+            return END_OF_CHAIN;
+        }
+        const quint32 start = sectors.size();
+        for (qsizetype offset = 0; offset < data.size(); offset += SECTOR_SIZE) {
+            const QByteArray sector = data.mid(offset, SECTOR_SIZE);
+            sectors.append(sector + QByteArray(SECTOR_SIZE - sector.size(), '\0'));
+            fat.append(sectors.size());
+        }
+        fat.last() = END_OF_CHAIN;
+        return start;
+    };
+
+    // Small streams go in the mini stream, in 64 byte sectors chained by the mini FAT.
+    QByteArray miniStream;
+    QByteArray miniFat;
+    for (Stream &stream : streams) {
+        if (stream.data.size() >= MINI_STREAM_CUTOFF) {
+            stream.startSector = appendChain(stream.data);
+            continue;
+        }
+        stream.startSector = miniStream.size() / MINI_SECTOR_SIZE;
+        for (qsizetype offset = 0; offset < stream.data.size(); offset += MINI_SECTOR_SIZE) {
+            const QByteArray miniSector = stream.data.mid(offset, MINI_SECTOR_SIZE);
+            miniStream += miniSector + QByteArray(MINI_SECTOR_SIZE - miniSector.size(), '\0');
+            QByteArray next(4, '\0');
+            qToLittleEndian<quint32>(offset + MINI_SECTOR_SIZE < stream.data.size() ? miniStream.size() / MINI_SECTOR_SIZE : END_OF_CHAIN, next.data());
+            miniFat += next;
+        }
+    }
+    const quint32 miniStreamStart = appendChain(miniStream);
+    miniFat += QByteArray((SECTOR_SIZE - miniFat.size() % SECTOR_SIZE) % SECTOR_SIZE, '\xff');
+    const quint32 miniFatStart = appendChain(miniFat);
+
+    // The directory: the root entry, whose stream is the mini stream, with the streams chained as its children.
+    // The reader lists the entries rather than searching them, so they aren't balanced into a red-black tree.
+    const auto directoryEntry = [](const QString &name, quint8 type, quint32 rightSibling, quint32 child, quint32 startSector, quint64 size) {
+        QByteArray entry(128, '\0');
+        memcpy(entry.data(), name.utf16(), name.size() * 2);
+        qToLittleEndian<quint16>((name.size() + 1) * 2, entry.data() + 0x40);
+        entry[0x42] = char(type);
+        entry[0x43] = 1;
+        qToLittleEndian<quint32>(FREE_SECTOR, entry.data() + 0x44);
+        qToLittleEndian<quint32>(rightSibling, entry.data() + 0x48);
+        qToLittleEndian<quint32>(child, entry.data() + 0x4c);
+        qToLittleEndian<quint32>(startSector, entry.data() + 0x74);
+        qToLittleEndian<quint64>(size, entry.data() + 0x78);
+        return entry;
+    };
+    QByteArray directory = directoryEntry(u"Root Entry"_s, 5, FREE_SECTOR, 1, miniStreamStart, miniStream.size());
+    for (qsizetype i = 0; i < streams.size(); ++i) {
+        const quint32 rightSibling = i + 1 < streams.size() ? quint32(i + 2) : FREE_SECTOR;
+        directory += directoryEntry(streams.at(i).name, 2, rightSibling, FREE_SECTOR, streams.at(i).startSector, streams.at(i).data.size());
+    }
+    directory += QByteArray((SECTOR_SIZE - directory.size() % SECTOR_SIZE) % SECTOR_SIZE, '\0');
+    const quint32 directoryStart = appendChain(directory);
+
+    // The FAT covers its own sectors and the DIFAT's, so keep growing both until they cover everything.
+    quint32 fatSectorCount = 0;
+    quint32 difatSectorCount = 0;
+    for (;;) {
+        const quint32 sectorCount = sectors.size() + fatSectorCount + difatSectorCount;
+        const quint32 neededFatSectors = (sectorCount + ENTRIES_PER_SECTOR - 1) / ENTRIES_PER_SECTOR;
+        const quint32 neededDifatSectors =
+            neededFatSectors > HEADER_DIFAT_ENTRIES ? (neededFatSectors - HEADER_DIFAT_ENTRIES + ENTRIES_PER_SECTOR - 2) / (ENTRIES_PER_SECTOR - 1) : 0;
+        if (neededFatSectors == fatSectorCount && neededDifatSectors == difatSectorCount) {
+            break;
+        }
+        fatSectorCount = neededFatSectors;
+        difatSectorCount = neededDifatSectors;
+    }
+
+    const quint32 fatStart = sectors.size();
+    const quint32 difatStart = fatStart + fatSectorCount;
+    fat += QList<quint32>(fatSectorCount, FAT_SECTOR);
+    fat += QList<quint32>(difatSectorCount, DIFAT_SECTOR);
+    fat += QList<quint32>(fatSectorCount * ENTRIES_PER_SECTOR - fat.size(), FREE_SECTOR);
+
+    QByteArray fatData(fat.size() * 4, '\0');
+    for (qsizetype i = 0; i < fat.size(); ++i) {
+        qToLittleEndian<quint32>(fat.at(i), fatData.data() + i * 4);
+    }
+
+    // The FAT sectors past the first 109 are listed in the DIFAT sectors, each of which ends with the next one.
+    QByteArray difat(difatSectorCount * SECTOR_SIZE, '\xff');
+    for (quint32 i = HEADER_DIFAT_ENTRIES; i < fatSectorCount; ++i) {
+        const quint32 position = i - HEADER_DIFAT_ENTRIES;
+        qToLittleEndian<quint32>(fatStart + i, difat.data() + (position / (ENTRIES_PER_SECTOR - 1) * ENTRIES_PER_SECTOR + position % (ENTRIES_PER_SECTOR - 1)) * 4);
+    }
+    for (quint32 i = 0; i < difatSectorCount; ++i) {
+        qToLittleEndian<quint32>(i + 1 < difatSectorCount ? difatStart + i + 1 : END_OF_CHAIN, difat.data() + (i + 1) * SECTOR_SIZE - 4);
+    }
+
+    QByteArray header(SECTOR_SIZE, '\0');
+    header.replace(0, 8, QByteArray("\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1", 8));
+    qToLittleEndian<quint16>(0x3e, header.data() + 0x18);
+    qToLittleEndian<quint16>(3, header.data() + 0x1a);
+    qToLittleEndian<quint16>(0xfffe, header.data() + 0x1c);
+    qToLittleEndian<quint16>(9, header.data() + 0x1e);
+    qToLittleEndian<quint16>(6, header.data() + 0x20);
+    qToLittleEndian<quint32>(fatSectorCount, header.data() + 0x2c);
+    qToLittleEndian<quint32>(directoryStart, header.data() + 0x30);
+    qToLittleEndian<quint32>(MINI_STREAM_CUTOFF, header.data() + 0x38);
+    qToLittleEndian<quint32>(miniFatStart, header.data() + 0x3c);
+    qToLittleEndian<quint32>(miniFat.size() / SECTOR_SIZE, header.data() + 0x40);
+    qToLittleEndian<quint32>(difatSectorCount > 0 ? difatStart : END_OF_CHAIN, header.data() + 0x44);
+    qToLittleEndian<quint32>(difatSectorCount, header.data() + 0x48);
+    for (quint32 i = 0; i < HEADER_DIFAT_ENTRIES; ++i) {
+        qToLittleEndian<quint32>(i < fatSectorCount ? fatStart + i : FREE_SECTOR, header.data() + 0x4c + i * 4);
+    }
+
+    return header + sectors.join() + fatData + difat;
+}
+
+enum SquashFsCompressor : quint16 {
+    SquashFsGzip = 1,
+    SquashFsZstd = 6,
+};
+
+// Compresses a SquashFS block: "gzip" images hold zlib streams, and zstd images hold zstd frames.
+QByteArray squashFsCompress(const QByteArray &data, SquashFsCompressor compressor)
+{
+    if (compressor == SquashFsZstd) {
+        QByteArray compressed(ZSTD_compressBound(data.size()), Qt::Uninitialized);
+        const size_t size = ZSTD_compress(compressed.data(), compressed.size(), data.constData(), data.size(), ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(size)) {
+            return QByteArray();
+        }
+        compressed.resize(size);
+        return compressed;
+    }
+
+    uLongf size = compressBound(data.size());
+    QByteArray compressed(size, Qt::Uninitialized);
+    if (compress2(reinterpret_cast<Bytef *>(compressed.data()), &size, reinterpret_cast<const Bytef *>(data.constData()), data.size(), Z_DEFAULT_COMPRESSION)
+        != Z_OK) {
+        return QByteArray();
+    }
+    compressed.resize(size);
+    return compressed;
+}
+
+// Writes a SquashFS metadata table: a run of blocks of up to 8 KiB, each compressed on its own.
+class MetadataWriter
+{
+public:
+    explicit MetadataWriter(SquashFsCompressor compressor)
+        : m_compressor(compressor)
+    {
+    }
+
+    // Where the next byte written goes: the position of its block within the table, and its offset in the block.
+    quint32 block() const
+    {
+        return m_table.size();
+    }
+    quint16 offset() const
+    {
+        return m_pending.size();
+    }
+    quint64 reference() const
+    {
+        return (quint64(block()) << 16) | offset();
+    }
+
+    void write(const QByteArray &data)
+    {
+        m_pending += data;
+        while (m_pending.size() >= BLOCK_SIZE) {
+            flushBlock(BLOCK_SIZE);
+        }
+    }
+
+    // The positions of the blocks within the table, once finished.
+    QList<quint32> blockPositions() const
+    {
+        return m_blockPositions;
+    }
+
+    QByteArray finish()
+    {
+        if (!m_pending.isEmpty()) {
+            flushBlock(m_pending.size());
+        }
+        return m_table;
+    }
+
+private:
+    static constexpr qsizetype BLOCK_SIZE = 8192;
+
+    // Blocks that don't get smaller are stored as they are, with the top bit of their size set.
+    void flushBlock(qsizetype size)
+    {
+        const QByteArray block = m_pending.first(size);
+        const QByteArray compressed = squashFsCompress(block, m_compressor);
+        const bool useCompressed = !compressed.isEmpty() && compressed.size() < block.size();
+        QByteArray header(2, '\0');
+        qToLittleEndian<quint16>(useCompressed ? compressed.size() : block.size() | 0x8000, header.data());
+
+        m_blockPositions.append(m_table.size());
+        m_table += header + (useCompressed ? compressed : block);
+        m_pending.remove(0, size);
+    }
+
+    SquashFsCompressor m_compressor;
+    QByteArray m_table;
+    QByteArray m_pending;
+    QList<quint32> m_blockPositions;
+};
+
+// A stand-in for the AppImage runtime: `size` bytes of ELF executable whose section header table ends where the
+// SquashFS image starts, which is how the runtime finds its image.
+QByteArray elfRuntime(qint64 size)
+{
+    constexpr qint64 SECTION_HEADER_SIZE = 64;
+
+    QByteArray runtime = fillerData(size - SECTION_HEADER_SIZE) + QByteArray(SECTION_HEADER_SIZE, '\0');
+    QByteArray header(64, '\0');
+    // A little-endian 64-bit ELF file, marked as a type 2 AppImage in the padding of its identification.
+    header.replace(0, 11, QByteArray("\x7f" "ELF\x02\x01\x01\0AI\x02", 11));
+    qToLittleEndian<quint16>(2, header.data() + 0x10);
+    qToLittleEndian<quint16>(0x3e, header.data() + 0x12);
+    qToLittleEndian<quint32>(1, header.data() + 0x14);
+    qToLittleEndian<quint64>(size - SECTION_HEADER_SIZE, header.data() + 0x28);
+    qToLittleEndian<quint16>(64, header.data() + 0x34);
+    qToLittleEndian<quint16>(SECTION_HEADER_SIZE, header.data() + 0x3a);
+    qToLittleEndian<quint16>(1, header.data() + 0x3c);
+    runtime.replace(0, header.size(), header);
+    return runtime;
+}
+
+// An AppImage of the benchmark package's files: the runtime followed by a SquashFS image of its AppDir, which has a
+// desktop file at the root linking to the application's, as AppImage tools make it.
+// The image uses the smallest block size SquashFS allows, so the metainfo files are a data block each with their tail
+// in a fragment, and the desktop file is only a fragment.
+QByteArray appImage(const QList<PackageFile> &files, SquashFsCompressor compressor)
+{
+    constexpr quint32 BLOCK_SIZE = 4096;
+    constexpr quint16 BLOCK_LOG = 12;
+    constexpr quint32 DATA_BLOCK_UNCOMPRESSED = 1 << 24;
+    constexpr quint32 NO_FRAGMENT = 0xffffffff;
+    constexpr quint64 NO_TABLE = 0xffffffffffffffff;
+    constexpr quint16 DIRECTORY_INODE = 1;
+    constexpr quint16 FILE_INODE = 2;
+    constexpr quint16 SYMLINK_INODE = 3;
+
+    struct Node {
+        QByteArray name;
+        quint16 type = DIRECTORY_INODE;
+        // A file's contents, or a link's target.
+        QByteArray data;
+        QList<qsizetype> children;
+        qsizetype parent = -1;
+        quint32 inodeNumber = 0;
+
+        quint32 blocksStart = 0;
+        QList<quint32> blockSizes;
+        quint32 fragment = NO_FRAGMENT;
+        quint32 fragmentOffset = 0;
+        quint64 inodeReference = 0;
+    };
+
+    QList<Node> nodes = {Node()};
+    const auto addNode = [&nodes](const QByteArray &path, quint16 type, const QByteArray &data) {
+        const QList<QByteArray> components = path.split('/');
+        qsizetype parent = 0;
+        for (qsizetype i = 0; i < components.size(); ++i) {
+            const bool isLast = i == components.size() - 1;
+            const auto existing = std::find_if(nodes.at(parent).children.cbegin(), nodes.at(parent).children.cend(), [&](qsizetype child) {
+                return nodes.at(child).name == components.at(i);
+            });
+            if (existing != nodes.at(parent).children.cend() && !isLast) {
+                parent = *existing;
+                continue;
+            }
+
+            Node node;
+            node.name = components.at(i);
+            node.parent = parent;
+            if (isLast) {
+                node.type = type;
+                node.data = data;
+            }
+            nodes.append(node);
+            nodes[parent].children.append(nodes.size() - 1);
+            parent = nodes.size() - 1;
+        }
+    };
+    for (const PackageFile &file : files) {
+        addNode(file.path, FILE_INODE, file.data);
+    }
+    addNode("AppRun", SYMLINK_INODE, "usr/bin/" + PACKAGE_NAME);
+    addNode(APP_ID + ".desktop", SYMLINK_INODE, "usr/share/applications/" + APP_ID + ".desktop");
+
+    // Directory listings are sorted by name.
+    for (Node &node : nodes) {
+        std::sort(node.children.begin(), node.children.end(), [&nodes](qsizetype a, qsizetype b) {
+            return nodes.at(a).name < nodes.at(b).name;
+        });
+    }
+    for (qsizetype i = 0; i < nodes.size(); ++i) {
+        nodes[i].inodeNumber = i + 1;
+    }
+
+    QByteArray image(96, '\0');
+
+    // The files' full blocks go in the data area. Their tails are packed together into fragments.
+    struct Fragment {
+        quint64 start;
+        quint32 size;
+    };
+    QList<Fragment> fragments;
+    QByteArray pendingFragment;
+    const auto appendBlock = [&image, compressor](const QByteArray &block) -> quint32 {
+        const QByteArray compressed = squashFsCompress(block, compressor);
+        if (!compressed.isEmpty() && compressed.size() < block.size()) {
+            image += compressed;
+            return compressed.size();
+        }
+        image += block;
+        return block.size() | DATA_BLOCK_UNCOMPRESSED;
+    };
+    const auto flushFragment = [&]() {
+        if (!pendingFragment.isEmpty()) {
+            const quint64 start = image.size();
+            fragments.append({start, appendBlock(pendingFragment)});
+            pendingFragment.clear();
+        }
+    };
+    for (Node &node : nodes) {
+        if (node.type != FILE_INODE) {
+            continue;
+        }
+        node.blocksStart = image.size();
+        const qsizetype fullBlocksSize = node.data.size() - node.data.size() % BLOCK_SIZE;
+        for (qsizetype offset = 0; offset < fullBlocksSize; offset += BLOCK_SIZE) {
+            node.blockSizes.append(appendBlock(node.data.sliced(offset, BLOCK_SIZE)));
+        }
+
+        const QByteArray tail = node.data.sliced(fullBlocksSize);
+        if (tail.isEmpty()) {
+            continue;
+        }
+        if (pendingFragment.size() + tail.size() > BLOCK_SIZE) {
+            flushFragment();
+        }
+        node.fragment = fragments.size();
+        node.fragmentOffset = pendingFragment.size();
+        pendingFragment += tail;
+    }
+    flushFragment();
+
+    // Inodes are written after their directory's children, so every listing can point at inodes already written.
+    MetadataWriter inodeTable(compressor);
+    MetadataWriter directoryTable(compressor);
+    const auto inodeHeader = [](quint16 type, quint16 permissions, quint32 inodeNumber) {
+        QByteArray header(16, '\0');
+        qToLittleEndian<quint16>(type, header.data());
+        qToLittleEndian<quint16>(permissions, header.data() + 2);
+        qToLittleEndian<quint32>(inodeNumber, header.data() + 12);
+        return header;
+    };
+    const std::function<void(qsizetype)> writeInode = [&](qsizetype index) {
+        Node &node = nodes[index];
+        QByteArray inode;
+        if (node.type == FILE_INODE) {
+            inode = inodeHeader(FILE_INODE, node.name == PACKAGE_NAME ? 0755 : 0644, node.inodeNumber) + QByteArray(16, '\0');
+            qToLittleEndian<quint32>(node.blocksStart, inode.data() + 16);
+            qToLittleEndian<quint32>(node.fragment, inode.data() + 20);
+            qToLittleEndian<quint32>(node.fragmentOffset, inode.data() + 24);
+            qToLittleEndian<quint32>(node.data.size(), inode.data() + 28);
+            for (const quint32 blockSize : std::as_const(node.blockSizes)) {
+                QByteArray field(4, '\0');
+                qToLittleEndian<quint32>(blockSize, field.data());
+                inode += field;
+            }
+        } else if (node.type == SYMLINK_INODE) {
+            inode = inodeHeader(SYMLINK_INODE, 0777, node.inodeNumber) + QByteArray(8, '\0');
+            qToLittleEndian<quint32>(1, inode.data() + 16);
+            qToLittleEndian<quint32>(node.data.size(), inode.data() + 20);
+            inode += node.data;
+        } else {
+            quint32 subdirectoryCount = 0;
+            for (const qsizetype child : std::as_const(node.children)) {
+                writeInode(child);
+                subdirectoryCount += nodes.at(child).type == DIRECTORY_INODE;
+            }
+
+            // Each run of up to 256 entries whose inodes start in the same metadata block gets a header.
+            const quint32 listingBlock = directoryTable.block();
+            const quint16 listingOffset = directoryTable.offset();
+            QByteArray listing;
+            for (qsizetype first = 0; first < node.children.size();) {
+                const Node &firstChild = nodes.at(node.children.at(first));
+                qsizetype last = first;
+                while (last + 1 < node.children.size() && last + 1 - first < 256
+                       && nodes.at(node.children.at(last + 1)).inodeReference >> 16 == firstChild.inodeReference >> 16) {
+                    ++last;
+                }
+
+                QByteArray header(12, '\0');
+                qToLittleEndian<quint32>(last - first, header.data());
+                qToLittleEndian<quint32>(firstChild.inodeReference >> 16, header.data() + 4);
+                qToLittleEndian<quint32>(firstChild.inodeNumber, header.data() + 8);
+                listing += header;
+                for (qsizetype i = first; i <= last; ++i) {
+                    const Node &child = nodes.at(node.children.at(i));
+                    QByteArray entry(8, '\0');
+                    qToLittleEndian<quint16>(child.inodeReference & 0xffff, entry.data());
+                    qToLittleEndian<qint16>(child.inodeNumber - firstChild.inodeNumber, entry.data() + 2);
+                    qToLittleEndian<quint16>(child.type, entry.data() + 4);
+                    qToLittleEndian<quint16>(child.name.size() - 1, entry.data() + 6);
+                    listing += entry + child.name;
+                }
+                first = last + 1;
+            }
+            directoryTable.write(listing);
+
+            // The listing size counts three bytes for the implicit "." and ".." entries.
+            inode = inodeHeader(DIRECTORY_INODE, 0755, node.inodeNumber) + QByteArray(16, '\0');
+            qToLittleEndian<quint32>(listingBlock, inode.data() + 16);
+            qToLittleEndian<quint32>(2 + subdirectoryCount, inode.data() + 20);
+            qToLittleEndian<quint16>(listing.size() + 3, inode.data() + 24);
+            qToLittleEndian<quint16>(listingOffset, inode.data() + 26);
+            qToLittleEndian<quint32>(node.parent >= 0 ? nodes.at(node.parent).inodeNumber : nodes.size() + 1, inode.data() + 28);
+        }
+
+        node.inodeReference = inodeTable.reference();
+        inodeTable.write(inode);
+    };
+    writeInode(0);
+
+    const quint64 inodeTableStart = image.size();
+    image += inodeTable.finish();
+    const quint64 directoryTableStart = image.size();
+    image += directoryTable.finish();
+
+    // The fragment and ID tables are metadata followed by a list of where each of their metadata blocks is.
+    const auto appendLookupTable = [&image, compressor](const QByteArray &entries) {
+        MetadataWriter table(compressor);
+        table.write(entries);
+        const quint64 tableStart = image.size();
+        image += table.finish();
+
+        const quint64 listStart = image.size();
+        const QList<quint32> blockPositions = table.blockPositions();
+        for (const quint32 position : blockPositions) {
+            QByteArray pointer(8, '\0');
+            qToLittleEndian<quint64>(tableStart + position, pointer.data());
+            image += pointer;
+        }
+        return listStart;
+    };
+    QByteArray fragmentEntries;
+    for (const Fragment &fragment : std::as_const(fragments)) {
+        QByteArray entry(16, '\0');
+        qToLittleEndian<quint64>(fragment.start, entry.data());
+        qToLittleEndian<quint32>(fragment.size, entry.data() + 8);
+        fragmentEntries += entry;
+    }
+    const quint64 fragmentTableStart = appendLookupTable(fragmentEntries);
+    // Every file is owned by root, the only ID.
+    const quint64 idTableStart = appendLookupTable(QByteArray(4, '\0'));
+
+    char *superblock = image.data();
+    memcpy(superblock, "hsqs", 4);
+    qToLittleEndian<quint32>(nodes.size(), superblock + 4);
+    qToLittleEndian<quint32>(BLOCK_SIZE, superblock + 12);
+    qToLittleEndian<quint32>(fragments.size(), superblock + 16);
+    qToLittleEndian<quint16>(compressor, superblock + 20);
+    qToLittleEndian<quint16>(BLOCK_LOG, superblock + 22);
+    qToLittleEndian<quint16>(1, superblock + 26);
+    qToLittleEndian<quint16>(4, superblock + 28);
+    qToLittleEndian<quint64>(nodes.at(0).inodeReference, superblock + 32);
+    qToLittleEndian<quint64>(image.size(), superblock + 40);
+    qToLittleEndian<quint64>(idTableStart, superblock + 48);
+    qToLittleEndian<quint64>(NO_TABLE, superblock + 56);
+    qToLittleEndian<quint64>(inodeTableStart, superblock + 64);
+    qToLittleEndian<quint64>(directoryTableStart, superblock + 72);
+    qToLittleEndian<quint64>(fragmentTableStart, superblock + 80);
+    qToLittleEndian<quint64>(NO_TABLE, superblock + 88);
+
+    // Like mksquashfs, pad the image to a multiple of 4 KiB.
+    image += QByteArray((4096 - image.size() % 4096) % 4096, '\0');
+    return elfRuntime(128 * 1024) + image;
+}
+
+// A catalogue of `size` applications, like the one Flatpak keeps for each remote, including the benchmark app.
+QByteArray appstreamCatalogue(int size)
+{
+    static const QList<QByteArray> syllables = {"ka", "lo", "mi", "ner", "tus", "vel", "dra", "pho", "zen", "qui", "bar", "sol", "tri", "gon", "lex", "rha"};
+    const auto word = [](quint32 seed) {
+        QByteArray result;
+        for (int i = 0; i < 2 + int(seed % 3); ++i) {
+            result += syllables.at((seed >> (i * 4)) % syllables.size());
+        }
+        result[0] = char(QChar::toUpper(char32_t(result.at(0))));
+        return result;
+    };
+
+    QByteArray xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<components version=\"0.8\" origin=\"flathub\">\n";
+    quint32 state = 0x9e3779b9;
+    for (int i = 0; i < size; ++i) {
+        state = state * 1664525u + 1013904223u;
+        const QByteArray developer = word(state >> 8);
+        const QByteArray name = i == 0 ? QByteArray("Benchmark App") : word(state) + ' ' + word(state >> 12);
+        const QByteArray id = i == 0 ? APP_ID : "org." + developer.toLower() + '.' + word(state).toLower() + QByteArray::number(i);
+
+        xml += "  <component type=\"desktop-application\">\n    <id>" + id + "</id>\n    <name>" + name + "</name>\n";
+        xml += "    <name xml:lang=\"de\">" + name + "</name>\n    <summary>Does things number " + QByteArray::number(i) + "</summary>\n";
+        xml += "    <developer_name>" + developer + "</developer_name>\n";
+        xml += "    <description><p>An application generated for benchmarking.</p><p>It has a second paragraph.</p></description>\n";
+        xml += "    <icon type=\"cached\" height=\"64\" width=\"64\">" + id + ".png</icon>\n  </component>\n";
+    }
+    xml += "</components>\n";
+    return xml;
+}
+
+bool writeFile(const QString &filePath, const QByteArray &data, QTextStream &err)
+{
+    QSaveFile file(filePath);
+    if (data.isEmpty() || !file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        err << "Could not write " << filePath << ": " << file.errorString() << '\n';
+        return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    const QStringList arguments = app.arguments();
+    bool payloadSizeOk = false;
+    bool metainfoCountOk = false;
+    bool catalogueSizeOk = false;
+    const qint64 payloadSize = arguments.value(2).toLongLong(&payloadSizeOk);
+    const int metainfoCount = arguments.value(3).toInt(&metainfoCountOk);
+    const int catalogueSize = arguments.value(4).toInt(&catalogueSizeOk);
+    if (arguments.size() != 5 || !payloadSizeOk || !metainfoCountOk || !catalogueSizeOk || payloadSize < 0 || metainfoCount < 1 || catalogueSize < 1) {
+        err << "Usage: fixturegenerator <output directory> <payload size> <metainfo count> <catalogue size>\n";
+        return 1;
+    }
+
+    const QDir output(arguments.at(1));
+    if (!output.mkpath(u"."_s)) {
+        err << "Could not create " << output.path() << '\n';
+        return 1;
+    }
+
+    const QList<PackageFile> files = packageFiles(payloadSize, metainfoCount);
+    const bool written = writeFile(output.filePath(u"benchmark-app_1.0_amd64.deb"_s), debPackage(files), err)
+        && writeFile(output.filePath(u"benchmark-app-1.0-1.x86_64.rpm"_s), rpmPackage(files), err)
+        && writeFile(output.filePath(u"benchmark-app-gzip.AppImage"_s), appImage(files, SquashFsGzip), err)
+        && writeFile(output.filePath(u"benchmark-app-zstd.AppImage"_s), appImage(files, SquashFsZstd), err)
+        // Matched by its file name, and by the product name in its version resource once renamed.
+        && writeFile(output.filePath(u"Firefox Setup 130.0.exe"_s), peExecutable(u"Firefox"_s, u"Mozilla Corporation"_s, payloadSize), err)
+        && writeFile(output.filePath(u"renamed-installer.exe"_s), peExecutable(u"Firefox"_s, u"Mozilla Corporation"_s, payloadSize), err)
+        // Matched by the product name in its Property table.
+        && writeFile(output.filePath(u"renamed-installer.msi"_s), msiPackage(u"Firefox"_s, u"Mozilla"_s, payloadSize), err)
+        && writeFile(output.filePath(u"org.example.BenchmarkApp.metainfo.xml"_s), files.at(2).data, err)
+        && writeFile(output.filePath(u"appstream.xml.gz"_s), gzip(appstreamCatalogue(catalogueSize)), err);
+
+    return written ? 0 : 1;
+}
@@ -0,0 +1,321 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+// Measures the steps between opening a file and knowing what to offer for it, against the fixtures fixturegenerator writes.
+// Run with e.g. `-o results.xml,xml` for results that can be compared between builds.
+
+#include "AppDatabase.h"
+#include "AppImageCompatibilityHelper.h"
+#include "AppStreamIndex.h"
+#include "CompatibilityHelperFactory.h"
+#include "DebCompatibilityHelper.h"
+#include "MsiPropertyReader.h"
+#include "PackageUtils.h"
+#include "RpmCompatibilityHelper.h"
+#include "SquashFsReader.h"
+#include "WindowsCompatibilityHelper.h"
+
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QTest>
+
+#include <memory>
+
+namespace
+{
+const QString FIXTURES_DIR = QStringLiteral(BENCHMARK_FIXTURES_DIR);
+const QString APP_DATABASE = QStringLiteral(BENCHMARK_APP_DATABASE);
+
+QString fixturePath(const QString &fileName)
+{
+    return FIXTURES_DIR + u'/' + fileName;
+}
+
+QByteArray readFixture(const QString &fileName)
+{
+    QFile file(fixturePath(fileName));
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+// Exposes a helper's analysis, so it can be run repeatedly without the result cache answering after the first run.
+template<typename Helper>
+class UncachedHelper : public Helper
+{
+public:
+    using Helper::Helper;
+    using Helper::analyze;
+};
+}
+
+class HelperBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void create_data();
+    void create();
+
+    void analyzeDeb();
+    void analyzeRpm();
+    void analyzeAppImage_data();
+    void analyzeAppImage();
+    void analyzeWindows_data();
+    void analyzeWindows();
+
+    void matchWindowsFileNames();
+    void matchPackageNames();
+
+    void buildAppStreamIndex();
+    void lookUpAppStreamIndex_data();
+    void lookUpAppStreamIndex();
+
+    void readMetainfoComponent();
+    void readDesktopEntry();
+    void readMsiProperties();
+    void readSquashFs_data();
+    void readSquashFs();
+
+private:
+    std::shared_ptr<const AppDatabase> m_database;
+    std::unique_ptr<AppStreamIndex> m_index;
+};
+
+void HelperBenchmark::initTestCase()
+{
+    // Keep the result and index caches, and the Flatpak catalogues of the user installation, away from the real ones.
+    QStandardPaths::setTestModeEnabled(true);
+
+    // Install the fixture catalogue where Flatpak would put a remote's, so the helpers match against it.
+    const QString arch = QSysInfo::currentCpuArchitecture() == u"arm64"_s ? u"aarch64"_s : QSysInfo::currentCpuArchitecture();
+    const QString remoteDir =
+        QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + u"/flatpak/appstream/benchmark/%1/active"_s.arg(arch);
+    QVERIFY(QDir().mkpath(remoteDir));
+    QFile::remove(remoteDir + u"/appstream.xml.gz"_s);
+    QVERIFY(QFile::copy(fixturePath(u"appstream.xml.gz"_s), remoteDir + u"/appstream.xml.gz"_s));
+    QFile::remove(AppStreamIndex::cacheFilePath());
+
+    // Load both databases up front, like the analysis service does, so the benchmarks measure analysis rather than startup.
+    QVERIFY(AppStreamIndex::system()->size() > 0);
+    m_database = AppDatabase::shared({APP_DATABASE});
+    QVERIFY(m_database);
+
+    m_index = std::make_unique<AppStreamIndex>(QStringList{fixturePath(u"appstream.xml.gz"_s)});
+    QVERIFY(m_index->size() > 0);
+}
+
+void HelperBenchmark::create_data()
+{
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow("deb") << u"benchmark-app_1.0_amd64.deb"_s;
+    QTest::newRow("rpm") << u"benchmark-app-1.0-1.x86_64.rpm"_s;
+    QTest::newRow("exe") << u"renamed-installer.exe"_s;
+}
+
+void HelperBenchmark::create()
+{
+    QFETCH(QString, fileName);
+    const QUrl url = QUrl::fromLocalFile(fixturePath(fileName));
+
+    QBENCHMARK {
+        const std::unique_ptr<ICompatibilityHelper> helper(CompatibilityHelperFactory::create(url));
+        QVERIFY(helper);
+    }
+}
+
+void HelperBenchmark::analyzeDeb()
+{
+    UncachedHelper<DebCompatibilityHelper> helper(QUrl::fromLocalFile(fixturePath(u"benchmark-app_1.0_amd64.deb"_s)));
+
+    QBENCHMARK {
+        helper.analyze();
+    }
+    QVERIFY(helper.analysisResult().value(u"hasFlatpakApp"_s).toBool());
+}
+
+void HelperBenchmark::analyzeRpm()
+{
+    UncachedHelper<RpmCompatibilityHelper> helper(QUrl::fromLocalFile(fixturePath(u"benchmark-app-1.0-1.x86_64.rpm"_s)));
+
+    QBENCHMARK {
+        helper.analyze();
+    }
+    QVERIFY(helper.analysisResult().value(u"hasFlatpakApp"_s).toBool());
+}
+
+void HelperBenchmark::analyzeAppImage_data()
+{
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow("gzip") << u"benchmark-app-gzip.AppImage"_s;
+    QTest::newRow("zstd") << u"benchmark-app-zstd.AppImage"_s;
+}
+
+void HelperBenchmark::analyzeAppImage()
+{
+    QFETCH(QString, fileName);
+    UncachedHelper<AppImageCompatibilityHelper> helper(QUrl::fromLocalFile(fixturePath(fileName)));
+
+    QBENCHMARK {
+        helper.analyze();
+    }
+    QVERIFY(helper.analysisResult().value(u"hasFlatpakApp"_s).toBool());
+}
+
+void HelperBenchmark::analyzeWindows_data()
+{
+    QTest::addColumn<QString>("fileName");
+
+    // Matched by its file name alone.
+    QTest::newRow("file name") << u"Firefox Setup 130.0.exe"_s;
+    // Matched by reading the product name out of its version resource.
+    QTest::newRow("version resource") << u"renamed-installer.exe"_s;
+    // Matched by reading the product name out of its Property table.
+    QTest::newRow("property table") << u"renamed-installer.msi"_s;
+}
+
+void HelperBenchmark::analyzeWindows()
+{
+    QFETCH(QString, fileName);
+    UncachedHelper<WindowsCompatibilityHelper> helper(QStringList{APP_DATABASE}, QUrl::fromLocalFile(fixturePath(fileName)));
+
+    QBENCHMARK {
+        helper.analyze();
+    }
+    QVERIFY(helper.analysisResult().value(u"hasNativeApp"_s).toBool());
+}
+
+void HelperBenchmark::matchWindowsFileNames()
+{
+    // A mix of installers the database knows and ones it doesn't, as found in a typical Downloads folder.
+    QStringList fileNames;
+    for (int i = 0; i < 100; ++i) {
+        fileNames << u"Firefox Setup %1.0.exe"_s.arg(i) << u"ChromeSetup.exe"_s << u"DiscordSetup.exe"_s << u"setup (%1).exe"_s.arg(i)
+                  << u"unknown-installer-%1.msi"_s.arg(i);
+    }
+
+    QBENCHMARK {
+        for (const QString &fileName : std::as_const(fileNames)) {
+            m_database->matchWindowsFileName(fileName);
+        }
+    }
+}
+
+void HelperBenchmark::matchPackageNames()
+{
+    QList<QStringList> packages;
+    for (int i = 0; i < 100; ++i) {
+        packages << QStringList{u"google-chrome-stable"_s} << QStringList{u"benchmark-app"_s} << QStringList{u"codeblocks-%1"_s.arg(i)};
+    }
+
+    QBENCHMARK {
+        for (const QStringList &names : std::as_const(packages)) {
+            m_database->matchPackage(names);
+        }
+    }
+}
+
+void HelperBenchmark::buildAppStreamIndex()
+{
+    const QStringList files = {fixturePath(u"appstream.xml.gz"_s)};
+
+    QBENCHMARK {
+        AppStreamIndex index(files);
+        QVERIFY(index.size() > 0);
+    }
+}
+
+void HelperBenchmark::lookUpAppStreamIndex_data()
+{
+    QTest::addColumn<QString>("lookup");
+
+    QTest::newRow("id") << u"id"_s;
+    QTest::newRow("name") << u"name"_s;
+    QTest::newRow("id suffix") << u"suffix"_s;
+    QTest::newRow("search") << u"search"_s;
+}
+
+void HelperBenchmark::lookUpAppStreamIndex()
+{
+    QFETCH(QString, lookup);
+
+    QBENCHMARK {
+        if (lookup == u"id"_s) {
+            QVERIFY(m_index->findById(u"org.example.BenchmarkApp"_s));
+        } else if (lookup == u"name"_s) {
+            QVERIFY(m_index->findByName(u"benchmark app"_s));
+        } else if (lookup == u"suffix"_s) {
+            QVERIFY(m_index->findByIdSuffix(u"benchmarkapp"_s));
+        } else {
+            QVERIFY(!m_index->search(u"Benchmark App Pro"_s, 5, 0.5).isEmpty());
+        }
+    }
+}
+
+void HelperBenchmark::readMetainfoComponent()
+{
+    const QByteArray metainfo = readFixture(u"org.example.BenchmarkApp.metainfo.xml"_s);
+    QVERIFY(!metainfo.isEmpty());
+
+    QBENCHMARK {
+        QVERIFY(::readMetainfoComponent(metainfo));
+    }
+}
+
+void HelperBenchmark::readDesktopEntry()
+{
+    const QByteArray desktopEntry =
+        "[Desktop Entry]\nType=Application\nName=Benchmark App\nName[de]=Benchmark-App\nExec=env FOO=1 /usr/bin/benchmark-app %U\n"
+        "Icon=/usr/share/pixmaps/benchmark-app.png\nStartupWMClass=BenchmarkApp\n\n[Desktop Action new-window]\nName=New Window\nExec=benchmark-app\n";
+
+    QBENCHMARK {
+        QVERIFY(::readDesktopEntry(u"usr/share/applications/benchmark-app.desktop"_s, desktopEntry));
+    }
+}
+
+void HelperBenchmark::readMsiProperties()
+{
+    const QString filePath = fixturePath(u"renamed-installer.msi"_s);
+
+    QBENCHMARK {
+        MsiPropertyReader reader(filePath);
+        QVERIFY(reader.read());
+        QCOMPARE(reader.productName(), u"Firefox"_s);
+        QCOMPARE(reader.manufacturer(), u"Mozilla"_s);
+    }
+}
+
+void HelperBenchmark::readSquashFs_data()
+{
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow("gzip") << u"benchmark-app-gzip.AppImage"_s;
+    QTest::newRow("zstd") << u"benchmark-app-zstd.AppImage"_s;
+}
+
+void HelperBenchmark::readSquashFs()
+{
+    QFETCH(QString, fileName);
+    const QByteArray metainfo = readFixture(u"org.example.BenchmarkApp.metainfo.xml"_s);
+    QVERIFY(!metainfo.isEmpty());
+
+    QBENCHMARK {
+        SquashFsReader image(fixturePath(fileName));
+        QVERIFY(image.open());
+        QVERIFY(image.entryNames(QString()).value_or(QStringList()).contains(u"org.example.BenchmarkApp.desktop"_s));
+        QVERIFY(image.entryNames(u"usr/share/metainfo"_s).value_or(QStringList()).contains(u"org.example.BenchmarkApp.metainfo.xml"_s));
+
+        // The desktop file at the root links to the application's, which fits in a fragment.
+        QVERIFY(image.readFile(u"org.example.BenchmarkApp.desktop"_s).value_or(QByteArray()).startsWith("[Desktop Entry]"));
+        // The metainfo file is a data block with its tail in a fragment.
+        QCOMPARE(image.readFile(u"usr/share/metainfo/org.example.BenchmarkApp.metainfo.xml"_s).value_or(QByteArray()), metainfo);
+    }
+}
+
+QTEST_GUILESS_MAIN(HelperBenchmark)
+
+#include "helperbenchmark.moc"
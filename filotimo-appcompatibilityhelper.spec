@@ -17,7 +17,8 @@ BuildRequires: cmake(Qt6Gui)
 BuildRequires: cmake(Qt6Qml)
 BuildRequires: cmake(Qt6QuickControls2)
 BuildRequires: cmake(Qt6Svg)
-BuildRequires: cmake(Qt6Xml)
+BuildRequires: cmake(Qt6Concurrent)
+BuildRequires: cmake(Qt6DBus)
 BuildRequires: cmake(Qt6Widgets)
 
 BuildRequires: cmake(KF6Kirigami)
@@ -25,13 +26,14 @@ BuildRequires: cmake(KF6CoreAddons)
 BuildRequires: cmake(KF6I18n)
 BuildRequires: cmake(KF6KIO)
 
+BuildRequires: pkgconfig(zlib)
+BuildRequires: pkgconfig(bzip2)
+BuildRequires: pkgconfig(liblzma)
+BuildRequires: pkgconfig(libzstd)
+
 Requires: qt6qml(org.kde.coreaddons)
 Requires: qt6qml(org.kde.kirigami)
 Requires: qt6qml(org.kde.kirigamiaddons.formcard)
-Requires: rpm
-Requires: cpio
-Requires: binutils
-Requires: tar
 
 
 %description
@@ -57,7 +59,9 @@ desktop-file-validate %{buildroot}%{_kf6_datadir}/applications/org.filotimoproje
 %license LICENSES/*
 %{_kf6_bindir}/appcompatibilityhelper
 %{_kf6_datadir}/applications/org.filotimoproject.appcompatibilityhelper.desktop
-%{_kf6_datadir}/appcompatibilityhelper/app_db.json
+%{_kf6_datadir}/appcompatibilityhelper/app_db.bin
+%{_libexecdir}/appcompatibilityhelperd
+%{_kf6_datadir}/dbus-1/services/org.filotimoproject.appcompatibilityhelperd.service
 
 %changelog
 * Mon Sep 29 2025 Thomas Duckworth <tduck@filotimoproject.org> 0.13-1
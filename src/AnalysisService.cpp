@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "AnalysisService.h"
+#include "CompatibilityHelperFactory.h"
+#include "ResultCache.h"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDebug>
+#include <QDir>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+AnalysisService::AnalysisService(QObject *parent)
+    : QObject(parent)
+{
+    m_workers.setExpiryTimeout(-1);
+
+    // Nothing is lost by quitting, as D-Bus starts the daemon again on the next request.
+    m_idleTimer.setInterval(5min);
+    m_idleTimer.setSingleShot(true);
+    connect(&m_idleTimer, &QTimer::timeout, qApp, &QCoreApplication::quit);
+    m_idleTimer.start();
+}
+
+bool AnalysisService::registerService()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.registerObject(ANALYSIS_SERVICE_PATH, this, QDBusConnection::ExportAllSlots)) {
+        qWarning() << "Could not register the analysis service object:" << bus.lastError().message();
+        return false;
+    }
+    if (!bus.registerService(ANALYSIS_SERVICE_NAME)) {
+        qWarning() << "Could not register the analysis service:" << bus.lastError().message();
+        return false;
+    }
+    return true;
+}
+
+QVariantMap AnalysisService::Analyze(const QString &path, const QDBusMessage &message)
+{
+    // The daemon's working directory has nothing to do with the caller's.
+    if (!QDir::isAbsolutePath(path)) {
+        QDBusConnection::sessionBus().send(message.createErrorReply(QDBusError::InvalidArgs, u"The path must be absolute."_s));
+        return QVariantMap();
+    }
+
+    message.setDelayedReply(true);
+    ++m_pendingRequests;
+    m_idleTimer.stop();
+
+    auto *watcher = new QFutureWatcher<QVariantMap>(this);
+    connect(watcher, &QFutureWatcher<QVariantMap>::finished, this, [this, watcher, message]() {
+        QDBusConnection::sessionBus().send(message.createReply(QVariant(watcher->result())));
+        watcher->deleteLater();
+
+        if (--m_pendingRequests == 0) {
+            m_idleTimer.start();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(&m_workers, [path]() {
+        const QVariantMap result = CompatibilityHelperFactory::analyzeFile(path);
+        // Save as we go, so nothing is lost if the session ends before the daemon quits.
+        ResultCache::instance().save();
+        return result;
+    }));
+
+    return QVariantMap();
+}
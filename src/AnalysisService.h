@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QDBusMessage>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantMap>
+
+using namespace Qt::Literals::StringLiterals;
+
+#define ANALYSIS_SERVICE_NAME u"org.filotimoproject.appcompatibilityhelperd"_s
+#define ANALYSIS_SERVICE_PATH u"/Analyzer"_s
+#define ANALYSIS_SERVICE_INTERFACE u"org.filotimoproject.appcompatibilityhelper.Analyzer"_s
+
+// The D-Bus interface of appcompatibilityhelperd, which analyses files on behalf of the GUI.
+//
+// The daemon keeps the application database, the AppStream index and KSycoca loaded between requests, so only the
+// first file it's asked about pays for loading them. It's started by D-Bus activation and quits once it has been
+// idle for a while.
+class AnalysisService : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.filotimoproject.appcompatibilityhelper.Analyzer")
+
+public:
+    explicit AnalysisService(QObject *parent = nullptr);
+
+    // Registers the service on the session bus. Returns false if it couldn't, e.g. because another instance owns it.
+    bool registerService();
+
+public Q_SLOTS:
+    // Analyses a local file and replies with the helper's analysisResult(), e.g. {"type": "rpm", "hasNativeApp": true, ...}.
+    // The reply is sent once analysis finishes on a worker thread, so requests don't hold each other up.
+    QVariantMap Analyze(const QString &path, const QDBusMessage &message);
+
+private:
+    // Workers are kept alive for the life of the daemon, as each one has its own KSycoca connection to keep warm.
+    QThreadPool m_workers;
+    QTimer m_idleTimer;
+    int m_pendingRequests = 0;
+};
@@ -0,0 +1,731 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "AppDatabase.h"
+#include "BinaryImage.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+constexpr char DATABASE_MAGIC[8] = {'A', 'C', 'H', 'A', 'P', 'P', 'D', 'B'};
+// Bump this whenever the layout below changes.
+constexpr quint32 DATABASE_VERSION = 2;
+// Images are built on the build host, so this is checked to reject one built for a machine of the other byte order.
+constexpr quint32 BYTE_ORDER_MARK = 0x01020304;
+
+enum EntryFlag : quint8 {
+    HasLiteral = 0x1,
+    IsAlternative = 0x2,
+    HasWindowsPattern = 0x4,
+};
+
+struct DatabaseHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrderMark;
+    quint32 entryCount;
+    // Columns of entryCount string offsets.
+    quint32 namesOffset;
+    quint32 flatpakIdsOffset;
+    quint32 alternativeNamesOffset;
+    quint32 windowsPatternsOffset;
+    quint32 linuxPatternsOffset;
+    quint32 aptNamesOffset;
+    // A column of entryCount EntryFlags.
+    quint32 flagsOffset;
+    LiteralMatcher::Tables literals;
+    quint32 stringsOffset;
+    quint32 stringsSize;
+};
+
+// The database currently shared for a set of layers. Readers take a reference to `current` without locking, and
+// reloads publish a new database by swapping it in, so analyses already running keep using the one they started with.
+struct SharedDatabase {
+    std::atomic<std::shared_ptr<const AppDatabase>> current;
+
+    // Serialises reloads, so an older version of the layers can't replace a newer one.
+    QMutex reloadMutex;
+    QByteArray loadedStamp;
+};
+
+// Identifies the state of the layers by whether each exists, its size and its modification time.
+QByteArray layersStamp(const QStringList &layerPaths)
+{
+    QByteArray stamp;
+    for (const QString &layerPath : layerPaths) {
+        const QFileInfo info(layerPath);
+        stamp += info.exists() ? QByteArray::number(info.size()) + ':' + QByteArray::number(info.lastModified().toMSecsSinceEpoch()) : QByteArray("-");
+        stamp += ';';
+    }
+    return stamp;
+}
+
+std::shared_ptr<const AppDatabase> loadDatabase(const QStringList &layerPaths)
+{
+    auto database = std::make_shared<AppDatabase>();
+    return database->load(layerPaths) ? std::move(database) : nullptr;
+}
+
+SharedDatabase &sharedDatabase(const QStringList &layerPaths)
+{
+    static QMutex mutex;
+    static QHash<QStringList, std::shared_ptr<SharedDatabase>> databases;
+
+    // Each thread remembers the databases it has used, so only its first lookup of each takes the lock.
+    thread_local QHash<QStringList, std::shared_ptr<SharedDatabase>> threadDatabases;
+    if (const auto it = threadDatabases.constFind(layerPaths); it != threadDatabases.cend()) {
+        return **it;
+    }
+
+    std::shared_ptr<SharedDatabase> database;
+    {
+        const QMutexLocker locker(&mutex);
+        database = databases.value(layerPaths);
+        if (!database) {
+            // Failures are remembered too, so a missing database is only reported once.
+            database = std::make_shared<SharedDatabase>();
+            database->loadedStamp = layersStamp(layerPaths);
+            database->current.store(loadDatabase(layerPaths));
+            databases.insert(layerPaths, database);
+        }
+    }
+    threadDatabases.insert(layerPaths, database);
+    return *database;
+}
+
+// Loads the layers again if any of them has changed since they were last loaded, and publishes the result.
+void reloadDatabase(const QStringList &layerPaths)
+{
+    SharedDatabase &database = sharedDatabase(layerPaths);
+    const QMutexLocker locker(&database.reloadMutex);
+
+    const QByteArray stamp = layersStamp(layerPaths);
+    if (stamp == database.loadedStamp) {
+        return;
+    }
+    database.loadedStamp = stamp;
+
+    std::shared_ptr<const AppDatabase> reloaded = loadDatabase(layerPaths);
+    if (!reloaded) {
+        // Carry on with the last good database, e.g. if a broken update was pushed.
+        qWarning() << "Keeping the previous version of the database, as the new one couldn't be loaded:" << layerPaths;
+        return;
+    }
+    qDebug() << "Reloaded database" << layerPaths << "with" << reloaded->size() << "entries";
+    database.current.store(std::move(reloaded));
+}
+
+// The key that entries in higher layers replace entries in lower layers by.
+QString entryKey(const QJsonObject &entry)
+{
+    const QString id = entry[u"id"_s].toString();
+    return id.isEmpty() ? entry[u"name"_s].toString() : id;
+}
+
+const DatabaseHeader *databaseHeader(const QByteArray &image)
+{
+    return reinterpret_cast<const DatabaseHeader *>(image.constData());
+}
+
+// Returns the string at `offset` in the string pool of the image.
+QString databaseString(const QByteArray &image, quint32 offset)
+{
+    const DatabaseHeader *header = databaseHeader(image);
+    return QString::fromUtf8(BinaryImage::stringAt(QByteArrayView(image.constData() + header->stringsOffset, header->stringsSize), offset));
+}
+
+// Returns the value of an entry in one of the image's columns.
+template<typename T>
+T databaseColumn(const QByteArray &image, quint32 columnOffset, quint32 index)
+{
+    return reinterpret_cast<const T *>(image.constData() + columnOffset)[index];
+}
+
+// Returns the index just past the group or character class starting at `start`, or -1 if it's never closed.
+qsizetype skipBracketed(const QString &pattern, qsizetype start)
+{
+    const bool isClass = pattern.at(start) == u'[';
+    int depth = 0;
+
+    for (qsizetype i = start; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == u'\\') {
+            ++i;
+        } else if (isClass) {
+            // A "]" straight after the opening "[" or "[^" is a literal.
+            if (c == u']' && i > start + 1 && !(i == start + 2 && pattern.at(start + 1) == u'^')) {
+                return i + 1;
+            }
+        } else if (c == u'[') {
+            i = skipBracketed(pattern, i);
+            if (i < 0) {
+                return -1;
+            }
+            --i;
+        } else if (c == u'(') {
+            ++depth;
+        } else if (c == u')' && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+// Whether a package name has a part marking it as data, documentation, translations or an add-on for an application,
+// e.g. "gimp-data", "firefox-locale-de" or "vlc-plugin-base", rather than the application itself.
+// The first part is the application's own name, so it's never checked.
+bool isCompanionPackage(const QString &name)
+{
+    static const QSet<QString> companionParts = {u"data"_s,     u"doc"_s,       u"docs"_s,      u"help"_s,       u"l10n"_s,
+                                                 u"i18n"_s,     u"locale"_s,    u"langpack"_s,  u"langpacks"_s,  u"plugin"_s,
+                                                 u"plugins"_s,  u"addon"_s,     u"addons"_s,    u"extension"_s,  u"extensions"_s,
+                                                 u"dev"_s,      u"devel"_s,     u"dbg"_s,       u"debuginfo"_s,  u"debugsource"_s};
+    const QStringList parts = name.toLower().split(u'-');
+    return std::any_of(parts.cbegin() + 1, parts.cend(), [](const QString &part) {
+        return companionParts.contains(part);
+    });
+}
+
+// Makes the wildcard after a Linux pattern's leading name start a new part of the package name, so "code.*" matches
+// "code" and "code-insiders" but not "codeblocks".
+QString withNameBoundary(const QString &pattern)
+{
+    qsizetype stemEnd = 0;
+    while (stemEnd < pattern.size() && (pattern.at(stemEnd).isLetterOrNumber() || pattern.at(stemEnd) == u'-' || pattern.at(stemEnd) == u'_')) {
+        ++stemEnd;
+    }
+    if (stemEnd == 0 || !QStringView(pattern).sliced(stemEnd).startsWith(u".*")) {
+        return pattern;
+    }
+    return pattern.first(stemEnd) + u"(?:[-_.].*)?"_s + pattern.sliced(stemEnd + 2);
+}
+}
+
+QString AppDatabase::requiredLiteral(const QString &pattern)
+{
+    QString best;
+    QString current;
+    // Whether the last character of `current` could still be made optional by a quantifier.
+    bool lastAtomIsLiteral = false;
+
+    const auto endRun = [&]() {
+        if (current.size() > best.size()) {
+            best = current;
+        }
+        current.clear();
+        lastAtomIsLiteral = false;
+    };
+
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+
+        if (c == u'|') {
+            // Any of the branches could match, so nothing is required.
+            return QString();
+        }
+
+        if (c == u'(' || c == u'[') {
+            endRun();
+            const qsizetype end = skipBracketed(pattern, i);
+            if (end < 0) {
+                return QString();
+            }
+            i = end - 1;
+        } else if (c == u'*' || c == u'?' || c == u'{') {
+            // The previous character may not be there at all.
+            if (lastAtomIsLiteral) {
+                current.chop(1);
+            }
+            endRun();
+            if (c == u'{') {
+                i = pattern.indexOf(u'}', i);
+                if (i < 0) {
+                    return QString();
+                }
+            }
+        } else if (c == u'+') {
+            // The previous character is required, but may be repeated.
+            endRun();
+        } else if (c == u'.' || c == u'^' || c == u'$') {
+            endRun();
+        } else if (c == u')') {
+            return QString();
+        } else if (c == u'\\') {
+            if (i + 1 >= pattern.size()) {
+                return QString();
+            }
+            const QChar escaped = pattern.at(++i);
+            if (escaped.isLetterOrNumber()) {
+                // Character classes and assertions end the run. Anything else (hex escapes, backreferences, ...)
+                // is rare enough that it's not worth understanding.
+                if (!u"sSdDwWbB"_s.contains(escaped)) {
+                    return QString();
+                }
+                endRun();
+            } else {
+                current.append(escaped);
+                lastAtomIsLiteral = true;
+            }
+        } else {
+            current.append(c);
+            lastAtomIsLiteral = true;
+        }
+    }
+    endRun();
+
+    return best.toCaseFolded();
+}
+
+QByteArray AppDatabase::compile(const QByteArray &json, QStringList &problems)
+{
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(json, &error);
+    if (!doc.isArray()) {
+        problems.append(u"Invalid JSON: %1"_s.arg(error.errorString()));
+        return QByteArray();
+    }
+    return compileEntries(doc.array(), problems);
+}
+
+QByteArray AppDatabase::merge(const QList<QJsonArray> &layers, QStringList &problems)
+{
+    QJsonArray merged;
+    QSet<QString> replaced;
+
+    // Higher layers come first, so their entries are matched before any they didn't replace.
+    for (auto layer = layers.crbegin(); layer != layers.crend(); ++layer) {
+        QSet<QString> layerKeys;
+        for (const QJsonValue &value : *layer) {
+            const QJsonObject entry = value.toObject();
+            const QString key = entryKey(entry);
+            if (!key.isEmpty()) {
+                if (replaced.contains(key)) {
+                    continue;
+                }
+                layerKeys.insert(key);
+            }
+            // A disabled entry still replaces the ones below it, which is how an overlay removes an entry.
+            if (!entry[u"disabled"_s].toBool()) {
+                merged.append(entry);
+            }
+        }
+        // Entries within a layer don't replace each other, as an application can have several patterns.
+        replaced.unite(layerKeys);
+    }
+
+    return compileEntries(merged, problems);
+}
+
+QByteArray AppDatabase::compileEntries(const QJsonArray &appDb, QStringList &problems)
+{
+    BinaryImage::StringPoolWriter strings;
+    QList<quint32> names;
+    QList<quint32> flatpakIds;
+    QList<quint32> alternativeNames;
+    QList<quint32> windowsPatterns;
+    QList<quint32> linuxPatterns;
+    QList<quint32> aptNames;
+    QList<quint8> flags;
+    QList<QByteArray> literals;
+
+    for (qsizetype i = 0; i < appDb.size(); ++i) {
+        const QJsonObject appEntry = appDb.at(i).toObject();
+        const QString name = appEntry[u"name"_s].toString();
+
+        // Ignore any entry without a Flatpak reference, or without anything to match it by.
+        const QJsonObject patterns = appEntry[u"regex"_s].toObject();
+        const QString aptName = appEntry[u"apt"_s].toString();
+        if (!appEntry[u"flatpak"_s].isObject() || (!patterns[u"windows"_s].isString() && !patterns[u"linux"_s].isString() && aptName.isEmpty())) {
+            continue;
+        }
+
+        const QString flatpakId = appEntry[u"flatpak"_s].toObject()[u"id"_s].toString();
+        if (flatpakId.isEmpty()) {
+            problems.append(u"Entry %1 (%2) has no Flatpak ID"_s.arg(i).arg(name));
+            continue;
+        }
+
+        const QString pattern = patterns[u"windows"_s].toString();
+        const QString linuxPattern = patterns[u"linux"_s].toString();
+        bool valid = true;
+        for (const QString &entryPattern : {pattern, linuxPattern}) {
+            const QRegularExpression regex(entryPattern, QRegularExpression::CaseInsensitiveOption);
+            if (!regex.isValid()) {
+                problems.append(u"Entry %1 (%2) has an invalid pattern \"%3\": %4"_s.arg(i).arg(name, entryPattern, regex.errorString()));
+                valid = false;
+            }
+        }
+        if (!valid) {
+            continue;
+        }
+
+        quint8 entryFlags = 0;
+        const QString literal = pattern.isEmpty() ? QString() : requiredLiteral(pattern);
+        if (!literal.isEmpty()) {
+            entryFlags |= HasLiteral;
+        }
+        if (!pattern.isEmpty()) {
+            entryFlags |= HasWindowsPattern;
+        }
+        if (appEntry[u"alternative"_s].isObject()) {
+            entryFlags |= IsAlternative;
+        }
+
+        names.append(strings.add(name.toUtf8()));
+        flatpakIds.append(strings.add(flatpakId.toUtf8()));
+        alternativeNames.append(strings.add(appEntry[u"alternative"_s].toObject()[u"name"_s].toString().toUtf8()));
+        windowsPatterns.append(strings.add(pattern.toUtf8()));
+        linuxPatterns.append(strings.add(linuxPattern.toUtf8()));
+        aptNames.append(strings.add(aptName.toUtf8()));
+        flags.append(entryFlags);
+        literals.append(literal.toUtf8());
+    }
+
+    DatabaseHeader header = {};
+    memcpy(header.magic, DATABASE_MAGIC, sizeof(header.magic));
+    header.version = DATABASE_VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.entryCount = names.size();
+
+    QByteArray image(sizeof(DatabaseHeader), '\0');
+    header.namesOffset = BinaryImage::append(image, names.constData(), names.size());
+    header.flatpakIdsOffset = BinaryImage::append(image, flatpakIds.constData(), flatpakIds.size());
+    header.alternativeNamesOffset = BinaryImage::append(image, alternativeNames.constData(), alternativeNames.size());
+    header.windowsPatternsOffset = BinaryImage::append(image, windowsPatterns.constData(), windowsPatterns.size());
+    header.linuxPatternsOffset = BinaryImage::append(image, linuxPatterns.constData(), linuxPatterns.size());
+    header.aptNamesOffset = BinaryImage::append(image, aptNames.constData(), aptNames.size());
+    header.flagsOffset = BinaryImage::append(image, flags.constData(), flags.size());
+    header.literals = LiteralMatcher::build(literals, image);
+    header.stringsOffset = BinaryImage::append(image, strings.data().constData(), strings.data().size());
+    header.stringsSize = strings.data().size();
+
+    memcpy(image.data(), &header, sizeof(header));
+    return image;
+}
+
+bool AppDatabase::load(const QString &filePath)
+{
+    auto file = std::make_shared<QFile>(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open database file:" << filePath;
+        return false;
+    }
+
+    const qint64 size = file->size();
+    uchar *data = size > 0 ? file->map(0, size) : nullptr;
+    if (data && size >= qint64(sizeof(DATABASE_MAGIC)) && memcmp(data, DATABASE_MAGIC, sizeof(DATABASE_MAGIC)) == 0) {
+        if (!setImage(QByteArray::fromRawData(reinterpret_cast<const char *>(data), size))) {
+            qWarning() << "Database file is corrupt or from an incompatible version:" << filePath;
+            return false;
+        }
+        m_mappedFile = file;
+        return true;
+    }
+
+    // Not a compiled image, so it should be the JSON source.
+    QStringList problems;
+    const QByteArray image = compile(data ? QByteArray::fromRawData(reinterpret_cast<const char *>(data), size) : file->readAll(), problems);
+    for (const QString &problem : std::as_const(problems)) {
+        qWarning() << "Problem in database file" << filePath << ":" << problem;
+    }
+    return !image.isEmpty() && setImage(image);
+}
+
+bool AppDatabase::load(const QStringList &layerPaths)
+{
+    if (layerPaths.isEmpty()) {
+        return false;
+    }
+
+    QStringList overlayPaths;
+    for (qsizetype i = 1; i < layerPaths.size(); ++i) {
+        if (QFileInfo::exists(layerPaths.at(i))) {
+            overlayPaths.append(layerPaths.at(i));
+        }
+    }
+
+    // Without any overlays, the shipped image can be mapped as it is.
+    if (overlayPaths.isEmpty()) {
+        return load(layerPaths.first());
+    }
+
+    QList<QJsonArray> layers;
+    AppDatabase base;
+    if (base.load(layerPaths.first())) {
+        layers.append(base.entries());
+    }
+
+    for (const QString &overlayPath : std::as_const(overlayPaths)) {
+        QFile file(overlayPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed to open database file:" << overlayPath;
+            continue;
+        }
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+        if (!doc.isArray()) {
+            qWarning() << "Ignoring database file" << overlayPath << "as it isn't valid:" << error.errorString();
+            continue;
+        }
+        layers.append(doc.array());
+    }
+
+    if (layers.isEmpty()) {
+        return false;
+    }
+
+    QStringList problems;
+    const QByteArray image = merge(layers, problems);
+    for (const QString &problem : std::as_const(problems)) {
+        qWarning() << "Problem in database" << layerPaths << ":" << problem;
+    }
+    return !image.isEmpty() && setImage(image);
+}
+
+std::shared_ptr<const AppDatabase> AppDatabase::shared(const QStringList &layerPaths)
+{
+    return sharedDatabase(layerPaths).current.load();
+}
+
+void AppDatabase::watch(const QStringList &layerPaths)
+{
+    auto *watcher = new QFileSystemWatcher(QCoreApplication::instance());
+    // Updates are usually written to a new file that's renamed over the old one, which drops the file from the watch,
+    // so the directories are watched too. Overlays are often created from scratch, so their directory's parent is
+    // watched if the directory doesn't exist yet.
+    for (const QString &layerPath : layerPaths) {
+        const QFileInfo directory(QFileInfo(layerPath).absolutePath());
+        watcher->addPath(directory.exists() ? directory.absoluteFilePath() : directory.absolutePath());
+        if (QFileInfo::exists(layerPath)) {
+            watcher->addPath(layerPath);
+        }
+    }
+
+    // Wait for changes to settle, so a file that's being written isn't loaded halfway through.
+    auto *debounce = new QTimer(watcher);
+    debounce->setSingleShot(true);
+    debounce->setInterval(500ms);
+
+    QObject::connect(watcher, &QFileSystemWatcher::fileChanged, debounce, qOverload<>(&QTimer::start));
+    QObject::connect(watcher, &QFileSystemWatcher::directoryChanged, debounce, qOverload<>(&QTimer::start));
+    QObject::connect(debounce, &QTimer::timeout, watcher, [watcher, layerPaths]() {
+        for (const QString &layerPath : layerPaths) {
+            const QString directory = QFileInfo(layerPath).absolutePath();
+            if (QFileInfo::exists(directory) && !watcher->directories().contains(directory)) {
+                watcher->addPath(directory);
+            }
+            if (QFileInfo::exists(layerPath) && !watcher->files().contains(layerPath)) {
+                watcher->addPath(layerPath);
+            }
+        }
+        QThreadPool::globalInstance()->start([layerPaths]() {
+            reloadDatabase(layerPaths);
+        });
+    });
+}
+
+bool AppDatabase::setImage(const QByteArray &image)
+{
+    if (image.size() < qsizetype(sizeof(DatabaseHeader))) {
+        return false;
+    }
+
+    const DatabaseHeader *header = databaseHeader(image);
+    if (memcmp(header->magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC)) != 0 || header->version != DATABASE_VERSION
+        || header->byteOrderMark != BYTE_ORDER_MARK || !BinaryImage::fits<quint32>(image.size(), header->namesOffset, header->entryCount)
+        || !BinaryImage::fits<quint32>(image.size(), header->flatpakIdsOffset, header->entryCount)
+        || !BinaryImage::fits<quint32>(image.size(), header->alternativeNamesOffset, header->entryCount)
+        || !BinaryImage::fits<quint32>(image.size(), header->windowsPatternsOffset, header->entryCount)
+        || !BinaryImage::fits<quint32>(image.size(), header->linuxPatternsOffset, header->entryCount)
+        || !BinaryImage::fits<quint32>(image.size(), header->aptNamesOffset, header->entryCount)
+        || !BinaryImage::fits<quint8>(image.size(), header->flagsOffset, header->entryCount)
+        || !BinaryImage::fits<char>(image.size(), header->stringsOffset, header->stringsSize)) {
+        return false;
+    }
+
+    std::optional<LiteralMatcher> literals = LiteralMatcher::fromImage(image, header->literals, header->entryCount);
+    if (!literals) {
+        return false;
+    }
+
+    m_image = image;
+    m_literals = *literals;
+    m_windowsRegexes = std::vector<QRegularExpression>(header->entryCount);
+    m_windowsRegexesCompiled = std::make_unique<std::once_flag[]>(header->entryCount);
+
+    // Only a few entries can match packages, so they're listed up front rather than searched for on every match.
+    // Alternatives are left out: their package is the replacement's, so matching one would offer the wrong application.
+    m_packageEntries.clear();
+    m_nameIndex.clear();
+    for (quint32 i = 0; i < header->entryCount; ++i) {
+        const quint8 flags = databaseColumn<quint8>(image, header->flagsOffset, i);
+        if (!(flags & IsAlternative) && (!linuxPattern(i).isEmpty() || !aptName(i).isEmpty())) {
+            m_packageEntries.push_back(i);
+        }
+        if (flags & HasWindowsPattern) {
+            m_nameIndex.try_emplace(databaseString(image, databaseColumn<quint32>(image, header->namesOffset, i)).toCaseFolded(), i);
+        }
+    }
+    m_linuxRegexes = std::vector<QRegularExpression>(header->entryCount);
+    m_linuxRegexesCompiled = std::make_unique<std::once_flag[]>(header->entryCount);
+    return true;
+}
+
+qsizetype AppDatabase::size() const
+{
+    return m_image.isEmpty() ? 0 : databaseHeader(m_image)->entryCount;
+}
+
+AppDatabase::Entry AppDatabase::entryAt(quint32 index) const
+{
+    const DatabaseHeader *header = databaseHeader(m_image);
+
+    Entry entry;
+    entry.name = databaseString(m_image, databaseColumn<quint32>(m_image, header->namesOffset, index));
+    entry.flatpakId = databaseString(m_image, databaseColumn<quint32>(m_image, header->flatpakIdsOffset, index));
+    entry.isAlternative = databaseColumn<quint8>(m_image, header->flagsOffset, index) & IsAlternative;
+    entry.alternativeName = databaseString(m_image, databaseColumn<quint32>(m_image, header->alternativeNamesOffset, index));
+    return entry;
+}
+
+QString AppDatabase::windowsPattern(quint32 index) const
+{
+    return databaseString(m_image, databaseColumn<quint32>(m_image, databaseHeader(m_image)->windowsPatternsOffset, index));
+}
+
+QString AppDatabase::linuxPattern(quint32 index) const
+{
+    return databaseString(m_image, databaseColumn<quint32>(m_image, databaseHeader(m_image)->linuxPatternsOffset, index));
+}
+
+QString AppDatabase::aptName(quint32 index) const
+{
+    return databaseString(m_image, databaseColumn<quint32>(m_image, databaseHeader(m_image)->aptNamesOffset, index));
+}
+
+QJsonArray AppDatabase::entries() const
+{
+    QJsonArray entries;
+    for (quint32 i = 0; i < size(); ++i) {
+        const Entry entry = entryAt(i);
+        QJsonObject patterns;
+        if (databaseColumn<quint8>(m_image, databaseHeader(m_image)->flagsOffset, i) & HasWindowsPattern) {
+            patterns.insert(u"windows"_s, windowsPattern(i));
+        }
+        if (const QString pattern = linuxPattern(i); !pattern.isEmpty()) {
+            patterns.insert(u"linux"_s, pattern);
+        }
+        QJsonObject object = {
+            {u"name"_s, entry.name},
+            {u"regex"_s, patterns},
+            {u"flatpak"_s, QJsonObject{{u"id"_s, entry.flatpakId}}},
+        };
+        if (const QString apt = aptName(i); !apt.isEmpty()) {
+            object.insert(u"apt"_s, apt);
+        }
+        if (entry.isAlternative) {
+            object.insert(u"alternative"_s, QJsonObject{{u"name"_s, entry.alternativeName}});
+        }
+        entries.append(object);
+    }
+    return entries;
+}
+
+const QRegularExpression &AppDatabase::windowsRegex(quint32 index) const
+{
+    std::call_once(m_windowsRegexesCompiled[index], [this, index]() {
+        QRegularExpression regex(windowsPattern(index), QRegularExpression::CaseInsensitiveOption);
+        // Compile (and JIT) the pattern now, rather than lazily inside match().
+        regex.optimize();
+        m_windowsRegexes[index] = regex;
+    });
+    return m_windowsRegexes[index];
+}
+
+std::optional<AppDatabase::Entry> AppDatabase::matchWindowsFileName(const QString &fileName) const
+{
+    const qsizetype entryCount = size();
+    if (entryCount == 0) {
+        return std::nullopt;
+    }
+
+    QList<bool> candidates(entryCount, false);
+    m_literals.findAll(fileName.toCaseFolded().toUtf8(), candidates);
+
+    const quint32 flagsOffset = databaseHeader(m_image)->flagsOffset;
+    for (quint32 i = 0; i < entryCount; ++i) {
+        const quint8 flags = databaseColumn<quint8>(m_image, flagsOffset, i);
+        if (!(flags & HasWindowsPattern) || ((flags & HasLiteral) && !candidates.at(i))) {
+            continue;
+        }
+        if (windowsRegex(i).match(fileName).hasMatch()) {
+            return entryAt(i);
+        }
+    }
+    return std::nullopt;
+}
+
+const QRegularExpression &AppDatabase::linuxRegex(quint32 index) const
+{
+    std::call_once(m_linuxRegexesCompiled[index], [this, index]() {
+        // Linux patterns describe the whole name, e.g. "discord.*", so they shouldn't match "notdiscord" or "discordo".
+        QRegularExpression regex(QRegularExpression::anchoredPattern(withNameBoundary(linuxPattern(index))),
+                                 QRegularExpression::CaseInsensitiveOption);
+        regex.optimize();
+        m_linuxRegexes[index] = regex;
+    });
+    return m_linuxRegexes[index];
+}
+
+std::optional<AppDatabase::Entry> AppDatabase::matchPackage(const QStringList &names) const
+{
+    QStringList candidates;
+    for (const QString &name : names) {
+        if (!name.isEmpty() && !isCompanionPackage(name)) {
+            candidates.append(name);
+        }
+    }
+    if (candidates.isEmpty()) {
+        return std::nullopt;
+    }
+
+    for (const quint32 i : m_packageEntries) {
+        const QString apt = aptName(i);
+        const bool hasLinuxPattern = !linuxPattern(i).isEmpty();
+        for (const QString &name : std::as_const(candidates)) {
+            if ((!apt.isEmpty() && name.compare(apt, Qt::CaseInsensitive) == 0) || (hasLinuxPattern && linuxRegex(i).match(name).hasMatch())) {
+                return entryAt(i);
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<AppDatabase::Entry> AppDatabase::findByName(const QString &name) const
+{
+    const auto it = m_nameIndex.constFind(name.toCaseFolded());
+    if (it == m_nameIndex.cend()) {
+        return std::nullopt;
+    }
+    return entryAt(*it);
+}
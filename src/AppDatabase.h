@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include "LiteralMatcher.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+using namespace Qt::Literals::StringLiterals;
+
+// The database of Windows applications with native alternatives.
+//
+// app_db.json is the editable source. At build time, appdbcompiler turns it into a binary image holding interned
+// strings, the entries as one column per field, and the tables of a LiteralMatcher built from a literal each
+// pattern requires. The image is memory-mapped at runtime, so loading it doesn't involve any parsing.
+//
+// Matching a file name first runs it through the LiteralMatcher, so only the handful of entries that could
+// possibly match have their regular expression compiled and run.
+class AppDatabase
+{
+public:
+    struct Entry {
+        // The name of the Windows application, e.g. "Mozilla Firefox".
+        QString name;
+        // The Flatpak to offer instead, e.g. "org.mozilla.firefox".
+        QString flatpakId;
+        // Set if the Flatpak is a different application that replaces this one, rather than a native version of it.
+        // e.g. Microsoft Edge for Internet Explorer.
+        bool isAlternative = false;
+        // The name of that alternative, e.g. "Microsoft Edge". Empty if the entry doesn't name it.
+        QString alternativeName;
+    };
+
+    // Loads a database image compiled by appdbcompiler. JSON databases are also accepted and compiled in memory.
+    // Returns false if the database couldn't be read.
+    bool load(const QString &filePath);
+
+    // Loads a stack of layers, lowest priority first, e.g. the shipped database followed by vendor and user overlays.
+    // The first layer may be an image or JSON, and the rest are JSON. Layers that don't exist are skipped.
+    //
+    // Each entry has a key, its "id" if it has one and its "name" otherwise. An entry replaces any entries with the same
+    // key in lower layers, and an entry with "disabled": true removes them. Entries from higher layers are matched first.
+    // Returns false if none of the layers could be read.
+    bool load(const QStringList &layerPaths);
+
+    // Returns a database shared by everything in the process that uses the same layers, loading it on first use.
+    // Returns nullptr if it couldn't be loaded.
+    // Looking it up doesn't take a lock after a thread's first use of it.
+    static std::shared_ptr<const AppDatabase> shared(const QStringList &layerPaths);
+
+    // Reloads the shared database in the background whenever a layer changes, e.g. when an update is pushed mid-session.
+    // Analyses already holding the old database keep using it. This must be called from a thread with an event loop.
+    // Files must be replaced rather than written in place, as a database that's in use keeps the old file mapped.
+    static void watch(const QStringList &layerPaths);
+
+    // Returns the first entry, in database order, whose Windows pattern matches the file name, ignoring case.
+    std::optional<Entry> matchWindowsFileName(const QString &fileName) const;
+
+    // Returns the first entry, in database order, for a Linux package known by any of the given package names, e.g. "discord".
+    // A name matches if its entry's apt package name is the same, or its Linux pattern matches the whole name, ignoring case.
+    // Names of companion packages, e.g. "gimp-data" or "firefox-locale-de", never match.
+    // Alternatives are never matched, since their entry describes the replacement rather than the package's application,
+    // e.g. a "flash-player" package would otherwise be offered as Ruffle under the name "Adobe Flash Player".
+    std::optional<Entry> matchPackage(const QStringList &names) const;
+
+    // Returns the first entry with a Windows pattern whose name is `name`, ignoring case, e.g. "Mozilla Firefox".
+    std::optional<Entry> findByName(const QString &name) const;
+
+    qsizetype size() const;
+
+    // Compiles the contents of app_db.json into an image. Returns an empty array if the JSON can't be parsed.
+    // Entries without a Flatpak, or without a Windows pattern, Linux pattern or apt package name, are left out,
+    // as they can never produce a match.
+    // Entries that look like they were meant to be used but can't be, e.g. due to an invalid pattern,
+    // are also left out and described in `problems`.
+    static QByteArray compile(const QByteArray &json, QStringList &problems);
+
+    // Merges layers of app_db.json entries, lowest priority first, and compiles the result as compile() does.
+    static QByteArray merge(const QList<QJsonArray> &layers, QStringList &problems);
+
+    // Returns the longest run of literal characters that any match of the pattern must contain, case folded.
+    // Returns an empty string if the pattern has no such literal, e.g. because it has a top-level alternation.
+    static QString requiredLiteral(const QString &pattern);
+
+private:
+    static QByteArray compileEntries(const QJsonArray &appDb, QStringList &problems);
+
+    // Returns the entries in app_db.json form, for merging with overlays.
+    QJsonArray entries() const;
+
+    // Validates and adopts an image, returning false if it's corrupt or from an incompatible version.
+    bool setImage(const QByteArray &image);
+
+    Entry entryAt(quint32 index) const;
+    QString windowsPattern(quint32 index) const;
+    QString linuxPattern(quint32 index) const;
+    QString aptName(quint32 index) const;
+
+    // Compiles the Windows pattern of an entry the first time it's needed.
+    const QRegularExpression &windowsRegex(quint32 index) const;
+    const QRegularExpression &linuxRegex(quint32 index) const;
+
+    // Keeps the database file open while its contents are mapped into m_image.
+    std::shared_ptr<QFile> m_mappedFile;
+    QByteArray m_image;
+    LiteralMatcher m_literals;
+
+    mutable std::vector<QRegularExpression> m_windowsRegexes;
+    mutable std::unique_ptr<std::once_flag[]> m_windowsRegexesCompiled;
+
+    // Maps case folded names to the first entry with a Windows pattern that has them.
+    QHash<QString, quint32> m_nameIndex;
+
+    // The entries with a Linux pattern, or an apt package name that isn't an alternative's.
+    std::vector<quint32> m_packageEntries;
+    mutable std::vector<QRegularExpression> m_linuxRegexes;
+    mutable std::unique_ptr<std::once_flag[]> m_linuxRegexesCompiled;
+};
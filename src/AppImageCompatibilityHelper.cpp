@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "AppImageCompatibilityHelper.h"
+#include "AppStreamIndex.h"
+#include "CompatibilityHelperFactory.h"
+#include "PackageUtils.h"
+#include "SquashFsReader.h"
+
+#include <KLocalizedString>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+namespace
+{
+// The AppStream metainfo directory inside an AppImage's AppDir.
+const QString METAINFO_DIRECTORY = u"usr/share/metainfo"_s;
+}
+
+AppImageCompatibilityHelper::AppImageCompatibilityHelper(const QUrl &filePath, QObject *parent)
+    : ICompatibilityHelper(filePath, parent)
+{
+    // Initialize the native app name to the file name of the AppImage.
+    m_nativeAppName = m_filePath.fileName();
+}
+
+void AppImageCompatibilityHelper::analyze()
+{
+    // AppImages are usually named "<name>-<version>-<arch>.AppImage", e.g. "Obsidian-1.5.3.AppImage".
+    static const QRegularExpression nameSeparator(u"[-_ ]"_s);
+    const QString fileName = m_filePath.fileName();
+    const QString packageName = QFileInfo(fileName).completeBaseName().section(nameSeparator, 0, 0);
+
+    // Well-known vendor AppImages are in the application database, so there's no need to read them.
+    if (matchKnownPackage({packageName}, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp)) {
+        return;
+    }
+
+    // Read the metainfo and desktop files straight out of the SquashFS image, rather than mounting or extracting it.
+    SquashFsReader image(m_filePath.toLocalFile());
+    if (!image.open()) {
+        qWarning() << "An alternative native application will not be matched for this AppImage.";
+        return;
+    }
+
+    QList<QByteArray> metainfoFiles;
+    const QStringList metainfoNames = image.entryNames(METAINFO_DIRECTORY).value_or(QStringList());
+    for (const QString &name : metainfoNames) {
+        const QString path = METAINFO_DIRECTORY + u'/' + name;
+        if (!isMetainfoPath(path)) {
+            continue;
+        }
+        if (const std::optional<QByteArray> content = image.readFile(path)) {
+            metainfoFiles.append(*content);
+        }
+    }
+
+    // Every AppImage has a desktop file at the root of its AppDir, which names the application even without metainfo.
+    std::optional<DesktopEntry> desktopEntry;
+    const QStringList rootNames = image.entryNames(QString()).value_or(QStringList());
+    for (const QString &name : rootNames) {
+        if (!name.endsWith(u".desktop"_s)) {
+            continue;
+        }
+        if (const std::optional<QByteArray> content = image.readFile(name)) {
+            desktopEntry = readDesktopEntry(name, *content);
+            break;
+        }
+    }
+
+    // The desktop file's ID is usually a better guess at the Flatpak's ID than the file name, e.g. "obsidian".
+    const QString matchName = desktopEntry ? desktopEntry->id : packageName;
+    if (!metainfoFiles.isEmpty()) {
+        matchFlatpakFromMetainfo(metainfoFiles, matchName, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp);
+    }
+
+    // Fall back to the desktop file if the metainfo didn't lead anywhere.
+    if (!m_hasFlatpakApp && desktopEntry) {
+        matchFlatpakFromDesktopEntries({*desktopEntry}, packageName, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp);
+    }
+}
+
+QVariantMap AppImageCompatibilityHelper::analysisResult() const
+{
+    QVariantMap result = ICompatibilityHelper::analysisResult();
+    result.insert(u"type"_s, u"appimage"_s);
+    result.insert(u"isAnApp"_s, m_isAnApp);
+    result.insert(u"hasFlatpakApp"_s, m_hasFlatpakApp);
+    return result;
+}
+
+QByteArray AppImageCompatibilityHelper::analysisInputsVersion() const
+{
+    return AppStreamIndex::system()->version() + CompatibilityHelperFactory::appDatabaseVersion();
+}
+
+bool AppImageCompatibilityHelper::restoreAnalysisResult(const QVariantMap &result)
+{
+    if (result.value(u"type"_s).toString() != u"appimage"_s) {
+        return false;
+    }
+
+    m_nativeAppName = result.value(u"nativeAppName"_s).toString();
+    m_nativeAppRef = result.value(u"nativeAppRef"_s).toString();
+    m_hasFlatpakApp = result.value(u"hasFlatpakApp"_s).toBool();
+    m_isAnApp = result.value(u"isAnApp"_s).toBool();
+    return true;
+}
+
+QString AppImageCompatibilityHelper::windowTitle() const
+{
+    return nativeAppName();
+}
+
+QString AppImageCompatibilityHelper::heading() const
+{
+    if (hasNativeApp()) {
+        if (installState().nativeAppInstalled) {
+            return i18n("Open the installed version of %1 instead", nativeAppName());
+        } else if (m_hasFlatpakApp) {
+            return i18n("Install %1 from %2 instead", nativeAppName(), installState().appStoreName);
+        } else if (m_isAnApp) {
+            return i18n("Search for %1 in %2 instead", nativeAppName(), installState().appStoreName);
+        }
+    } else {
+        return i18n("AppImages are not integrated with %1", distroName());
+    }
+
+    return QString();
+}
+
+QString AppImageCompatibilityHelper::icon() const
+{
+    if (hasNativeApp() && installState().nativeAppHasIcon) {
+        return nativeAppRef();
+    }
+    return u"application-vnd.appimage"_s;
+}
+
+QString AppImageCompatibilityHelper::description() const
+{
+    QString desc;
+
+    if (hasNativeApp()) {
+        if (installState().nativeAppInstalled) {
+            desc = i18n("A %1 version of %2 is already installed on your system. ", distroName(), nativeAppName());
+            desc += i18n("It's recommended to use the installed version for automatic updates and better system integration.");
+        } else if (m_hasFlatpakApp) {
+            desc = i18n("A %1 version of %2 is available for installation. ", distroName(), nativeAppName());
+            desc += i18n("Installing it is recommended for automatic updates and better system integration.");
+        } else if (m_isAnApp) {
+            desc = i18n("A %1 version of %2 may be available for installation from %3. ", distroName(), nativeAppName(), installState().appStoreName);
+            desc += i18n("Installing it is recommended for automatic updates and better system integration.");
+        }
+    } else {
+        desc = i18n("You can search for alternatives online or in %1.", installState().appStoreName);
+    }
+
+    desc += u"<br><br>"_s;
+    if (installState().compatibilityToolInstalled) {
+        desc += i18n("Alternatively, you can run this AppImage and add it to your applications with Gear Lever. ");
+    } else {
+        desc += i18n("Alternatively, you can install Gear Lever to run this AppImage and add it to your applications. ");
+    }
+    desc += i18n("This is not recommended for most users, as AppImages don't update automatically and aren't sandboxed.");
+
+    return desc;
+}
+
+bool AppImageCompatibilityHelper::hasNativeApp() const
+{
+    // The native app action will be to open/install the native app if it exists in Flatpak,
+    // or to search for the name in the app store if it doesn't.
+    return m_hasFlatpakApp || m_isAnApp;
+}
+
+QString AppImageCompatibilityHelper::nativeAppName() const
+{
+    return m_nativeAppName;
+}
+
+QString AppImageCompatibilityHelper::nativeAppRef() const
+{
+    return m_nativeAppRef;
+}
+
+bool AppImageCompatibilityHelper::isNativeAppInstalled() const
+{
+    return isAppInstalled(nativeAppRef());
+}
+
+QString AppImageCompatibilityHelper::nativeAppActionText() const
+{
+    if (installState().nativeAppInstalled) {
+        return i18n("Open %1", nativeAppName());
+    } else if (m_hasFlatpakApp) {
+        return i18n("Install %1", nativeAppName());
+    } else if (m_isAnApp) {
+        return i18n("Search for %1 in %2", nativeAppName(), installState().appStoreName);
+    }
+
+    return QString();
+}
+
+QString AppImageCompatibilityHelper::nativeAppActionIcon() const
+{
+    if (installState().nativeAppInstalled) {
+        return nativeAppRef();
+    } else {
+        return installState().appStoreIcon;
+    }
+}
+
+void AppImageCompatibilityHelper::nativeAppAction() const
+{
+    if (!hasNativeApp()) {
+        qWarning() << "Invalid operation: No native application was found for the provided AppImage.";
+        return;
+    }
+
+    if (installState().nativeAppInstalled) {
+        openApp(nativeAppRef());
+    } else if (m_hasFlatpakApp) {
+        openAppInAppStore(nativeAppRef());
+    } else if (m_isAnApp) {
+        openAppInAppStore(nativeAppName());
+    }
+}
+
+bool AppImageCompatibilityHelper::isCompatibilityToolInstalled() const
+{
+    return isAppInstalled(GEAR_LEVER_ID);
+}
+
+QString AppImageCompatibilityHelper::compatibilityToolActionText() const
+{
+    if (installState().compatibilityToolInstalled) {
+        return i18n("Open with Gear Lever");
+    } else {
+        return i18n("Install Gear Lever");
+    }
+}
+
+QString AppImageCompatibilityHelper::compatibilityToolActionIcon() const
+{
+    if (installState().compatibilityToolInstalled && installState().compatibilityToolHasIcon) {
+        return GEAR_LEVER_ID;
+    } else {
+        return u"plasmadiscover"_s;
+    }
+}
+
+void AppImageCompatibilityHelper::compatibilityToolAction() const
+{
+    if (installState().compatibilityToolInstalled) {
+        openApp(GEAR_LEVER_ID, {m_filePath});
+    } else {
+        openAppInAppStore(GEAR_LEVER_ID);
+    }
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include "ICompatibilityHelper.h"
+
+using namespace Qt::Literals::StringLiterals;
+
+#define GEAR_LEVER_ID u"it.mijorus.gearlever"_s
+
+class AppImageCompatibilityHelper : public ICompatibilityHelper
+{
+    Q_OBJECT
+
+public:
+    explicit AppImageCompatibilityHelper(const QUrl &filePath, QObject *parent = nullptr);
+    ~AppImageCompatibilityHelper() override = default;
+
+    QString windowTitle() const override;
+    QString heading() const override;
+    QString icon() const override;
+    QString description() const override;
+    bool hasNativeApp() const override;
+    QString nativeAppActionText() const override;
+    QString nativeAppActionIcon() const override;
+    bool hasCompatibilityTool() const override
+    {
+        // Always true for this helper, as Gear Lever can run and integrate any AppImage.
+        return true;
+    };
+
+    QString compatibilityToolActionText() const override;
+    QString compatibilityToolActionIcon() const override;
+
+    QVariantMap analysisResult() const override;
+
+    Q_INVOKABLE void nativeAppAction() const override;
+    Q_INVOKABLE void compatibilityToolAction() const override;
+
+protected:
+    void analyze() override;
+    QByteArray analysisInputsVersion() const override;
+    bool restoreAnalysisResult(const QVariantMap &result) override;
+
+private:
+    QString m_nativeAppName;
+    QString m_nativeAppRef;
+
+    // Whether a corresponding Flatpak application was found.
+    bool m_hasFlatpakApp = false;
+
+    // Whether the AppImage has a metainfo or desktop file naming the application.
+    // This is used to determine if the helper should offer to search Discover or not.
+    bool m_isAnApp = false;
+
+    QString nativeAppName() const override;
+    QString nativeAppRef() const override;
+    bool isCompatibilityToolInstalled() const override;
+    QString compatibilityToolRef() const override
+    {
+        return GEAR_LEVER_ID;
+    }
+    bool isNativeAppInstalled() const override;
+};
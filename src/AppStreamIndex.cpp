@@ -0,0 +1,839 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "AppStreamIndex.h"
+#include "BinaryImage.h"
+#include "StreamDecompressor.h"
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QThreadPool>
+#include <QTimer>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+constexpr char INDEX_MAGIC[8] = {'A', 'C', 'H', 'A', 'P', 'P', 'S', 'T'};
+// Bump this whenever the layout below changes, so older caches are rebuilt rather than misread.
+constexpr quint32 INDEX_VERSION = 2;
+
+struct IndexHeader {
+    char magic[8];
+    quint32 version;
+    quint32 componentCount;
+    quint32 sourceCount;
+    quint32 sourcesOffset;
+    quint32 componentsOffset;
+    quint32 idTableOffset;
+    quint32 idTableSize;
+    quint32 nameTableOffset;
+    quint32 nameTableSize;
+    quint32 suffixTableOffset;
+    quint32 suffixTableSize;
+    quint32 trigramsOffset;
+    quint32 trigramCount;
+    quint32 postingsOffset;
+    quint32 postingCount;
+    quint32 documentWeightsOffset;
+    quint32 stringsOffset;
+    quint32 stringsSize;
+};
+
+// The catalogue an index was built from, used to tell whether the index is stale.
+struct SourceRecord {
+    quint32 path;
+    quint32 reserved;
+    qint64 size;
+    qint64 modified;
+    char checksum[20];
+    char reserved2[4];
+};
+
+// Offsets into the string pool.
+struct ComponentRecord {
+    quint32 id;
+    quint32 name;
+    quint32 remote;
+    quint32 developerName;
+};
+
+// For fuzzy search, each component is indexed as a few documents, and scores as the best of them.
+enum SearchField : quint32 {
+    NameField,
+    DeveloperAndNameField,
+    IdField,
+    SearchFieldCount,
+};
+
+// How much trigrams only the query has, and trigrams only a document has, count against a search match.
+constexpr float QUERY_ONLY_WEIGHT = 0.25f;
+constexpr float DOCUMENT_ONLY_WEIGHT = 0.75f;
+
+// A trigram in the search index. Records are sorted by trigram, and each one's postings are a run of
+// document numbers (component * SearchFieldCount + field) in the postings table.
+struct TrigramRecord {
+    quint32 trigram;
+    quint32 postingsOffset;
+    quint32 postingsCount;
+    // The inverse document frequency of the trigram.
+    float weight;
+};
+
+const IndexHeader *indexHeader(const QByteArray &image)
+{
+    return reinterpret_cast<const IndexHeader *>(image.constData());
+}
+
+template<typename T>
+const T *indexTable(const QByteArray &image, quint32 offset)
+{
+    return reinterpret_cast<const T *>(image.constData() + offset);
+}
+
+QByteArrayView indexStrings(const QByteArray &image)
+{
+    const IndexHeader *header = indexHeader(image);
+    return QByteArrayView(image.constData() + header->stringsOffset, header->stringsSize);
+}
+
+QString searchText(const AppStreamIndex::Component &component, SearchField field)
+{
+    switch (field) {
+    case NameField:
+        return component.name;
+    case DeveloperAndNameField:
+        return component.developerName.isEmpty() ? QString() : component.developerName + u' ' + component.name;
+    case IdField:
+        return component.id;
+    case SearchFieldCount:
+        break;
+    }
+    return QString();
+}
+
+// The distinct trigrams of the words in `text`, sorted, each packed into the low 24 bits of an integer.
+// Words are case-folded and split at anything that isn't a letter or a digit, so "org.mozilla.Firefox" and
+// "Mozilla Firefox" share most of theirs. Each word is padded with a space on both sides, so that its first and
+// last letters count as much as the rest. Trigrams are taken over UTF-8 bytes, which is fine for comparing.
+QList<quint32> searchTrigrams(const QString &text)
+{
+    QString normalized = text.toCaseFolded();
+    for (QChar &c : normalized) {
+        if (!c.isLetterOrNumber()) {
+            c = u' ';
+        }
+    }
+
+    QList<quint32> trigrams;
+    const QStringList words = normalized.split(u' ', Qt::SkipEmptyParts);
+    for (const QString &word : words) {
+        const QByteArray padded = ' ' + word.toUtf8() + ' ';
+        for (qsizetype i = 0; i + 2 < padded.size(); ++i) {
+            trigrams.append(quint32(quint8(padded.at(i))) << 16 | quint32(quint8(padded.at(i + 1))) << 8 | quint8(padded.at(i + 2)));
+        }
+    }
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+// Rare trigrams say more about a match than ones most documents have. A trigram no document has is the rarest of all.
+float trigramWeight(quint32 documentFrequency, quint32 documentCount)
+{
+    return std::log(1.0f + float(documentCount) / float(qMax(documentFrequency, 1u)));
+}
+
+QByteArray fileChecksum(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    return hash.result();
+}
+
+// Flatpak's architecture names differ from Qt's in a couple of places.
+QString flatpakArch()
+{
+    const QString arch = QSysInfo::currentCpuArchitecture();
+    if (arch == u"arm64"_s) {
+        return u"aarch64"_s;
+    }
+    return arch;
+}
+
+QStringList flatpakInstallations()
+{
+    return {
+        u"/var/lib/flatpak"_s,
+        QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + u"/flatpak"_s,
+    };
+}
+
+// Flatpak installs a catalogue by pointing the remote's "active" symlink at a new directory, so the directories holding
+// those symlinks are watched, along with the ones new remotes appear in. An installation without any remotes yet is
+// watched for its appstream directory being created.
+void watchCatalogueDirectories(QFileSystemWatcher *watcher)
+{
+    QStringList directories;
+    for (const QString &installation : flatpakInstallations()) {
+        const QDir appstreamDir(installation + u"/appstream"_s);
+        if (!appstreamDir.exists()) {
+            directories.append(installation);
+            continue;
+        }
+
+        directories.append(appstreamDir.absolutePath());
+        const QStringList remotes = appstreamDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QString &remote : remotes) {
+            directories.append(appstreamDir.filePath(remote));
+            directories.append(appstreamDir.filePath(remote + u'/' + flatpakArch()));
+        }
+    }
+
+    const QStringList watched = watcher->directories();
+    for (const QString &directory : std::as_const(directories)) {
+        if (QFileInfo::exists(directory) && !watched.contains(directory)) {
+            watcher->addPath(directory);
+        }
+    }
+}
+
+// The system index currently in use. Readers take a reference to `current` without locking, and refreshes publish a
+// new index by swapping it in, so lookups already running keep using the one they started with.
+struct SharedIndex {
+    std::atomic<std::shared_ptr<const AppStreamIndex>> current;
+
+    // Serialises loading and refreshing, so an older index can't replace a newer one.
+    QMutex refreshMutex;
+};
+
+SharedIndex &sharedIndex()
+{
+    static SharedIndex instance;
+    return instance;
+}
+
+QByteArray readCatalogue(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open AppStream catalogue:" << filePath;
+        return QByteArray();
+    }
+
+    if (!filePath.endsWith(u".gz"_s)) {
+        return file.readAll();
+    }
+
+    StreamDecompressor stream(&file, StreamDecompressor::Format::Gzip);
+    QByteArray data;
+    std::array<char, 64 * 1024> buffer;
+    qint64 bytesRead = 0;
+    while ((bytesRead = stream.read(buffer.data(), buffer.size())) > 0) {
+        data.append(buffer.data(), bytesRead);
+    }
+
+    if (bytesRead < 0) {
+        qWarning() << "Could not decompress AppStream catalogue:" << filePath;
+        return QByteArray();
+    }
+    return data;
+}
+
+// Reads the applications in a catalogue into `components`, skipping any whose ID has already been seen,
+// so that earlier remotes take precedence if an app is available from several.
+void parseCatalogue(const QString &filePath, QList<AppStreamIndex::Component> &components, QSet<QString> &seenIds)
+{
+    const QByteArray data = readCatalogue(filePath);
+    if (data.isEmpty()) {
+        return;
+    }
+
+    // Catalogues live at <installation>/appstream/<remote>/<arch>/active/appstream.xml.gz.
+    const QString remote = filePath.section(u'/', -4, -4);
+
+    QXmlStreamReader xml(data);
+    if (!xml.readNextStartElement() || xml.name() != u"components"_s) {
+        qWarning() << "Not an AppStream catalogue:" << filePath;
+        return;
+    }
+
+    while (xml.readNextStartElement()) {
+        const QStringView type = xml.attributes().value(u"type"_s);
+        if (xml.name() != u"component"_s
+            || (type != u"desktop"_s && type != u"desktop-application"_s && type != u"console-application"_s && type != u"web-application"_s)) {
+            xml.skipCurrentElement();
+            continue;
+        }
+
+        AppStreamIndex::Component component;
+        component.remote = remote;
+
+        while (xml.readNextStartElement()) {
+            if (xml.name() == u"id"_s) {
+                component.id = xml.readElementText();
+            } else if (xml.name() == u"name"_s && !xml.attributes().hasAttribute(u"xml:lang"_s)) {
+                component.name = xml.readElementText();
+            } else if (xml.name() == u"developer_name"_s && !xml.attributes().hasAttribute(u"xml:lang"_s)) {
+                component.developerName = xml.readElementText();
+            } else if (xml.name() == u"developer"_s) {
+                // Newer catalogues replace <developer_name> with <developer><name>.
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == u"name"_s && !xml.attributes().hasAttribute(u"xml:lang"_s)) {
+                        component.developerName = xml.readElementText();
+                    } else {
+                        xml.skipCurrentElement();
+                    }
+                }
+            } else {
+                xml.skipCurrentElement();
+            }
+        }
+
+        // Older catalogues use the desktop file name as the ID.
+        if (component.id.endsWith(u".desktop"_s)) {
+            component.id.chop(8);
+        }
+        if (component.id.isEmpty() || seenIds.contains(component.id)) {
+            continue;
+        }
+
+        seenIds.insert(component.id);
+        components.append(std::move(component));
+    }
+
+    if (xml.hasError()) {
+        qWarning() << "Failed to parse AppStream catalogue" << filePath << "on line" << xml.lineNumber() << ":" << xml.errorString();
+    }
+}
+}
+
+AppStreamIndex::AppStreamIndex(const QStringList &appstreamFiles)
+{
+    setImage(buildImage(appstreamFiles));
+}
+
+QStringList AppStreamIndex::flatpakAppstreamFiles()
+{
+    QStringList files;
+    for (const QString &installation : flatpakInstallations()) {
+        const QDir appstreamDir(installation + u"/appstream"_s);
+        const QStringList remotes = appstreamDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QString &remote : remotes) {
+            const QString filePath = appstreamDir.filePath(u"%1/%2/active/appstream.xml.gz"_s.arg(remote, flatpakArch()));
+            if (QFile::exists(filePath)) {
+                files.append(filePath);
+            }
+        }
+    }
+    return files;
+}
+
+QString AppStreamIndex::cacheFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + u"/appcompatibilityhelper/appstream-index.bin"_s;
+}
+
+std::shared_ptr<const AppStreamIndex> AppStreamIndex::system()
+{
+    // Only the first lookup waits for the index to load. After that, it's an atomic load.
+    static const std::shared_ptr<const AppStreamIndex> loaded = loadSystem();
+    Q_UNUSED(loaded);
+    return sharedIndex().current.load();
+}
+
+void AppStreamIndex::watch()
+{
+    auto *watcher = new QFileSystemWatcher(QCoreApplication::instance());
+    watchCatalogueDirectories(watcher);
+
+    // Wait for changes to settle, since Flatpak updates every remote's catalogue in one go.
+    auto *debounce = new QTimer(watcher);
+    debounce->setSingleShot(true);
+    debounce->setInterval(500ms);
+
+    QObject::connect(watcher, &QFileSystemWatcher::directoryChanged, debounce, qOverload<>(&QTimer::start));
+    QObject::connect(debounce, &QTimer::timeout, watcher, [watcher]() {
+        watchCatalogueDirectories(watcher);
+        QThreadPool::globalInstance()->start([]() {
+            refreshSystem();
+        });
+    });
+}
+
+std::shared_ptr<const AppStreamIndex> AppStreamIndex::loadSystem()
+{
+    const Trace::Span span("AppStreamIndex::system");
+    SharedIndex &shared = sharedIndex();
+    // Held until the index is published, so a refresh started below can't publish first and then be overwritten.
+    const QMutexLocker locker(&shared.refreshMutex);
+    const QStringList appstreamFiles = flatpakAppstreamFiles();
+
+    auto cached = std::make_shared<AppStreamIndex>(fromCacheFile(cacheFilePath()));
+    if (!cached->m_image.isEmpty()) {
+        switch (cached->checkSources(appstreamFiles)) {
+        case SourceState::UpToDate:
+            break;
+        case SourceState::Touched:
+            saveImageInBackground(cached->withRefreshedSourceStamps(appstreamFiles));
+            break;
+        case SourceState::Changed:
+            // Keep answering from the stale cache rather than blocking on a rebuild, and swap the rebuilt index in
+            // once it's ready.
+            QThreadPool::globalInstance()->start([]() {
+                refreshSystem();
+            });
+            break;
+        }
+        shared.current.store(cached);
+        return cached;
+    }
+
+    // There's no usable cache, so this is the only case where we have to wait for the catalogues to be parsed.
+    auto built = std::make_shared<AppStreamIndex>();
+    built->setImage(buildImage(appstreamFiles));
+    saveImageInBackground(built->m_image);
+    shared.current.store(built);
+    return built;
+}
+
+void AppStreamIndex::refreshSystem()
+{
+    SharedIndex &shared = sharedIndex();
+    const QMutexLocker locker(&shared.refreshMutex);
+    const QStringList appstreamFiles = flatpakAppstreamFiles();
+
+    const std::shared_ptr<const AppStreamIndex> current = shared.current.load();
+    if (current && !current->m_image.isEmpty()) {
+        switch (current->checkSources(appstreamFiles)) {
+        case SourceState::UpToDate:
+            return;
+        case SourceState::Touched: {
+            // Publish the refreshed stamps too, so the catalogues aren't checksummed again on every change.
+            auto refreshed = std::make_shared<AppStreamIndex>();
+            if (refreshed->setImage(current->withRefreshedSourceStamps(appstreamFiles))) {
+                saveImageInBackground(refreshed->m_image);
+                shared.current.store(std::move(refreshed));
+            }
+            return;
+        }
+        case SourceState::Changed:
+            break;
+        }
+    }
+
+    auto rebuilt = std::make_shared<AppStreamIndex>();
+    rebuilt->setImage(buildImage(appstreamFiles));
+    saveImageInBackground(rebuilt->m_image);
+    qDebug() << "Rebuilt the AppStream index with" << rebuilt->size() << "applications";
+    shared.current.store(std::move(rebuilt));
+}
+
+QByteArray AppStreamIndex::buildImage(const QStringList &appstreamFiles)
+{
+    const Trace::Span span("AppStreamIndex::buildImage");
+    QList<Component> components;
+    QSet<QString> seenIds;
+    for (const QString &filePath : appstreamFiles) {
+        parseCatalogue(filePath, components, seenIds);
+    }
+
+    BinaryImage::StringPoolWriter strings;
+
+    QList<SourceRecord> sources;
+    for (const QString &filePath : appstreamFiles) {
+        const QFileInfo info(filePath);
+        SourceRecord source = {};
+        source.path = strings.add(filePath.toUtf8());
+        source.size = info.size();
+        source.modified = info.lastModified().toMSecsSinceEpoch();
+        const QByteArray checksum = fileChecksum(filePath);
+        memcpy(source.checksum, checksum.constData(), qMin<qsizetype>(checksum.size(), sizeof(source.checksum)));
+        sources.append(source);
+    }
+
+    QList<ComponentRecord> records;
+    QList<BinaryImage::HashSlot> idEntries;
+    QList<BinaryImage::HashSlot> nameEntries;
+    QList<BinaryImage::HashSlot> suffixEntries;
+    for (quint32 i = 0; i < quint32(components.size()); ++i) {
+        const Component &component = components.at(i);
+        records.append({strings.add(component.id.toUtf8()),
+                        strings.add(component.name.toUtf8()),
+                        strings.add(component.remote.toUtf8()),
+                        strings.add(component.developerName.toUtf8())});
+
+        idEntries.append({BinaryImage::hash(component.id.toUtf8()), i});
+        if (!component.name.isEmpty()) {
+            nameEntries.append({BinaryImage::hash(component.name.toCaseFolded().toUtf8()), i});
+        }
+        suffixEntries.append({BinaryImage::hash(component.id.section(u'.', -1).toCaseFolded().toUtf8()), i});
+    }
+
+    // The search index lists the documents each trigram appears in.
+    const quint32 documentCount = components.size() * SearchFieldCount;
+    QHash<quint32, QList<quint32>> trigramDocuments;
+    QList<QList<quint32>> documentTrigrams(documentCount);
+    for (quint32 document = 0; document < documentCount; ++document) {
+        const Component &component = components.at(document / SearchFieldCount);
+        documentTrigrams[document] = searchTrigrams(searchText(component, SearchField(document % SearchFieldCount)));
+        for (const quint32 trigram : std::as_const(documentTrigrams.at(document))) {
+            trigramDocuments[trigram].append(document);
+        }
+    }
+
+    QList<quint32> trigramKeys = trigramDocuments.keys();
+    std::sort(trigramKeys.begin(), trigramKeys.end());
+    QList<TrigramRecord> trigrams;
+    QList<quint32> postings;
+    for (const quint32 trigram : std::as_const(trigramKeys)) {
+        const QList<quint32> &documents = trigramDocuments[trigram];
+        trigrams.append({trigram, quint32(postings.size()), quint32(documents.size()), trigramWeight(quint32(documents.size()), documentCount)});
+        postings.append(documents);
+    }
+
+    // The total weight of each document's trigrams, which scores are normalised against.
+    QList<float> documentWeights(documentCount, 0.0f);
+    for (quint32 document = 0; document < documentCount; ++document) {
+        for (const quint32 trigram : std::as_const(documentTrigrams.at(document))) {
+            documentWeights[document] += trigramWeight(quint32(trigramDocuments[trigram].size()), documentCount);
+        }
+    }
+
+    const QList<BinaryImage::HashSlot> idTable = BinaryImage::buildHashTable(idEntries);
+    const QList<BinaryImage::HashSlot> nameTable = BinaryImage::buildHashTable(nameEntries);
+    const QList<BinaryImage::HashSlot> suffixTable = BinaryImage::buildHashTable(suffixEntries);
+
+    IndexHeader header = {};
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.componentCount = records.size();
+    header.sourceCount = sources.size();
+
+    QByteArray image(sizeof(IndexHeader), '\0');
+    header.sourcesOffset = BinaryImage::append(image, sources.constData(), sources.size());
+    header.componentsOffset = BinaryImage::append(image, records.constData(), records.size());
+    header.idTableOffset = BinaryImage::append(image, idTable.constData(), idTable.size());
+    header.idTableSize = idTable.size();
+    header.nameTableOffset = BinaryImage::append(image, nameTable.constData(), nameTable.size());
+    header.nameTableSize = nameTable.size();
+    header.suffixTableOffset = BinaryImage::append(image, suffixTable.constData(), suffixTable.size());
+    header.suffixTableSize = suffixTable.size();
+    header.trigramsOffset = BinaryImage::append(image, trigrams.constData(), trigrams.size());
+    header.trigramCount = trigrams.size();
+    header.postingsOffset = BinaryImage::append(image, postings.constData(), postings.size());
+    header.postingCount = postings.size();
+    header.documentWeightsOffset = BinaryImage::append(image, documentWeights.constData(), documentWeights.size());
+    header.stringsOffset = BinaryImage::append(image, strings.data().constData(), strings.data().size());
+    header.stringsSize = strings.data().size();
+
+    memcpy(image.data(), &header, sizeof(header));
+    return image;
+}
+
+AppStreamIndex AppStreamIndex::fromCacheFile(const QString &filePath)
+{
+    AppStreamIndex index;
+
+    auto file = std::make_shared<QFile>(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return index;
+    }
+
+    const qint64 size = file->size();
+    uchar *data = size > 0 ? file->map(0, size) : nullptr;
+    if (!data) {
+        return index;
+    }
+
+    if (!index.setImage(QByteArray::fromRawData(reinterpret_cast<const char *>(data), size))) {
+        qWarning() << "Ignoring corrupt AppStream index cache:" << filePath;
+        return AppStreamIndex();
+    }
+
+    index.m_mappedFile = file;
+    return index;
+}
+
+void AppStreamIndex::saveImageInBackground(const QByteArray &image)
+{
+    QThreadPool::globalInstance()->start([image]() {
+        const QString filePath = cacheFilePath();
+        QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+        // QSaveFile replaces the cache atomically, so other instances never map a half-written file.
+        QSaveFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(image) != image.size() || !file.commit()) {
+            qWarning() << "Could not write AppStream index cache:" << filePath << file.errorString();
+        }
+    });
+}
+
+bool AppStreamIndex::setImage(const QByteArray &image)
+{
+    if (image.size() < qsizetype(sizeof(IndexHeader))) {
+        return false;
+    }
+
+    const IndexHeader *header = indexHeader(image);
+    const auto isPowerOfTwo = [](quint32 value) {
+        return value != 0 && (value & (value - 1)) == 0;
+    };
+
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header->version != INDEX_VERSION
+        || !BinaryImage::fits<SourceRecord>(image.size(), header->sourcesOffset, header->sourceCount)
+        || !BinaryImage::fits<ComponentRecord>(image.size(), header->componentsOffset, header->componentCount)
+        || !BinaryImage::fits<BinaryImage::HashSlot>(image.size(), header->idTableOffset, header->idTableSize)
+        || !BinaryImage::fits<BinaryImage::HashSlot>(image.size(), header->nameTableOffset, header->nameTableSize)
+        || !BinaryImage::fits<BinaryImage::HashSlot>(image.size(), header->suffixTableOffset, header->suffixTableSize)
+        || !BinaryImage::fits<TrigramRecord>(image.size(), header->trigramsOffset, header->trigramCount)
+        || !BinaryImage::fits<quint32>(image.size(), header->postingsOffset, header->postingCount)
+        || header->componentCount > std::numeric_limits<quint32>::max() / SearchFieldCount
+        || !BinaryImage::fits<float>(image.size(), header->documentWeightsOffset, header->componentCount * SearchFieldCount)
+        || !BinaryImage::fits<char>(image.size(), header->stringsOffset, header->stringsSize) || !isPowerOfTwo(header->idTableSize)
+        || !isPowerOfTwo(header->nameTableSize) || !isPowerOfTwo(header->suffixTableSize)) {
+        return false;
+    }
+
+    m_image = image;
+    return true;
+}
+
+AppStreamIndex::SourceState AppStreamIndex::checkSources(const QStringList &appstreamFiles) const
+{
+    const IndexHeader *header = indexHeader(m_image);
+    if (header->sourceCount != quint32(appstreamFiles.size())) {
+        return SourceState::Changed;
+    }
+
+    SourceState state = SourceState::UpToDate;
+    const SourceRecord *sources = indexTable<SourceRecord>(m_image, header->sourcesOffset);
+    for (quint32 i = 0; i < header->sourceCount; ++i) {
+        const SourceRecord &source = sources[i];
+        const QString &filePath = appstreamFiles.at(i);
+        if (BinaryImage::stringAt(indexStrings(m_image), source.path).compare(filePath.toUtf8()) != 0) {
+            return SourceState::Changed;
+        }
+
+        const QFileInfo info(filePath);
+        if (info.size() == source.size && info.lastModified().toMSecsSinceEpoch() == source.modified) {
+            continue;
+        }
+
+        // Flatpak sometimes rewrites catalogues without changing them, so only rebuild if the contents differ.
+        if (fileChecksum(filePath) != QByteArray(source.checksum, sizeof(source.checksum))) {
+            return SourceState::Changed;
+        }
+        state = SourceState::Touched;
+    }
+
+    return state;
+}
+
+QByteArray AppStreamIndex::withRefreshedSourceStamps(const QStringList &appstreamFiles) const
+{
+    // Detach from the mapped file, since that's read-only.
+    QByteArray image(m_image.constData(), m_image.size());
+
+    const IndexHeader *header = indexHeader(image);
+    auto *sources = reinterpret_cast<SourceRecord *>(image.data() + header->sourcesOffset);
+    for (quint32 i = 0; i < header->sourceCount && i < quint32(appstreamFiles.size()); ++i) {
+        const QFileInfo info(appstreamFiles.at(i));
+        sources[i].size = info.size();
+        sources[i].modified = info.lastModified().toMSecsSinceEpoch();
+    }
+
+    return image;
+}
+
+AppStreamIndex::Component AppStreamIndex::componentAt(quint32 index) const
+{
+    const ComponentRecord &record = indexTable<ComponentRecord>(m_image, indexHeader(m_image)->componentsOffset)[index];
+    const QByteArrayView strings = indexStrings(m_image);
+    return Component{
+        QString::fromUtf8(BinaryImage::stringAt(strings, record.id)),
+        QString::fromUtf8(BinaryImage::stringAt(strings, record.name)),
+        QString::fromUtf8(BinaryImage::stringAt(strings, record.remote)),
+        QString::fromUtf8(BinaryImage::stringAt(strings, record.developerName)),
+    };
+}
+
+qsizetype AppStreamIndex::size() const
+{
+    return m_image.isEmpty() ? 0 : indexHeader(m_image)->componentCount;
+}
+
+QByteArray AppStreamIndex::version() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(INDEX_VERSION));
+    if (!m_image.isEmpty()) {
+        const IndexHeader *header = indexHeader(m_image);
+        const SourceRecord *sources = indexTable<SourceRecord>(m_image, header->sourcesOffset);
+        for (quint32 i = 0; i < header->sourceCount; ++i) {
+            hash.addData(BinaryImage::stringAt(indexStrings(m_image), sources[i].path));
+            hash.addData(QByteArrayView(sources[i].checksum, sizeof(sources[i].checksum)));
+        }
+    }
+    return hash.result();
+}
+
+std::optional<AppStreamIndex::Component> AppStreamIndex::findById(const QString &id) const
+{
+    if (m_image.isEmpty()) {
+        return std::nullopt;
+    }
+
+    const IndexHeader *header = indexHeader(m_image);
+    const ComponentRecord *records = indexTable<ComponentRecord>(m_image, header->componentsOffset);
+    const QByteArray key = id.toUtf8();
+
+    const qint64 index = BinaryImage::lookup(indexTable<BinaryImage::HashSlot>(m_image, header->idTableOffset),
+                                             header->idTableSize,
+                                             BinaryImage::hash(key),
+                                             [&](quint32 candidate) {
+                                                 return candidate < header->componentCount
+                                                     && BinaryImage::stringAt(indexStrings(m_image), records[candidate].id).compare(key) == 0;
+                                             });
+    return index >= 0 ? std::optional(componentAt(index)) : std::nullopt;
+}
+
+std::optional<AppStreamIndex::Component> AppStreamIndex::findByName(const QString &name) const
+{
+    if (m_image.isEmpty() || name.isEmpty()) {
+        return std::nullopt;
+    }
+
+    const IndexHeader *header = indexHeader(m_image);
+    const ComponentRecord *records = indexTable<ComponentRecord>(m_image, header->componentsOffset);
+
+    const qint64 index = BinaryImage::lookup(indexTable<BinaryImage::HashSlot>(m_image, header->nameTableOffset),
+                                             header->nameTableSize,
+                                             BinaryImage::hash(name.toCaseFolded().toUtf8()),
+                                             [&](quint32 candidate) {
+                                                 return candidate < header->componentCount
+                                                     && QString::fromUtf8(BinaryImage::stringAt(indexStrings(m_image), records[candidate].name))
+                                                            .compare(name, Qt::CaseInsensitive)
+                                                     == 0;
+                                             });
+    return index >= 0 ? std::optional(componentAt(index)) : std::nullopt;
+}
+
+std::optional<AppStreamIndex::Component> AppStreamIndex::findByIdSuffix(const QString &suffix) const
+{
+    if (m_image.isEmpty() || suffix.isEmpty()) {
+        return std::nullopt;
+    }
+
+    const IndexHeader *header = indexHeader(m_image);
+    const ComponentRecord *records = indexTable<ComponentRecord>(m_image, header->componentsOffset);
+
+    const qint64 index = BinaryImage::lookup(indexTable<BinaryImage::HashSlot>(m_image, header->suffixTableOffset),
+                                             header->suffixTableSize,
+                                             BinaryImage::hash(suffix.toCaseFolded().toUtf8()),
+                                             [&](quint32 candidate) {
+                                                 if (candidate >= header->componentCount) {
+                                                     return false;
+                                                 }
+                                                 const QString id = QString::fromUtf8(BinaryImage::stringAt(indexStrings(m_image), records[candidate].id));
+                                                 return id.section(u'.', -1).compare(suffix, Qt::CaseInsensitive) == 0;
+                                             });
+    return index >= 0 ? std::optional(componentAt(index)) : std::nullopt;
+}
+
+QList<AppStreamIndex::Match> AppStreamIndex::search(const QString &query, qsizetype limit, double threshold) const
+{
+    QList<Match> matches;
+    const QList<quint32> queryTrigrams = searchTrigrams(query);
+    if (m_image.isEmpty() || queryTrigrams.isEmpty() || limit <= 0) {
+        return matches;
+    }
+
+    const IndexHeader *header = indexHeader(m_image);
+    const TrigramRecord *trigrams = indexTable<TrigramRecord>(m_image, header->trigramsOffset);
+    const TrigramRecord *trigramsEnd = trigrams + header->trigramCount;
+    const quint32 *postings = indexTable<quint32>(m_image, header->postingsOffset);
+    const float *documentWeights = indexTable<float>(m_image, header->documentWeightsOffset);
+    const quint32 documentCount = header->componentCount * SearchFieldCount;
+
+    // Sum the weight of the trigrams each document shares with the query, walking each trigram's postings in turn.
+    // Only documents sharing a trigram with the query are touched, and the sums are a flat array indexed by document,
+    // so a query costs a few thousand additions even against all of Flathub.
+    std::vector<float> sharedWeights(documentCount, 0.0f);
+    float queryWeight = 0;
+    for (const quint32 trigram : queryTrigrams) {
+        const TrigramRecord *record = std::lower_bound(trigrams, trigramsEnd, trigram, [](const TrigramRecord &candidate, quint32 key) {
+            return candidate.trigram < key;
+        });
+        if (record == trigramsEnd || record->trigram != trigram || quint64(record->postingsOffset) + record->postingsCount > header->postingCount) {
+            queryWeight += trigramWeight(0, documentCount);
+            continue;
+        }
+
+        queryWeight += record->weight;
+        for (const quint32 *document = postings + record->postingsOffset; document != postings + record->postingsOffset + record->postingsCount; ++document) {
+            if (*document < documentCount) {
+                sharedWeights[*document] += record->weight;
+            }
+        }
+    }
+
+    // Score each component by its best document, using a weighted Tversky index: the shared weight over itself plus
+    // part of the weight each side has that the other doesn't, so that 1 means the same words and 0 means nothing in common.
+    // Packages often add a vendor or edition to the name, e.g. "Zoom Workplace" for "Zoom", so words only the query
+    // has count for less than words only the document has, which are more likely to mean it's another application.
+    QList<std::pair<float, quint32>> candidates;
+    for (quint32 component = 0; component < header->componentCount; ++component) {
+        float score = 0;
+        for (quint32 field = 0; field < SearchFieldCount; ++field) {
+            const quint32 document = component * SearchFieldCount + field;
+            if (sharedWeights[document] > 0) {
+                const float shared = sharedWeights[document];
+                score = std::max(score,
+                                 shared
+                                     / (shared + QUERY_ONLY_WEIGHT * (queryWeight - shared) + DOCUMENT_ONLY_WEIGHT * (documentWeights[document] - shared)));
+            }
+        }
+        if (score > 0 && score >= threshold) {
+            candidates.append({score, component});
+        }
+    }
+
+    // Ties go to the component from the earlier catalogue, like they do for exact lookups.
+    const qsizetype count = qMin(limit, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    for (qsizetype i = 0; i < count; ++i) {
+        matches.append({componentAt(candidates.at(i).second), candidates.at(i).first});
+    }
+    return matches;
+}
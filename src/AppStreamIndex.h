@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+#include <optional>
+
+using namespace Qt::Literals::StringLiterals;
+
+// An index of the applications available from Flatpak remotes, built from the AppStream catalogues
+// Flatpak keeps on disk for each remote. This replaces running `flatpak search` for every lookup.
+//
+// The index is a compact binary image with prebuilt hash tables for exact lookups, and a trigram index for fuzzy search.
+// The system index is cached under
+// ~/.cache/appcompatibilityhelper and memory-mapped on startup, so lookups don't need any parsing.
+// The cache is only rebuilt when a catalogue's modification time and checksum change, and that happens
+// on a worker thread while the previous index keeps being used. The rebuilt index is then swapped in.
+class AppStreamIndex
+{
+public:
+    struct Component {
+        // The application ID, e.g. "org.mozilla.firefox".
+        QString id;
+        // The untranslated application name, e.g. "Firefox".
+        QString name;
+        // The remote the application comes from, e.g. "flathub".
+        QString remote;
+        // The untranslated developer name, e.g. "Mozilla". Often empty.
+        QString developerName;
+    };
+
+    struct Match {
+        Component component;
+        // How closely the component resembles the query, from 0 to 1.
+        double score = 0;
+    };
+
+    AppStreamIndex() = default;
+
+    // Builds an index from the given AppStream catalogues (appstream.xml or appstream.xml.gz), bypassing the cache.
+    explicit AppStreamIndex(const QStringList &appstreamFiles);
+
+    // The catalogues of every remote configured for the system and user Flatpak installations,
+    // e.g. "/var/lib/flatpak/appstream/flathub/x86_64/active/appstream.xml.gz".
+    static QStringList flatpakAppstreamFiles();
+
+    // Where the index of flatpakAppstreamFiles() is cached.
+    static QString cacheFilePath();
+
+    // A shared index of flatpakAppstreamFiles(), loaded from the cache when possible.
+    // Looking it up doesn't take a lock, and callers keep the index they got even if a newer one is swapped in.
+    static std::shared_ptr<const AppStreamIndex> system();
+
+    // Refreshes the system index in the background whenever Flatpak updates a catalogue or adds a remote, so a
+    // long-running process picks up new applications. This must be called from a thread with an event loop.
+    static void watch();
+
+    // Looks up an application by its exact ID.
+    std::optional<Component> findById(const QString &id) const;
+
+    // Looks up an application by its name, ignoring case.
+    std::optional<Component> findByName(const QString &name) const;
+
+    // Looks up an application by the last component of its ID, ignoring case, e.g. "discord" for "com.discordapp.Discord".
+    std::optional<Component> findByIdSuffix(const QString &suffix) const;
+
+    // Ranks applications by how closely their name, ID, or developer and name resemble `query`, best first,
+    // e.g. "Zoom Workplace" finds "us.zoom.Zoom", and "Visual Studio Code" finds "com.visualstudio.code".
+    // Names are compared by the words' trigrams, weighted by how rare they are in the catalogues, so common
+    // words like "org" or "studio" count for less than distinctive ones, and extra words in the query count for
+    // less than extra words in the application's. Returns at most `limit` matches that score at least `threshold`.
+    QList<Match> search(const QString &query, qsizetype limit, double threshold) const;
+
+    qsizetype size() const;
+
+    // Identifies the catalogues this index was built from by their paths and checksums. A stale system() index keeps
+    // the version of the catalogues it was built from until it's replaced, so this is what results based on it depend on.
+    QByteArray version() const;
+
+private:
+    // How a cached index compares to the catalogues it was built from.
+    enum class SourceState {
+        UpToDate,
+        // Modification times differ, but the contents are the same.
+        Touched,
+        Changed,
+    };
+
+    // Loads the system index and publishes it. Returns the index that was published.
+    static std::shared_ptr<const AppStreamIndex> loadSystem();
+
+    // Rebuilds the system index if the catalogues have changed since it was built, and publishes the result.
+    static void refreshSystem();
+
+    // Parses the catalogues and serialises them into an image.
+    static QByteArray buildImage(const QStringList &appstreamFiles);
+
+    // Maps a cache file written by saveImage().
+    static AppStreamIndex fromCacheFile(const QString &filePath);
+
+    // Writes an image to the cache file on a worker thread.
+    static void saveImageInBackground(const QByteArray &image);
+
+    // Validates and adopts an image, returning false if it's corrupt or from an incompatible version.
+    bool setImage(const QByteArray &image);
+
+    SourceState checkSources(const QStringList &appstreamFiles) const;
+
+    // Returns a copy of the image with the recorded modification times and sizes of the catalogues refreshed.
+    QByteArray withRefreshedSourceStamps(const QStringList &appstreamFiles) const;
+
+    Component componentAt(quint32 index) const;
+
+    // Keeps the cache file open while its contents are mapped into m_image.
+    std::shared_ptr<QFile> m_mappedFile;
+    QByteArray m_image;
+};
@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "ArchiveReaders.h"
+#include "StreamDecompressor.h"
+
+#include <QByteArrayView>
+#include <QDebug>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace
+{
+// Members we extract are small text files, so anything bigger than this is skipped rather than held in memory.
+constexpr qint64 MAX_EXTRACTED_MEMBER_SIZE = 16 * 1024 * 1024;
+
+constexpr qint64 CPIO_HEADER_SIZE = 110;
+constexpr quint32 CPIO_MAX_NAME_SIZE = 64 * 1024;
+constexpr quint32 MODE_TYPE_MASK = 0170000;
+constexpr quint32 MODE_REGULAR_FILE = 0100000;
+
+constexpr qint64 TAR_BLOCK_SIZE = 512;
+constexpr qint64 TAR_MAX_EXTENDED_HEADER_SIZE = 1024 * 1024;
+
+constexpr qint64 AR_MAGIC_SIZE = 8;
+constexpr qint64 AR_HEADER_SIZE = 60;
+
+QString normaliseArchivePath(QByteArrayView path)
+{
+    if (path.startsWith("./")) {
+        path = path.sliced(2);
+    }
+    while (path.startsWith('/')) {
+        path = path.sliced(1);
+    }
+    return QString::fromUtf8(path);
+}
+
+// Parses one of the 8 character hexadecimal fields of a "newc" cpio header.
+bool parseCpioField(const char *header, int index, quint32 &value)
+{
+    bool ok = false;
+    value = QByteArrayView(header + 6 + index * 8, 8).toUInt(&ok, 16);
+    return ok;
+}
+
+// Parses a numeric tar header field, which is either NUL/space terminated octal or, for big values, base-256.
+bool parseTarNumber(QByteArrayView field, qint64 &value)
+{
+    value = 0;
+
+    if (!field.isEmpty() && (uchar(field.front()) & 0x80)) {
+        for (qsizetype i = 1; i < field.size(); ++i) {
+            if (value > (std::numeric_limits<qint64>::max() >> 8)) {
+                return false;
+            }
+            value = (value << 8) | uchar(field.at(i));
+        }
+        return true;
+    }
+
+    for (const char c : field) {
+        if (c == '\0' || c == ' ') {
+            if (value != 0) {
+                break;
+            }
+            continue; // Leading padding.
+        }
+        if (c < '0' || c > '7' || value > (std::numeric_limits<qint64>::max() >> 3)) {
+            return false;
+        }
+        value = (value << 3) | (c - '0');
+    }
+    return true;
+}
+
+// Extracts a NUL terminated string field from a tar header.
+QByteArrayView tarString(const char *header, qsizetype offset, qsizetype size)
+{
+    return QByteArrayView(header + offset, qstrnlen(header + offset, size));
+}
+
+// Pulls the "path" and "size" records out of a pax extended header, which overrides the values in the next header.
+// Each record looks like "<length> <key>=<value>\n".
+void parsePaxHeader(QByteArrayView data, QByteArray &path, qint64 &size)
+{
+    while (!data.isEmpty()) {
+        const qsizetype space = data.indexOf(' ');
+        if (space <= 0) {
+            return;
+        }
+
+        bool ok = false;
+        const qsizetype recordLength = data.first(space).toLongLong(&ok);
+        if (!ok || recordLength <= space + 1 || recordLength > data.size()) {
+            return;
+        }
+
+        const QByteArrayView record = data.sliced(space + 1, recordLength - space - 2); // Drop the trailing newline.
+        const qsizetype equals = record.indexOf('=');
+        if (equals > 0) {
+            const QByteArrayView key = record.first(equals);
+            const QByteArrayView value = record.sliced(equals + 1);
+            if (key.compare("path") == 0) {
+                path = value.toByteArray();
+            } else if (key.compare("size") == 0) {
+                qint64 paxSize = value.toLongLong(&ok);
+                if (ok) {
+                    size = paxSize;
+                }
+            }
+        }
+
+        data = data.sliced(recordLength);
+    }
+}
+
+// Reads a member's data into `members`, or skips past it if it's too big to be something we care about.
+bool extractMember(StreamDecompressor &stream, const QString &path, qint64 size, ArchiveMembers &members)
+{
+    if (size > MAX_EXTRACTED_MEMBER_SIZE) {
+        qWarning() << "Skipping oversized archive member:" << path;
+        return stream.skip(size);
+    }
+
+    QByteArray data(size, Qt::Uninitialized);
+    if (!stream.readExactly(data.data(), size)) {
+        return false;
+    }
+
+    members.insert(path, data);
+    return true;
+}
+}
+
+bool walkCpioArchive(StreamDecompressor &stream, const ArchiveMemberFilter &filter, ArchiveMembers &members)
+{
+    std::array<char, CPIO_HEADER_SIZE> header;
+
+    while (true) {
+        if (!stream.readExactly(header.data(), header.size())) {
+            qWarning() << "Truncated cpio archive.";
+            return false;
+        }
+
+        // 070701 is plain "newc", 070702 is the same with checksums.
+        if (qstrncmp(header.data(), "070701", 6) != 0 && qstrncmp(header.data(), "070702", 6) != 0) {
+            qWarning() << "Unsupported cpio archive format:" << QByteArray(header.data(), 6);
+            return false;
+        }
+
+        quint32 mode = 0;
+        quint32 fileSize = 0;
+        quint32 nameSize = 0;
+        if (!parseCpioField(header.data(), 1, mode) || !parseCpioField(header.data(), 6, fileSize) || !parseCpioField(header.data(), 11, nameSize)
+            || nameSize == 0 || nameSize > CPIO_MAX_NAME_SIZE) {
+            qWarning() << "Corrupt cpio header.";
+            return false;
+        }
+
+        // The header and name are padded to a multiple of 4 bytes together, and so is the data.
+        const qint64 namePadding = (4 - (CPIO_HEADER_SIZE + nameSize) % 4) % 4;
+        const qint64 dataPadding = (4 - fileSize % 4) % 4;
+
+        QByteArray name(nameSize + namePadding, Qt::Uninitialized);
+        if (!stream.readExactly(name.data(), name.size())) {
+            qWarning() << "Truncated cpio archive.";
+            return false;
+        }
+        name.truncate(nameSize - 1); // Drop the NUL terminator and padding.
+
+        if (name == "TRAILER!!!") {
+            return true;
+        }
+
+        ArchiveMemberAction action = ArchiveMemberAction::Skip;
+        QString path;
+        if ((mode & MODE_TYPE_MASK) == MODE_REGULAR_FILE) {
+            path = normaliseArchivePath(name);
+            action = filter(path);
+        }
+
+        if (action == ArchiveMemberAction::Stop) {
+            return true;
+        }
+
+        const bool ok = action == ArchiveMemberAction::Extract ? extractMember(stream, path, fileSize, members) && stream.skip(dataPadding)
+                                                               : stream.skip(fileSize + dataPadding);
+        if (!ok) {
+            qWarning() << "Truncated cpio archive.";
+            return false;
+        }
+    }
+}
+
+bool walkTarArchive(StreamDecompressor &stream, const ArchiveMemberFilter &filter, ArchiveMembers &members)
+{
+    std::array<char, TAR_BLOCK_SIZE> header;
+
+    // Set by GNU long name and pax headers, and applied to the header that follows them.
+    QByteArray overridePath;
+    qint64 overrideSize = -1;
+
+    while (true) {
+        if (!stream.readExactly(header.data(), header.size())) {
+            // Some tools leave out the end-of-archive blocks, so running out of data between members is fine.
+            return true;
+        }
+
+        // An all-zero block marks the end of the archive.
+        if (std::all_of(header.cbegin(), header.cend(), [](char c) {
+                return c == '\0';
+            })) {
+            return true;
+        }
+
+        qint64 size = 0;
+        if (!parseTarNumber(QByteArrayView(header.data() + 124, 12), size) || size < 0) {
+            qWarning() << "Corrupt tar header.";
+            return false;
+        }
+        const char type = header[156];
+
+        // GNU long names and pax extended headers carry metadata for the next member in their data.
+        if (type == 'L' || type == 'x') {
+            if (size > TAR_MAX_EXTENDED_HEADER_SIZE) {
+                qWarning() << "Oversized tar extended header.";
+                return false;
+            }
+
+            QByteArray data(size, Qt::Uninitialized);
+            if (!stream.readExactly(data.data(), size) || !stream.skip((TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE)) {
+                qWarning() << "Truncated tar archive.";
+                return false;
+            }
+
+            if (type == 'L') {
+                overridePath = QByteArray(data.constData(), qstrnlen(data.constData(), data.size()));
+            } else {
+                parsePaxHeader(data, overridePath, overrideSize);
+            }
+            continue;
+        }
+
+        QByteArray name;
+        if (!overridePath.isEmpty()) {
+            name = overridePath;
+        } else {
+            name = tarString(header.data(), 0, 100).toByteArray();
+
+            // POSIX ustar splits long paths into a prefix and a name.
+            // GNU tar uses the same space for other fields, but marks itself with "ustar  " instead of "ustar\0".
+            if (qstrncmp(header.data() + 257, "ustar", 6) == 0) {
+                const QByteArrayView prefix = tarString(header.data(), 345, 155);
+                if (!prefix.isEmpty()) {
+                    name = prefix.toByteArray() + '/' + name;
+                }
+            }
+        }
+        if (overrideSize >= 0) {
+            size = overrideSize;
+        }
+        overridePath.clear();
+        overrideSize = -1;
+
+        // Only regular files are of interest; directories, links and the like are skipped.
+        ArchiveMemberAction action = ArchiveMemberAction::Skip;
+        QString path;
+        if (type == '0' || type == '\0' || type == '7') {
+            path = normaliseArchivePath(name);
+            action = filter(path);
+        }
+
+        if (action == ArchiveMemberAction::Stop) {
+            return true;
+        }
+
+        const qint64 dataPadding = (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+        const bool ok = action == ArchiveMemberAction::Extract ? extractMember(stream, path, size, members) && stream.skip(dataPadding)
+                                                               : stream.skip(size + dataPadding);
+        if (!ok) {
+            qWarning() << "Truncated tar archive.";
+            return false;
+        }
+    }
+}
+
+ArArchiveReader::ArArchiveReader(QIODevice *device)
+    : m_device(device)
+{
+    m_valid = m_device->read(AR_MAGIC_SIZE) == "!<arch>\n";
+    if (!m_valid) {
+        qWarning() << "Not an ar archive.";
+    }
+}
+
+bool ArArchiveReader::next()
+{
+    if (!m_valid) {
+        return false;
+    }
+
+    // Member data is padded to an even size.
+    if (m_offset >= 0 && !m_device->seek(m_offset + m_size + (m_size % 2))) {
+        m_valid = false;
+        return false;
+    }
+
+    const QByteArray header = m_device->read(AR_HEADER_SIZE);
+    if (header.size() != AR_HEADER_SIZE) {
+        // The end of the archive.
+        m_valid = false;
+        return false;
+    }
+
+    bool ok = false;
+    m_size = QByteArrayView(header.constData() + 48, 10).trimmed().toLongLong(&ok);
+    if (!ok || m_size < 0 || header.sliced(58, 2) != "`\n") {
+        qWarning() << "Corrupt ar member header.";
+        m_valid = false;
+        return false;
+    }
+
+    // GNU ar terminates names with "/", BSD ar pads them with spaces.
+    QByteArrayView name = QByteArrayView(header.constData(), 16).trimmed();
+    if (name.endsWith('/')) {
+        name.chop(1);
+    }
+
+    m_name = QString::fromUtf8(name);
+    m_offset = m_device->pos();
+    return true;
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QIODevice>
+#include <QString>
+
+#include <functional>
+
+class StreamDecompressor;
+
+// What to do with an archive member, decided from its path before any of its data is read.
+enum class ArchiveMemberAction {
+    Skip,
+    Extract,
+    // Stop walking the archive altogether, e.g. once everything that's needed has been found.
+    Stop,
+};
+
+// Called for each regular file in an archive with its path, normalised to have no leading "./" or "/".
+using ArchiveMemberFilter = std::function<ArchiveMemberAction(const QString &path)>;
+
+// Extracted archive members, keyed by their normalised path.
+using ArchiveMembers = QHash<QString, QByteArray>;
+
+// Walks a "newc" cpio archive (as used in RPM payloads) in a single pass, extracting every member the filter asks for.
+// Returns false if the archive is corrupt, in which case `members` holds whatever was extracted before the error.
+bool walkCpioArchive(StreamDecompressor &stream, const ArchiveMemberFilter &filter, ArchiveMembers &members);
+
+// Walks a tar archive (as used for the members of a .deb package) in a single pass, extracting every member the filter asks for.
+// Understands ustar, GNU long names and pax extended headers.
+// Returns false if the archive is corrupt, in which case `members` holds whatever was extracted before the error.
+bool walkTarArchive(StreamDecompressor &stream, const ArchiveMemberFilter &filter, ArchiveMembers &members);
+
+// Iterates over the members of an ar archive (the container format of .deb packages) without reading their data.
+// Member data can be read from the device between offset() and offset() + size() after each call to next().
+class ArArchiveReader
+{
+public:
+    // The device must already be open and positioned at the start of the archive.
+    explicit ArArchiveReader(QIODevice *device);
+
+    // Advances to the next member, returning false at the end of the archive or if it is corrupt.
+    bool next();
+
+    // The name of the current member, e.g. "data.tar.zst".
+    QString name() const
+    {
+        return m_name;
+    }
+
+    // The offset of the current member's data from the start of the device.
+    qint64 offset() const
+    {
+        return m_offset;
+    }
+
+    // The size of the current member's data.
+    qint64 size() const
+    {
+        return m_size;
+    }
+
+private:
+    QIODevice *m_device;
+    bool m_valid = false;
+
+    QString m_name;
+    qint64 m_offset = -1;
+    qint64 m_size = 0;
+};
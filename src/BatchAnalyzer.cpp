@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "BatchAnalyzer.h"
+#include "CompatibilityHelperFactory.h"
+
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QtConcurrentMap>
+
+int BatchAnalyzer::run(const QStringList &paths, bool json)
+{
+    QStringList files = collectFiles(paths);
+    if (files.isEmpty()) {
+        qWarning() << "No files to analyse.";
+        return 1;
+    }
+
+    QFile output;
+    if (!output.open(stdout, QIODevice::WriteOnly)) {
+        qWarning() << "Could not open standard output.";
+        return 1;
+    }
+    QMutex outputMutex;
+
+    // Each file is independent, so they're spread over the global thread pool, which has a thread per core.
+    QtConcurrent::blockingMap(files, [&](const QString &filePath) {
+        const QVariantMap result = CompatibilityHelperFactory::analyzeFile(filePath);
+
+        QByteArray record;
+        if (json) {
+            record = QJsonDocument(QJsonObject::fromVariantMap(result)).toJson(QJsonDocument::Compact);
+        } else {
+            const QString type = result.value(u"supported"_s).toBool() ? result.value(u"type"_s).toString() : u"unsupported"_s;
+            const QString nativeApp = result.value(u"hasNativeApp"_s).toBool() ? result.value(u"nativeAppRef"_s).toString() : QString();
+            record = u"%1\t%2\t%3"_s.arg(filePath, type, nativeApp.isEmpty() ? u"-"_s : nativeApp).toUtf8();
+        }
+        record.append('\n');
+
+        const QMutexLocker locker(&outputMutex);
+        output.write(record);
+        output.flush();
+    });
+
+    return 0;
+}
+
+QStringList BatchAnalyzer::collectFiles(const QStringList &paths)
+{
+    QStringList files;
+    for (const QString &path : paths) {
+        const QFileInfo info(path);
+        if (info.isFile()) {
+            files.append(info.absoluteFilePath());
+        } else if (info.isDir()) {
+            QDirIterator it(info.absoluteFilePath(), QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                files.append(it.next());
+            }
+        } else {
+            qWarning() << "Skipping" << path << "as it isn't a file or directory.";
+        }
+    }
+    return files;
+}
@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QStringList>
+#include <QVariantMap>
+
+// Analyses many files without a GUI, e.g. to pre-scan a Downloads folder.
+class BatchAnalyzer
+{
+public:
+    // Analyses every file in `paths` in parallel, descending into directories, and prints one record per file to stdout
+    // as soon as it's done. Records are JSON objects, one per line, if `json` is set, or "<file>\t<type>\t<native app>" otherwise.
+    // Returns the exit code for the process.
+    static int run(const QStringList &paths, bool json);
+
+private:
+    // Expands directories into the regular files inside them, recursively.
+    static QStringList collectFiles(const QStringList &paths);
+};
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "BinaryImage.h"
+
+#include <QtEndian>
+
+namespace BinaryImage
+{
+QList<HashSlot> buildHashTable(const QList<HashSlot> &entries)
+{
+    quint32 slotCount = 1;
+    while (qsizetype(slotCount) < entries.size() * 2) {
+        slotCount *= 2;
+    }
+
+    QList<HashSlot> table(slotCount);
+    const quint32 mask = slotCount - 1;
+    for (const HashSlot &entry : entries) {
+        quint32 slot = entry.hash & mask;
+        while (table.at(slot).value != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = {entry.hash, entry.value + 1};
+    }
+    return table;
+}
+
+quint32 StringPoolWriter::add(QByteArrayView string)
+{
+    const QByteArray key = string.toByteArray();
+    const auto it = m_offsets.constFind(key);
+    if (it != m_offsets.cend()) {
+        return *it;
+    }
+
+    const quint32 offset = m_data.size();
+    const quint32 length = string.size();
+    m_data.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    m_data.append(string);
+    m_offsets.insert(key, offset);
+    return offset;
+}
+
+QByteArrayView stringAt(QByteArrayView pool, quint32 offset)
+{
+    if (pool.size() < qsizetype(sizeof(quint32)) || offset > pool.size() - sizeof(quint32)) {
+        return QByteArrayView();
+    }
+
+    const quint32 length = qFromUnaligned<quint32>(pool.data() + offset);
+    if (length > pool.size() - offset - sizeof(quint32)) {
+        return QByteArrayView();
+    }
+    return pool.sliced(offset + sizeof(quint32), length);
+}
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+
+// Helpers for the compact binary images we memory-map instead of parsing at startup, like the AppStream index cache.
+// Images are only ever read on the machine that wrote them, so values are stored in native byte order.
+namespace BinaryImage
+{
+// FNV-1a. Unlike qHash, this is stable across processes and Qt versions, so it can be stored in an image.
+inline quint32 hash(QByteArrayView data)
+{
+    quint32 value = 2166136261u;
+    for (const char c : data) {
+        value = (value ^ quint8(c)) * 16777619u;
+    }
+    return value;
+}
+
+// A slot in an open-addressing hash table. `value` is the stored index plus one, so that zero marks an empty slot.
+struct HashSlot {
+    quint32 hash = 0;
+    quint32 value = 0;
+};
+
+// Builds a linear-probing hash table from (hash, index) pairs, sized to a power of two and at most half full.
+QList<HashSlot> buildHashTable(const QList<HashSlot> &entries);
+
+// Probes a table built by buildHashTable(), returning the first index with a matching hash that `matches` accepts, or -1.
+// Tables built by buildHashTable() always have an empty slot, but a corrupt one might not, so at most every slot is probed once.
+template<typename Predicate>
+qint64 lookup(const HashSlot *table, quint32 slotCount, quint32 hash, Predicate matches)
+{
+    if (slotCount == 0) {
+        return -1;
+    }
+
+    const quint32 mask = slotCount - 1;
+    quint32 slot = hash & mask;
+    for (quint32 probe = 0; probe < slotCount; ++probe, slot = (slot + 1) & mask) {
+        const HashSlot &current = table[slot];
+        if (current.value == 0) {
+            return -1;
+        }
+        if (current.hash == hash && matches(current.value - 1)) {
+            return current.value - 1;
+        }
+    }
+
+    return -1;
+}
+
+// Builds a pool of length-prefixed strings, storing each distinct string once.
+class StringPoolWriter
+{
+public:
+    // Returns the offset of the string in the pool.
+    quint32 add(QByteArrayView string);
+
+    const QByteArray &data() const
+    {
+        return m_data;
+    }
+
+private:
+    QHash<QByteArray, quint32> m_offsets;
+    QByteArray m_data;
+};
+
+// Returns the string at `offset` in a pool written by StringPoolWriter, or an empty view if it's out of bounds.
+QByteArrayView stringAt(QByteArrayView pool, quint32 offset);
+
+// Pads `image` to the alignment of T, appends `count` values and returns the offset they were written at.
+template<typename T>
+quint32 append(QByteArray &image, const T *values, qsizetype count)
+{
+    image.append((alignof(T) - image.size() % alignof(T)) % alignof(T), '\0');
+    const quint32 offset = image.size();
+    image.append(reinterpret_cast<const char *>(values), count * sizeof(T));
+    return offset;
+}
+
+// Whether `count` records of type T starting at `offset` fit within an image of `imageSize` bytes, and are suitably aligned.
+template<typename T>
+bool fits(qsizetype imageSize, quint32 offset, quint32 count)
+{
+    return offset % alignof(T) == 0 && qsizetype(offset) <= imageSize && count <= quint64(imageSize - offset) / sizeof(T);
+}
+}
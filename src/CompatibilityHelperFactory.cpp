@@ -2,13 +2,19 @@
 // SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
 
 #include "CompatibilityHelperFactory.h"
+#include "AppImageCompatibilityHelper.h"
 #include "DebCompatibilityHelper.h"
 #include "ICompatibilityHelper.h"
+#include "ResultCache.h"
 #include "RpmCompatibilityHelper.h"
+#include "Trace.h"
 #include "WindowsCompatibilityHelper.h"
 #include "directories.h"
 
 #include <QMimeDatabase>
+#include <QStandardPaths>
+
+#include <memory>
 
 ICompatibilityHelper *CompatibilityHelperFactory::create(const QUrl &filePath)
 {
@@ -16,11 +22,18 @@ ICompatibilityHelper *CompatibilityHelperFactory::create(const QUrl &filePath)
         return nullptr;
     }
 
-    QMimeDatabase mimeDb;
-    QString mimeTypeName = mimeDb.mimeTypeForFile(filePath.toLocalFile()).name();
+    const QString localFilePath = filePath.toLocalFile();
+    const Trace::Span span("CompatibilityHelperFactory::create", localFilePath);
+
+    QString mimeTypeName;
+    {
+        const Trace::Span mimeSpan("QMimeDatabase::mimeTypeForFile");
+        QMimeDatabase mimeDb;
+        mimeTypeName = mimeDb.mimeTypeForFile(localFilePath).name();
+    }
 
     if (mimeTypeName == u"application/x-ms-dos-executable"_s || mimeTypeName == u"application/x-msi"_s || mimeTypeName == u"application/x-ms-shortcut"_s) {
-        return createWindowsCompatibilityHelper(QUrl::fromLocalFile(WINDOWSCOMPATIBILITYHELPER_DB_PATH), filePath);
+        return createWindowsCompatibilityHelper(appDatabaseLayers(), filePath);
     }
 
     if (mimeTypeName == u"application/x-rpm"_s) {
@@ -31,27 +44,74 @@ ICompatibilityHelper *CompatibilityHelperFactory::create(const QUrl &filePath)
         return createDebCompatibilityHelper(filePath);
     }
 
-    // TODO: Create an AppImage compatibility helper.
-    /*if (mimeTypeName == u"application/vnd.appimage"_s || mimeTypeName == u"application/x-iso9660-appimage"_s) {
+    if (mimeTypeName == u"application/vnd.appimage"_s || mimeTypeName == u"application/x-iso9660-appimage"_s) {
         return createAppImageCompatibilityHelper(filePath);
-    }*/
+    }
 
     // This returns when no compatible helper was found for the given file type.
     // At this point, the program should exit.
     return nullptr;
 }
 
-ICompatibilityHelper *CompatibilityHelperFactory::createWindowsCompatibilityHelper(const QUrl &databaseFilePath, const QUrl &openedExePath)
+QVariantMap CompatibilityHelperFactory::analyzeFile(const QString &filePath)
+{
+    const std::unique_ptr<ICompatibilityHelper> helper(create(QUrl::fromLocalFile(filePath)));
+    if (!helper) {
+        return {
+            {u"file"_s, filePath},
+            {u"supported"_s, false},
+        };
+    }
+
+    helper->analyzeNow();
+
+    QVariantMap result = helper->analysisResult();
+    result.insert(u"supported"_s, true);
+    return result;
+}
+
+QStringList CompatibilityHelperFactory::appDatabaseLayers()
 {
-    return new WindowsCompatibilityHelper(databaseFilePath, openedExePath);
+    return {
+        WINDOWSCOMPATIBILITYHELPER_DB_PATH,
+        WINDOWSCOMPATIBILITYHELPER_VENDOR_DB_PATH,
+        QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + u"/appcompatibilityhelper/app_db.json"_s,
+    };
+}
+
+QByteArray CompatibilityHelperFactory::appDatabaseVersion()
+{
+    QByteArray version;
+    const QStringList layers = appDatabaseLayers();
+    for (const QString &layer : layers) {
+        const QByteArray identity = ResultCache::fileIdentity(layer);
+        // Mark which layers exist, so adding or removing an overlay changes the version too.
+        version += identity.isEmpty() ? '-' : '+';
+        version += identity;
+    }
+    return version;
+}
+
+ICompatibilityHelper *CompatibilityHelperFactory::createWindowsCompatibilityHelper(const QStringList &databaseLayers, const QUrl &openedExePath)
+{
+    const Trace::Span span("WindowsCompatibilityHelper::WindowsCompatibilityHelper");
+    return new WindowsCompatibilityHelper(databaseLayers, openedExePath);
 }
 
 ICompatibilityHelper *CompatibilityHelperFactory::createRpmCompatibilityHelper(const QUrl &filePath)
 {
+    const Trace::Span span("RpmCompatibilityHelper::RpmCompatibilityHelper");
     return new RpmCompatibilityHelper(filePath);
 }
 
 ICompatibilityHelper *CompatibilityHelperFactory::createDebCompatibilityHelper(const QUrl &filePath)
 {
+    const Trace::Span span("DebCompatibilityHelper::DebCompatibilityHelper");
     return new DebCompatibilityHelper(filePath);
 }
+
+ICompatibilityHelper *CompatibilityHelperFactory::createAppImageCompatibilityHelper(const QUrl &filePath)
+{
+    const Trace::Span span("AppImageCompatibilityHelper::AppImageCompatibilityHelper");
+    return new AppImageCompatibilityHelper(filePath);
+}
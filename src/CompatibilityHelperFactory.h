@@ -12,8 +12,20 @@ public:
     // In that case, the application should exit.
     static ICompatibilityHelper *create(const QUrl &filePath);
 
+    // Creates a helper for the file, analyses it on the calling thread and returns its analysisResult().
+    // Unsupported files give {"file": ..., "supported": false}.
+    static QVariantMap analyzeFile(const QString &filePath);
+
+    // The layers of the application database, lowest priority first: the shipped database,
+    // the vendor overlay in /etc/appcompatibilityhelper and the user's overlay in ~/.local/share/appcompatibilityhelper.
+    static QStringList appDatabaseLayers();
+
+    // Identifies the current version of the application database layers, for ResultCache.
+    static QByteArray appDatabaseVersion();
+
 private:
-    static ICompatibilityHelper *createWindowsCompatibilityHelper(const QUrl &databaseFilePath, const QUrl &openedExePath);
+    static ICompatibilityHelper *createWindowsCompatibilityHelper(const QStringList &databaseLayers, const QUrl &openedExePath);
     static ICompatibilityHelper *createRpmCompatibilityHelper(const QUrl &filePath);
     static ICompatibilityHelper *createDebCompatibilityHelper(const QUrl &filePath);
+    static ICompatibilityHelper *createAppImageCompatibilityHelper(const QUrl &filePath);
 };
@@ -2,75 +2,341 @@
 // SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
 
 #include "DebCompatibilityHelper.h"
+#include "AppStreamIndex.h"
+#include "ArchiveReaders.h"
+#include "CompatibilityHelperFactory.h"
 #include "PackageUtils.h"
+#include "StreamDecompressor.h"
 
 #include <KIO/ApplicationLauncherJob>
 #include <KIO/CommandLauncherJob>
 #include <KIO/JobUiDelegateFactory>
 #include <KLocalizedContext>
 #include <KLocalizedString>
-#include <QProcess>
+#include <QFile>
+#include <QSet>
+
+#include <algorithm>
+
+namespace
+{
+// The parts of a package's control archive we care about.
+struct DebControl {
+    QString packageName;
+    QString section;
+
+    // Whether the package has an md5sums file listing its contents, and the metainfo and desktop files it lists.
+    bool hasFileList = false;
+    QSet<QString> metainfoFiles;
+    QSet<QString> desktopFiles;
+};
+
+// Parses the "Key: value" fields of a control file.
+// Continuation lines (used by multi-line fields like Description) start with whitespace and are skipped,
+// so only the first line of each field is kept.
+void parseControlFile(const QByteArray &data, DebControl &control)
+{
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.isEmpty() || line.front() == ' ' || line.front() == '\t') {
+            continue;
+        }
+
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0) {
+            continue;
+        }
+
+        const QByteArray key = line.first(colon).trimmed();
+        const QString value = QString::fromUtf8(line.sliced(colon + 1).trimmed());
+
+        if (key.compare("Package", Qt::CaseInsensitive) == 0) {
+            control.packageName = value;
+        } else if (key.compare("Section", Qt::CaseInsensitive) == 0) {
+            control.section = value;
+        }
+    }
+}
+
+// Collects the metainfo and desktop files listed in md5sums, where each line looks like "<md5>  usr/share/metainfo/foo.xml".
+void parseMd5sums(const QByteArray &data, DebControl &control)
+{
+    control.hasFileList = true;
+
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &line : lines) {
+        const qsizetype separator = line.indexOf("  ");
+        if (separator <= 0) {
+            continue;
+        }
+
+        const QString path = QString::fromUtf8(line.sliced(separator + 2));
+        if (isMetainfoPath(path)) {
+            control.metainfoFiles.insert(path.startsWith(u'/') ? path.mid(1) : path);
+        } else if (isDesktopEntryPath(path)) {
+            control.desktopFiles.insert(path.startsWith(u'/') ? path.mid(1) : path);
+        }
+    }
+}
+
+DebControl readDebControl(QFile &packageFile, const QString &archiveName, qint64 offset, qint64 size)
+{
+    DebControl control;
+
+    if (!packageFile.seek(offset)) {
+        return control;
+    }
+
+    StreamDecompressor controlArchive(&packageFile, StreamDecompressor::formatForName(archiveName), size);
+    if (!controlArchive.isValid()) {
+        qWarning() << "Unsupported control archive in DEB package:" << archiveName;
+        return control;
+    }
+
+    ArchiveMembers controlFiles;
+    walkTarArchive(
+        controlArchive,
+        [](const QString &path) {
+            return path == u"control"_s || path == u"md5sums"_s ? ArchiveMemberAction::Extract : ArchiveMemberAction::Skip;
+        },
+        controlFiles);
+
+    parseControlFile(controlFiles.value(u"control"_s), control);
+    if (controlFiles.contains(u"md5sums"_s)) {
+        parseMd5sums(controlFiles.value(u"md5sums"_s), control);
+    }
+
+    return control;
+}
+
+// Tracks a walk through a tarball entering and leaving a directory's files, which tarballs list together.
+struct DirectoryPass {
+    bool entered = false;
+    bool passed = false;
+
+    void update(bool inDirectory)
+    {
+        if (inDirectory) {
+            entered = true;
+        } else if (entered) {
+            passed = true;
+        }
+    }
+
+    // Whether the walk could still reach the directory's files, given the pass over the directory that holds it.
+    // A directory that never turned up can't appear once the walk has left its parent.
+    bool pending(const DirectoryPass &parent) const
+    {
+        return entered ? !passed : !parent.passed;
+    }
+};
+
+// Whether a path inside a package is under usr/share, which holds both the metainfo and applications directories.
+bool isSharedDataPath(QStringView path)
+{
+    if (path.startsWith(u"./")) {
+        path = path.mid(2);
+    } else if (path.startsWith(u'/')) {
+        path = path.mid(1);
+    }
+    return path.startsWith(u"usr/share/");
+}
+
+// Whether the control data alone shows the package isn't something a user would launch,
+// e.g. a library, development files, fonts or a driver.
+// This errs on the side of caution, since a false positive means a real app never gets matched.
+bool isClearlyNotAnApp(const DebControl &control)
+{
+    // Sections can be prefixed with an archive area, e.g. "non-free/kernel".
+    const QString section = control.section.section(u'/', -1);
+    static const QStringList nonAppSections = {u"libs"_s, u"libdevel"_s, u"oldlibs"_s, u"fonts"_s, u"kernel"_s, u"debug"_s, u"doc"_s};
+    if (nonAppSections.contains(section)) {
+        return true;
+    }
+
+    const QString &name = control.packageName;
+    if (name.isEmpty()) {
+        return false;
+    }
+
+    static const QStringList nonAppSuffixes = {u"-dev"_s, u"-dbg"_s, u"-dbgsym"_s, u"-doc"_s, u"-dkms"_s, u"-firmware"_s, u"-headers"_s};
+    for (const QString &suffix : nonAppSuffixes) {
+        if (name.endsWith(suffix)) {
+            return true;
+        }
+    }
+
+    // Only NVIDIA's driver packages are listed, since some of its packages are apps, e.g. "nvidia-settings".
+    static const QStringList nonAppPrefixes = {u"fonts-"_s,
+                                               u"ttf-"_s,
+                                               u"firmware-"_s,
+                                               u"linux-image-"_s,
+                                               u"linux-headers-"_s,
+                                               u"linux-modules-"_s,
+                                               u"nvidia-driver-"_s,
+                                               u"nvidia-kernel-"_s,
+                                               u"xserver-xorg-"_s,
+                                               u"printer-driver-"_s};
+    for (const QString &prefix : nonAppPrefixes) {
+        if (name.startsWith(prefix)) {
+            return true;
+        }
+    }
+
+    // Shared libraries follow the "lib<name><soversion>" convention, e.g. "libssl3".
+    // Checking for the trailing digit avoids catching apps like "librewolf", but some apps starting with "lib"
+    // are versioned too, e.g. LibreOffice's own "libreoffice24.8" packages, so those are left out.
+    static const QStringList appPrefixes = {u"libreoffice"_s, u"librewolf"_s, u"librecad"_s, u"libresprite"_s};
+    if (std::any_of(appPrefixes.cbegin(), appPrefixes.cend(), [&name](const QString &prefix) {
+            return name.startsWith(prefix);
+        })) {
+        return false;
+    }
+    return name.startsWith(u"lib"_s) && name.back().isDigit();
+}
+}
 
 DebCompatibilityHelper::DebCompatibilityHelper(const QUrl &filePath, QObject *parent)
     : ICompatibilityHelper(filePath, parent)
 {
     m_nativeAppName = m_filePath.fileName();
+}
 
-    // Find the name of the data archive (e.g., data.tar.xz, data.tar.zst)
-    QProcess findDataProcess;
-    const QString findDataCommand = u"ar t %1 | grep '^data.tar'"_s.arg(filePath.toLocalFile());
-    findDataProcess.start(u"/bin/sh"_s, QStringList() << u"-c"_s << findDataCommand);
-    findDataProcess.waitForFinished(-1);
-
-    const QString dataArchiveName = QString::fromLocal8Bit(findDataProcess.readAllStandardOutput()).trimmed();
-    if (dataArchiveName.isEmpty()) {
-        qWarning() << "Could not find a data.tar.* archive in the .deb package.";
-        qWarning() << "An alternative native application will not be matched for this RPM package.";
+void DebCompatibilityHelper::analyze()
+{
+    QFile packageFile(m_filePath.toLocalFile());
+    if (!packageFile.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open DEB package:" << m_filePath.toLocalFile();
         return;
     }
 
-    QProcess findFileProcess;
-    const QString findFileCommand = u"ar p %1 %2 | tar -Jt --wildcards \"%3\" \"%4\""_s.arg(filePath.toLocalFile())
-                                        .arg(dataArchiveName)
-                                        .arg("./usr/share/metainfo/*.xml")
-                                        .arg("./usr/local/share/metainfo/*.xml");
-
-    findFileProcess.start(u"/bin/sh"_s, QStringList() << u"-c"_s << findFileCommand);
-    findFileProcess.waitForFinished(-1);
+    // Well-known vendor packages are in the application database, so there's no need to read them at all.
+    // Files are usually named "<package>_<version>_<arch>.deb", so the package name is taken from the file name.
+    const QString fileName = m_filePath.fileName();
+    if (matchKnownPackage({fileName.section(u'_', 0, 0)}, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp)) {
+        return;
+    }
 
-    const QStringList specificFilesToExtract = QString::fromLocal8Bit(findFileProcess.readAllStandardOutput()).trimmed().split(u"\n"_s, Qt::SkipEmptyParts);
+    // .deb packages hold a small control archive followed by the (usually much bigger) data archive.
+    // Read the control archive first, since it can often tell us everything we need.
+    ArArchiveReader package(&packageFile);
+    DebControl control;
+    QString dataArchiveName;
+    qint64 dataArchiveOffset = -1;
+    qint64 dataArchiveSize = 0;
+    while (package.next()) {
+        if (package.name().startsWith(u"control.tar"_s)) {
+            control = readDebControl(packageFile, package.name(), package.offset(), package.size());
+        } else if (package.name().startsWith(u"data.tar"_s)) {
+            dataArchiveName = package.name();
+            dataArchiveOffset = package.offset();
+            dataArchiveSize = package.size();
+            break;
+        }
+    }
 
-    if (specificFilesToExtract.isEmpty()) {
-        m_isAnApp = false; // No metainfo files found, so this is not an application.
+    // The file may have been renamed, so try the name from the control file too.
+    if (!control.packageName.isEmpty() && control.packageName != fileName.section(u'_', 0, 0)
+        && matchKnownPackage({control.packageName}, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp)) {
         return;
     }
 
-    // Extract each metainfo file found in the previous step
-    QStringList metainfoFilesContent;
-    for (const QString &file : specificFilesToExtract) {
-        QProcess extractProcess;
-
-        // Note the -O flag to extract to stdout
-        const QString extractCommand = u"ar p %1 %2 | tar -xJOf - \"%3\""_s.arg(filePath.toLocalFile()).arg(dataArchiveName).arg(file);
+    if (isClearlyNotAnApp(control)) {
+        m_isAnApp = false;
+        return;
+    }
 
-        extractProcess.start(u"/bin/sh"_s, QStringList() << u"-c"_s << extractCommand);
-        extractProcess.waitForFinished(-1);
+    // md5sums lists every file in the package, so if it's there we know exactly which metainfo files to look for.
+    if (control.hasFileList && control.metainfoFiles.isEmpty() && control.desktopFiles.isEmpty()) {
+        m_isAnApp = false; // No metainfo or desktop files found, so this is not an application.
+        return;
+    }
 
-        if (extractProcess.exitCode() != 0) {
-            qWarning() << "Error extracting file:" << extractProcess.readAllStandardError();
-            continue;
-        }
+    if (dataArchiveName.isEmpty()) {
+        qWarning() << "Could not find a data.tar.* archive in the .deb package.";
+        qWarning() << "An alternative native application will not be matched for this DEB package.";
+        return;
+    }
 
-        metainfoFilesContent.append(QString::fromUtf8(extractProcess.readAllStandardOutput()).trimmed());
+    if (!packageFile.seek(dataArchiveOffset)) {
+        qWarning() << "Could not read the data archive of DEB package:" << m_filePath.toLocalFile();
+        return;
     }
 
-    if (metainfoFilesContent.isEmpty()) {
+    StreamDecompressor dataArchive(&packageFile, StreamDecompressor::formatForName(dataArchiveName), dataArchiveSize);
+    if (!dataArchive.isValid()) {
+        qWarning() << "Unsupported data archive in DEB package:" << dataArchiveName;
         qWarning() << "An alternative native application will not be matched for this DEB package.";
-        m_isAnApp = false; // No metainfo files found, so this is not an application.
         return;
     }
 
-    matchFlatpakFromMetainfo(metainfoFilesContent, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp);
+    // Extract all metainfo and desktop files in a single pass over the data archive.
+    // Without a file list, rely on tarballs listing a directory's contents together:
+    // once we've moved past both the metainfo and applications directories nothing else will turn up.
+    // Many tools write tarballs in directory order rather than sorted by name, so either can come first,
+    // and packages often have only one of them, so leaving usr/share also rules out one that never turned up.
+    const qsizetype listedFileCount = control.metainfoFiles.size() + control.desktopFiles.size();
+    DirectoryPass sharedDataDirectory;
+    DirectoryPass metainfoDirectory;
+    DirectoryPass applicationsDirectory;
+    ArchiveMembers extractedFiles;
+    walkTarArchive(
+        dataArchive,
+        [&](const QString &path) {
+            if (control.hasFileList) {
+                if (extractedFiles.size() == listedFileCount) {
+                    return ArchiveMemberAction::Stop;
+                }
+                return control.metainfoFiles.contains(path) || control.desktopFiles.contains(path) ? ArchiveMemberAction::Extract
+                                                                                                    : ArchiveMemberAction::Skip;
+            }
+
+            const bool isMetainfo = isMetainfoPath(path);
+            const bool isDesktopEntry = isDesktopEntryPath(path);
+            sharedDataDirectory.update(isSharedDataPath(path));
+            metainfoDirectory.update(isMetainfo);
+            applicationsDirectory.update(isDesktopEntry);
+            if (isMetainfo || isDesktopEntry) {
+                return ArchiveMemberAction::Extract;
+            }
+            return metainfoDirectory.pending(sharedDataDirectory) || applicationsDirectory.pending(sharedDataDirectory) ? ArchiveMemberAction::Skip
+                                                                                                                        : ArchiveMemberAction::Stop;
+        },
+        extractedFiles);
+
+    if (extractedFiles.isEmpty()) {
+        m_isAnApp = false; // No metainfo or desktop files found, so this is not an application.
+        return;
+    }
+
+    matchFlatpakFromPackageFiles(extractedFiles, control.packageName, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp);
+}
+
+QVariantMap DebCompatibilityHelper::analysisResult() const
+{
+    QVariantMap result = ICompatibilityHelper::analysisResult();
+    result.insert(u"type"_s, u"deb"_s);
+    result.insert(u"isAnApp"_s, m_isAnApp);
+    result.insert(u"hasFlatpakApp"_s, m_hasFlatpakApp);
+    return result;
+}
+
+QByteArray DebCompatibilityHelper::analysisInputsVersion() const
+{
+    return AppStreamIndex::system()->version() + CompatibilityHelperFactory::appDatabaseVersion();
+}
+
+bool DebCompatibilityHelper::restoreAnalysisResult(const QVariantMap &result)
+{
+    if (result.value(u"type"_s).toString() != u"deb"_s) {
+        return false;
+    }
+
+    m_nativeAppName = result.value(u"nativeAppName"_s).toString();
+    m_nativeAppRef = result.value(u"nativeAppRef"_s).toString();
+    m_hasFlatpakApp = result.value(u"hasFlatpakApp"_s).toBool();
+    m_isAnApp = result.value(u"isAnApp"_s).toBool();
+    return true;
 }
 
 QString DebCompatibilityHelper::windowTitle() const
@@ -81,12 +347,12 @@ QString DebCompatibilityHelper::windowTitle() const
 QString DebCompatibilityHelper::heading() const
 {
     if (hasNativeApp()) {
-        if (isNativeAppInstalled()) {
+        if (installState().nativeAppInstalled) {
             return i18n("Open the native version of %1 instead", nativeAppName());
         } else if (m_hasFlatpakApp) {
-            return i18n("Install %1 from %2 instead", nativeAppName(), appStoreName());
+            return i18n("Install %1 from %2 instead", nativeAppName(), installState().appStoreName);
         } else if (m_isAnApp) {
-            return i18n("Search for %1 in %2 instead", nativeAppName(), appStoreName());
+            return i18n("Search for %1 in %2 instead", nativeAppName(), installState().appStoreName);
         }
     } else {
         return i18n("DEB packages are not natively supported on %1", distroName());
@@ -97,7 +363,7 @@ QString DebCompatibilityHelper::heading() const
 
 QString DebCompatibilityHelper::icon() const
 {
-    if (hasNativeApp() && hasIcon(nativeAppRef())) {
+    if (hasNativeApp() && installState().nativeAppHasIcon) {
         return nativeAppRef();
     }
     return u"application-vnd.debian.binary-package"_s;
@@ -108,18 +374,18 @@ QString DebCompatibilityHelper::description() const
     QString desc;
 
     if (hasNativeApp()) {
-        if (isNativeAppInstalled()) {
+        if (installState().nativeAppInstalled) {
             desc = i18n("A native %1 version of %2 is already installed on your system. ", distroName(), nativeAppName());
             desc += i18n("It's recommended to use the native version for better system integration.");
         } else if (m_hasFlatpakApp) {
             desc = i18n("A native %1 version of %2 is available for installation. ", distroName(), nativeAppName());
             desc += i18n("Installing the native version is recommended for better system integration.");
         } else if (m_isAnApp) {
-            desc += i18n("A native %1 version of %2 may be available for installation from %3. ", distroName(), nativeAppName(), appStoreName());
+            desc += i18n("A native %1 version of %2 may be available for installation from %3. ", distroName(), nativeAppName(), installState().appStoreName);
             desc += i18n("Installing the native version is recommended for better system integration.");
         }
     } else {
-        desc = i18n("You can search for alternatives online or in %1.", appStoreName());
+        desc = i18n("You can search for alternatives online or in %1.", installState().appStoreName);
     }
 
     desc += u"<br><br>"_s;
@@ -153,12 +419,12 @@ bool DebCompatibilityHelper::isNativeAppInstalled() const
 
 QString DebCompatibilityHelper::nativeAppActionText() const
 {
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         return i18n("Open %1", nativeAppName());
     } else if (m_hasFlatpakApp) {
         return i18n("Install %1", nativeAppName());
     } else if (m_isAnApp) {
-        return i18n("Search for %1 in %2", nativeAppName(), appStoreName());
+        return i18n("Search for %1 in %2", nativeAppName(), installState().appStoreName);
     }
 
     return QString();
@@ -166,10 +432,10 @@ QString DebCompatibilityHelper::nativeAppActionText() const
 
 QString DebCompatibilityHelper::nativeAppActionIcon() const
 {
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         return nativeAppRef();
     } else {
-        return appStoreIcon();
+        return installState().appStoreIcon;
     }
 }
 
@@ -180,7 +446,7 @@ void DebCompatibilityHelper::nativeAppAction() const
         return;
     }
 
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         openApp(nativeAppRef());
     } else if (m_hasFlatpakApp) {
         openAppInAppStore(nativeAppRef());
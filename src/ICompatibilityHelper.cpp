@@ -2,13 +2,99 @@
 // SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
 
 #include "ICompatibilityHelper.h"
+#include "AnalysisService.h"
+#include "ResultCache.h"
+#include "Trace.h"
 
 #include <KIO/ApplicationLauncherJob>
 #include <KIO/CommandLauncherJob>
 #include <KIO/JobUiDelegateFactory>
 #include <KLocalizedContext>
 #include <KLocalizedString>
+#include <KSycoca>
+#include <QDBusConnection>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QFutureWatcher>
 #include <QIcon>
+#include <QtConcurrentRun>
+
+namespace
+{
+// How long to wait for the analysis service to reply. D-Bus gives up after 25 seconds by default, but analysing a
+// multi-gigabyte package on a slow disk can take minutes, and analysing it again locally would only duplicate the work.
+constexpr int ANALYSIS_REPLY_TIMEOUT_MS = 10 * 60 * 1000;
+}
+
+ICompatibilityHelper::ICompatibilityHelper(QUrl filePath, QObject *parent)
+    : QObject(parent)
+    , m_filePath(filePath)
+{
+    // Loading the service database can be slow on a cold start.
+    const Trace::Span span("KSycoca::self");
+
+    // Installing or removing the native app or compatibility tool changes what should be offered.
+    connect(KSycoca::self(), &KSycoca::databaseChanged, this, [this]() {
+        m_installState.reset();
+        Q_EMIT contentChanged();
+    });
+}
+
+void ICompatibilityHelper::startAnalysis()
+{
+    if (m_analysisStarted) {
+        return;
+    }
+    m_analysisStarted = true;
+
+    // appcompatibilityhelperd already has the databases loaded, so asking it is much quicker than loading them here.
+    // D-Bus starts it if it isn't running. If it isn't installed or fails, the file is analysed locally instead.
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected() || qEnvironmentVariableIsSet("APPCOMPATIBILITYHELPER_NO_DAEMON")) {
+        startLocalAnalysis();
+        return;
+    }
+
+    QDBusMessage call = QDBusMessage::createMethodCall(ANALYSIS_SERVICE_NAME, ANALYSIS_SERVICE_PATH, ANALYSIS_SERVICE_INTERFACE, u"Analyze"_s);
+    call << m_filePath.toLocalFile();
+
+    auto *watcher = new QDBusPendingCallWatcher(bus.asyncCall(call, ANALYSIS_REPLY_TIMEOUT_MS), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+
+        const QDBusPendingReply<QVariantMap> reply = *watcher;
+        if (reply.isError()) {
+            qDebug() << "Analysing locally, as the analysis service is unavailable:" << reply.error().message();
+            startLocalAnalysis();
+            return;
+        }
+        if (!restoreAnalysisResult(reply.value())) {
+            startLocalAnalysis();
+            return;
+        }
+        setReady();
+    });
+}
+
+void ICompatibilityHelper::startLocalAnalysis()
+{
+    auto *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        setReady();
+    });
+    watcher->setFuture(QtConcurrent::run([this]() {
+        analyzeCached();
+    }));
+}
+
+void ICompatibilityHelper::setReady()
+{
+    m_ready = true;
+    m_installState.reset();
+    Q_EMIT readyChanged();
+    Q_EMIT contentChanged();
+}
 
 void ICompatibilityHelper::openAppInAppStore(const QString &ref) const
 {
@@ -31,6 +117,7 @@ void ICompatibilityHelper::openApp(const QString &ref, const QList<QUrl> &urls)
 
 bool ICompatibilityHelper::isAppInstalled(const QString &ref) const
 {
+    const Trace::Span span("KService::serviceByDesktopName", ref);
     KService::Ptr service = KService::serviceByDesktopName(ref);
     return service && service->isValid() && service->isApplication();
 }
@@ -99,6 +186,64 @@ bool ICompatibilityHelper::hasIcon(const QString &ref) const
     return QIcon::hasThemeIcon(ref);
 }
 
+void ICompatibilityHelper::analyzeNow()
+{
+    analyzeCached();
+    m_ready = true;
+    m_installState.reset();
+}
+
+void ICompatibilityHelper::analyzeCached()
+{
+    const QString filePath = m_filePath.toLocalFile();
+    const Trace::Span span("ICompatibilityHelper::analyze", filePath);
+    const QByteArray inputsVersion = analysisInputsVersion();
+    if (inputsVersion.isEmpty()) {
+        analyze();
+        return;
+    }
+
+    std::optional<QVariantMap> cached;
+    {
+        const Trace::Span cacheSpan("ResultCache::lookup");
+        cached = ResultCache::instance().lookup(filePath, inputsVersion);
+    }
+    if (cached && restoreAnalysisResult(*cached)) {
+        return;
+    }
+
+    analyze();
+    ResultCache::instance().store(filePath, inputsVersion, analysisResult());
+}
+
+QVariantMap ICompatibilityHelper::analysisResult() const
+{
+    return {
+        {u"file"_s, m_filePath.toLocalFile()},
+        {u"hasNativeApp"_s, hasNativeApp()},
+        {u"nativeAppName"_s, nativeAppName()},
+        {u"nativeAppRef"_s, nativeAppRef()},
+        {u"nativeAppInstalled"_s, isNativeAppInstalled()},
+        {u"hasCompatibilityTool"_s, hasCompatibilityTool()},
+        {u"compatibilityToolRef"_s, compatibilityToolRef()},
+    };
+}
+
+const ICompatibilityHelper::InstallState &ICompatibilityHelper::installState() const
+{
+    if (!m_installState) {
+        InstallState state;
+        state.nativeAppInstalled = isNativeAppInstalled();
+        state.nativeAppHasIcon = !nativeAppRef().isEmpty() && hasIcon(nativeAppRef());
+        state.compatibilityToolInstalled = isCompatibilityToolInstalled();
+        state.compatibilityToolHasIcon = !compatibilityToolRef().isEmpty() && hasIcon(compatibilityToolRef());
+        state.appStoreName = appStoreName();
+        state.appStoreIcon = appStoreIcon();
+        m_installState = state;
+    }
+    return *m_installState;
+}
+
 // Default implementations for the pure virtual Q_INVOKABLEs in ICompatibilityHelper.
 // These should be overridden in subclasses to provide specific functionality.
 // This is to avoid linker errors as the MOC is not able to resolve these without default implementations.
@@ -7,6 +7,9 @@
 #include <QFile>
 #include <QObject>
 #include <QQmlEngine>
+#include <QVariantMap>
+
+#include <optional>
 
 using namespace Qt::Literals::StringLiterals;
 
@@ -14,43 +17,59 @@ class ICompatibilityHelper : public QObject
 {
     Q_OBJECT
 
+    // Whether the file has been analysed. The helper works out what to offer on a worker thread after startAnalysis(),
+    // and none of the other properties are meaningful until this is true.
+    Q_PROPERTY(bool ready READ isReady NOTIFY readyChanged)
+
     // The window title to show the user.
     // e.g. "Mozilla Firefox — Windows App Support" if they're trying to install the Windows version.
-    Q_PROPERTY(QString windowTitle READ windowTitle CONSTANT)
+    Q_PROPERTY(QString windowTitle READ windowTitle NOTIFY contentChanged)
     // The heading to show the user -- this should be short description of what actions they should take.
     // e.g. "Mozilla Firefox can be installed from Discover" if they're trying to install the Windows version.
-    Q_PROPERTY(QString heading READ heading CONSTANT)
+    Q_PROPERTY(QString heading READ heading NOTIFY contentChanged)
     // The icon to show the user -- this should be the icon of the native application if one is available, or a generic icon if not.
-    Q_PROPERTY(QString icon READ icon CONSTANT)
+    Q_PROPERTY(QString icon READ icon NOTIFY contentChanged)
     // A useful description of the pathways the user has available to them.
     // e.g. describe how they can install Bottles for their .exe, or how they can find a native alternative.
-    Q_PROPERTY(QString description READ description CONSTANT)
+    Q_PROPERTY(QString description READ description NOTIFY contentChanged)
 
     // Indicates if any native (Flatpak) replacement is available.
     // If this is not the case, a generic message should be shown advising the user to find an alternative.
     // It would also indicate to continue with the compatibility tool if one exists.
-    Q_PROPERTY(bool hasNativeApp READ hasNativeApp CONSTANT)
+    Q_PROPERTY(bool hasNativeApp READ hasNativeApp NOTIFY contentChanged)
     // The text to show the user for the action to install or open the native application.
-    Q_PROPERTY(QString nativeAppActionText READ nativeAppActionText CONSTANT)
+    Q_PROPERTY(QString nativeAppActionText READ nativeAppActionText NOTIFY contentChanged)
     // The icon to show the user for the action to install or open the native application.
-    Q_PROPERTY(QString nativeAppActionIcon READ nativeAppActionIcon CONSTANT)
+    Q_PROPERTY(QString nativeAppActionIcon READ nativeAppActionIcon NOTIFY contentChanged)
 
     // Indicates if a compatibility tool exists for the executable.
     // e.g. Bottles for running .exe files, or Gear Lever for running AppImages.
     // This would usually be set with a simple `return true/false` in the subclass.
-    Q_PROPERTY(bool hasCompatibilityTool READ hasCompatibilityTool CONSTANT)
+    Q_PROPERTY(bool hasCompatibilityTool READ hasCompatibilityTool NOTIFY contentChanged)
     // The text to show the user for the action to install or open the compatibility tool.
-    Q_PROPERTY(QString compatibilityToolActionText READ compatibilityToolActionText CONSTANT)
+    Q_PROPERTY(QString compatibilityToolActionText READ compatibilityToolActionText NOTIFY contentChanged)
     // The icon to show the user for the action to install or open the compatibility tool.
-    Q_PROPERTY(QString compatibilityToolActionIcon READ compatibilityToolActionIcon CONSTANT)
+    Q_PROPERTY(QString compatibilityToolActionIcon READ compatibilityToolActionIcon NOTIFY contentChanged)
 
 public:
-    explicit ICompatibilityHelper(QUrl filePath, QObject *parent = nullptr)
-        : QObject(parent)
-        , m_filePath(filePath)
+    explicit ICompatibilityHelper(QUrl filePath, QObject *parent = nullptr);
+    virtual ~ICompatibilityHelper() = default;
+
+    // Asks appcompatibilityhelperd to analyse the file, or runs analyze() on a worker thread if it can't,
+    // and sets ready once analysis has finished.
+    void startAnalysis();
+
+    // Runs analyze() on the calling thread, for headless use where there's no UI to keep responsive.
+    void analyzeNow();
+
+    // A summary of what analysis found, for machine-readable output, e.g. {"type": "rpm", "hasNativeApp": true, ...}.
+    // Unlike the rest of the interface, this doesn't depend on a GUI, so it can be used from any thread.
+    virtual QVariantMap analysisResult() const;
+
+    bool isReady() const
     {
+        return m_ready;
     }
-    virtual ~ICompatibilityHelper() = default;
 
     virtual QString windowTitle() const = 0;
     virtual QString heading() const = 0;
@@ -71,7 +90,32 @@ public:
     // This is a generic action, so it doesn't need to be overridden in subclasses.
     Q_INVOKABLE void openWithAction() const;
 
+Q_SIGNALS:
+    void readyChanged();
+    // Emitted when the text, icons or actions to show may have changed,
+    // i.e. when analysis finishes or applications are installed or removed.
+    void contentChanged();
+
 protected:
+    // Does the expensive work of finding out what to offer for the file, e.g. reading a package and matching it to a Flatpak.
+    // This is run on a worker thread, so it must only set the helper's own members and not touch any GUI state.
+    // The rest of the interface is only used once it has returned.
+    virtual void analyze() = 0;
+
+    // Identifies the state of everything besides the file that analyze() depends on, e.g. the AppStream catalogues,
+    // so that results cached in ResultCache are discarded when it changes. Helpers that return an empty array aren't cached.
+    virtual QByteArray analysisInputsVersion() const
+    {
+        return QByteArray();
+    }
+
+    // Restores the helper's state from a cached analysisResult() instead of running analyze(), returning false if it can't.
+    virtual bool restoreAnalysisResult(const QVariantMap &result)
+    {
+        Q_UNUSED(result)
+        return false;
+    }
+
     // Indicates if the application is already installed on the system, whether the exact application or an alternative.
     // This doesn't need to be exposed to the QML interface, as it is only used internally to determine how to display the native app action.
     virtual bool isNativeAppInstalled() const = 0;
@@ -88,6 +132,26 @@ protected:
     // This doesn't need to be exposed to the QML interface, as it is only used internally to determine how to display the compatibility tool action.
     virtual bool isCompatibilityToolInstalled() const = 0;
 
+    // Provides the reference to the compatibility tool, e.g. "com.usebottles.bottles", or an empty string if there isn't one.
+    virtual QString compatibilityToolRef() const
+    {
+        return QString();
+    }
+
+    // A snapshot of everything about the system that the helper's text, icons and actions depend on.
+    struct InstallState {
+        bool nativeAppInstalled = false;
+        bool nativeAppHasIcon = false;
+        bool compatibilityToolInstalled = false;
+        bool compatibilityToolHasIcon = false;
+        QString appStoreName;
+        QString appStoreIcon;
+    };
+
+    // Returns the install state, which is looked up on first use and reused until KSycoca reports that installed applications changed.
+    // This saves every property getter from doing its own service and icon theme lookups, and keeps them consistent with each other.
+    const InstallState &installState() const;
+
     // Helper to open a reference to an app in the default app store.
     void openAppInAppStore(const QString &ref) const;
 
@@ -111,4 +175,16 @@ protected:
 
     // The file path of the executable/package being opened.
     QUrl m_filePath;
+
+private:
+    // Restores the result of an earlier analysis of the same file if there is one, and runs analyze() otherwise.
+    void analyzeCached();
+
+    void startLocalAnalysis();
+    void setReady();
+
+    bool m_analysisStarted = false;
+    bool m_ready = false;
+
+    mutable std::optional<InstallState> m_installState;
 };
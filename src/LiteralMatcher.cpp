@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "LiteralMatcher.h"
+#include "BinaryImage.h"
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
+
+LiteralMatcher::Tables LiteralMatcher::build(const QList<QByteArray> &literals, QByteArray &image)
+{
+    // Build the trie, with state 0 as the root.
+    std::vector<std::map<quint8, quint32>> children(1);
+    std::vector<QList<quint32>> outputs(1);
+    for (qsizetype i = 0; i < literals.size(); ++i) {
+        if (literals.at(i).isEmpty()) {
+            continue;
+        }
+
+        quint32 state = 0;
+        for (const char c : literals.at(i)) {
+            const auto it = children[state].find(quint8(c));
+            if (it != children[state].end()) {
+                state = it->second;
+                continue;
+            }
+
+            const quint32 next = children.size();
+            children[state].emplace(quint8(c), next);
+            children.emplace_back();
+            outputs.emplace_back();
+            state = next;
+        }
+        outputs[state].append(i);
+    }
+
+    // Work out the fail links breadth-first, so a state's fail state is always finished before it is.
+    std::vector<quint32> fail(children.size(), 0);
+    std::queue<quint32> queue;
+    for (const auto &[byte, child] : children[0]) {
+        queue.push(child);
+    }
+
+    while (!queue.empty()) {
+        const quint32 state = queue.front();
+        queue.pop();
+
+        for (const auto &[byte, child] : children[state]) {
+            quint32 candidate = fail[state];
+            while (candidate != 0 && !children[candidate].contains(byte)) {
+                candidate = fail[candidate];
+            }
+
+            const auto it = children[candidate].find(byte);
+            fail[child] = it != children[candidate].end() && it->second != child ? it->second : 0;
+            outputs[child].append(outputs[fail[child]]);
+            queue.push(child);
+        }
+    }
+
+    // Flatten everything into contiguous tables.
+    QList<State> states(children.size());
+    QList<Transition> transitions;
+    QList<quint32> flatOutputs;
+    for (quint32 state = 0; state < children.size(); ++state) {
+        State &flat = states[state];
+        flat.fail = fail[state];
+
+        flat.firstTransition = transitions.size();
+        flat.transitionCount = children[state].size();
+        for (const auto &[byte, child] : children[state]) {
+            transitions.append({byte, child});
+        }
+
+        flat.firstOutput = flatOutputs.size();
+        flat.outputCount = outputs[state].size();
+        flatOutputs.append(outputs[state]);
+    }
+
+    Tables tables;
+    tables.statesOffset = BinaryImage::append(image, states.constData(), states.size());
+    tables.stateCount = states.size();
+    tables.transitionsOffset = BinaryImage::append(image, transitions.constData(), transitions.size());
+    tables.transitionCount = transitions.size();
+    tables.outputsOffset = BinaryImage::append(image, flatOutputs.constData(), flatOutputs.size());
+    tables.outputCount = flatOutputs.size();
+    return tables;
+}
+
+std::optional<LiteralMatcher> LiteralMatcher::fromImage(QByteArrayView image, const Tables &tables, quint32 literalCount)
+{
+    if (tables.stateCount == 0 || !BinaryImage::fits<State>(image.size(), tables.statesOffset, tables.stateCount)
+        || !BinaryImage::fits<Transition>(image.size(), tables.transitionsOffset, tables.transitionCount)
+        || !BinaryImage::fits<quint32>(image.size(), tables.outputsOffset, tables.outputCount)) {
+        return std::nullopt;
+    }
+
+    LiteralMatcher matcher;
+    matcher.m_states = reinterpret_cast<const State *>(image.data() + tables.statesOffset);
+    matcher.m_stateCount = tables.stateCount;
+    matcher.m_transitions = reinterpret_cast<const Transition *>(image.data() + tables.transitionsOffset);
+    matcher.m_outputs = reinterpret_cast<const quint32 *>(image.data() + tables.outputsOffset);
+
+    // Check every index up front, so matching never has to.
+    for (quint32 i = 0; i < tables.stateCount; ++i) {
+        const State &state = matcher.m_states[i];
+        if (state.fail >= tables.stateCount || state.firstTransition > tables.transitionCount
+            || state.transitionCount > tables.transitionCount - state.firstTransition || state.firstOutput > tables.outputCount
+            || state.outputCount > tables.outputCount - state.firstOutput) {
+            return std::nullopt;
+        }
+    }
+    // Fail links must always lead back to the root, or matching could loop forever.
+    for (quint32 i = 0; i < tables.stateCount; ++i) {
+        quint32 state = i;
+        for (quint32 steps = 0; state != 0; ++steps) {
+            if (steps == tables.stateCount) {
+                return std::nullopt;
+            }
+            state = matcher.m_states[state].fail;
+        }
+    }
+    for (quint32 i = 0; i < tables.transitionCount; ++i) {
+        // Nothing leads back to the root, as 0 means there's no transition.
+        if (matcher.m_transitions[i].target == 0 || matcher.m_transitions[i].target >= tables.stateCount) {
+            return std::nullopt;
+        }
+    }
+    for (quint32 i = 0; i < tables.outputCount; ++i) {
+        if (matcher.m_outputs[i] >= literalCount) {
+            return std::nullopt;
+        }
+    }
+
+    return matcher;
+}
+
+quint32 LiteralMatcher::transition(quint32 state, quint8 byte) const
+{
+    const State &current = m_states[state];
+    const Transition *begin = m_transitions + current.firstTransition;
+    const Transition *end = begin + current.transitionCount;
+    const Transition *it = std::lower_bound(begin, end, byte, [](const Transition &transition, quint8 value) {
+        return transition.byte < value;
+    });
+    return it != end && it->byte == byte ? it->target : 0;
+}
+
+void LiteralMatcher::findAll(QByteArrayView text, QList<bool> &found) const
+{
+    if (m_stateCount == 0) {
+        return;
+    }
+
+    quint32 state = 0;
+    for (const char c : text) {
+        quint32 next = transition(state, quint8(c));
+        while (next == 0 && state != 0) {
+            state = m_states[state].fail;
+            next = transition(state, quint8(c));
+        }
+        state = next;
+
+        const State &current = m_states[state];
+        for (quint32 i = 0; i < current.outputCount; ++i) {
+            found[m_outputs[current.firstOutput + i]] = true;
+        }
+    }
+}
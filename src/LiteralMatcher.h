@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+
+#include <optional>
+
+// An Aho-Corasick automaton that finds which of a set of literal byte strings occur in a text, in a single pass over it.
+// This is used to cheaply rule out most regular expressions before running any of them.
+//
+// The automaton is stored as flat tables inside a binary image (see BinaryImage.h), so a prebuilt one can be
+// memory-mapped and used as is.
+class LiteralMatcher
+{
+public:
+    // Where the automaton's tables are in an image.
+    struct Tables {
+        quint32 statesOffset = 0;
+        quint32 stateCount = 0;
+        quint32 transitionsOffset = 0;
+        quint32 transitionCount = 0;
+        quint32 outputsOffset = 0;
+        quint32 outputCount = 0;
+    };
+
+    LiteralMatcher() = default;
+
+    // Builds an automaton for the given literals and appends its tables to `image`. Empty literals are ignored.
+    static Tables build(const QList<QByteArray> &literals, QByteArray &image);
+
+    // Uses tables written by build(), which must stay valid for the matcher's lifetime.
+    // Returns std::nullopt if they're out of bounds or inconsistent, or refer to literals past `literalCount`.
+    static std::optional<LiteralMatcher> fromImage(QByteArrayView image, const Tables &tables, quint32 literalCount);
+
+    // Sets found[i] for every literal i that occurs in the text. `found` must have at least as many elements as there were literals.
+    void findAll(QByteArrayView text, QList<bool> &found) const;
+
+private:
+    struct State {
+        // The range of this state's transitions, sorted by byte.
+        quint32 firstTransition = 0;
+        quint32 transitionCount = 0;
+        // The state for the longest proper suffix of this state's string that is also a prefix of a literal.
+        quint32 fail = 0;
+        // The range of this state's matches in the outputs, including those inherited through its fail state.
+        quint32 firstOutput = 0;
+        quint32 outputCount = 0;
+    };
+
+    struct Transition {
+        // Only the low byte is used, this is a quint32 so the table has no padding.
+        quint32 byte = 0;
+        quint32 target = 0;
+    };
+
+    // Returns the state reached from `state` on `byte`, or 0 (the root) if there's no transition.
+    quint32 transition(quint32 state, quint8 byte) const;
+
+    const State *m_states = nullptr;
+    quint32 m_stateCount = 0;
+    const Transition *m_transitions = nullptr;
+    const quint32 *m_outputs = nullptr;
+};
@@ -0,0 +1,363 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "MsiPropertyReader.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+constexpr char COMPOUND_FILE_MAGIC[8] = {'\xd0', '\xcf', '\x11', '\xe0', '\xa1', '\xb1', '\x1a', '\xe1'};
+constexpr qint64 HEADER_SIZE = 512;
+constexpr qint64 DIRECTORY_ENTRY_SIZE = 128;
+constexpr quint32 MINI_SECTOR_SIZE = 64;
+constexpr int HEADER_DIFAT_ENTRIES = 109;
+
+constexpr quint32 END_OF_CHAIN = 0xfffffffe;
+constexpr quint8 STREAM_OBJECT = 2;
+constexpr quint8 ROOT_OBJECT = 5;
+
+// The tables an MSI needs are well under this. Anything bigger is treated as corrupt rather than read.
+constexpr quint64 MAX_STREAM_SIZE = 64 * 1024 * 1024;
+constexpr qsizetype MAX_DIRECTORY_ENTRIES = 65536;
+
+// Windows Installer stores the strings of every table once, in the string pool, and refers to them by index.
+// Packages with many strings use three bytes per reference instead of two.
+constexpr quint32 LONG_STRING_REFERENCES = 0x8000;
+constexpr quint32 UTF8_CODEPAGE = 65001;
+
+template<typename T>
+T readLittleEndian(QByteArrayView data, qint64 offset)
+{
+    return qFromLittleEndian<T>(data.constData() + offset);
+}
+
+// Windows Installer packs table and stream names into the private use area, two characters at a time,
+// using an alphabet of 64 characters. Table names are also prefixed with "!".
+QString decodeStreamName(const QString &name)
+{
+    static constexpr char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz._";
+
+    QString decoded;
+    for (const QChar c : name) {
+        const char16_t unicode = c.unicode();
+        if (unicode >= 0x3800 && unicode < 0x4800) {
+            decoded += QLatin1Char(alphabet[(unicode - 0x3800) & 0x3f]);
+            decoded += QLatin1Char(alphabet[((unicode - 0x3800) >> 6) & 0x3f]);
+        } else if (unicode >= 0x4800 && unicode < 0x4840) {
+            decoded += QLatin1Char(alphabet[unicode - 0x4800]);
+        } else if (unicode == 0x4840) {
+            decoded += u'!';
+        } else {
+            decoded += c;
+        }
+    }
+    return decoded;
+}
+
+// Splits the string data into strings using the lengths in the string pool. String 0 is always the empty string.
+QStringList readStringPool(const QByteArray &pool, const QByteArray &data, bool &longReferences)
+{
+    if (pool.size() < 4) {
+        return QStringList();
+    }
+
+    const QByteArrayView poolView(pool);
+    const quint32 codepage = readLittleEndian<quint16>(poolView, 0) | (quint32(readLittleEndian<quint16>(poolView, 2) & ~LONG_STRING_REFERENCES) << 16);
+    longReferences = readLittleEndian<quint16>(poolView, 2) & LONG_STRING_REFERENCES;
+
+    // Strings are in the package's codepage. Product names are nearly always ASCII, so anything that isn't UTF-8
+    // is read as Latin-1, which agrees with the usual Windows-1252 on all but a few punctuation marks.
+    const auto decode = [codepage](QByteArrayView string) {
+        return codepage == UTF8_CODEPAGE ? QString::fromUtf8(string) : QString::fromLatin1(string);
+    };
+
+    QStringList strings = {QString()};
+    qsizetype offset = 0;
+    const qsizetype entryCount = pool.size() / 4;
+    for (qsizetype i = 1; i < entryCount;) {
+        quint32 length = readLittleEndian<quint16>(poolView, i * 4);
+        const quint16 references = readLittleEndian<quint16>(poolView, i * 4 + 2);
+
+        if (length == 0 && references == 0) {
+            // An unused string ID.
+            strings.append(QString());
+            ++i;
+            continue;
+        }
+
+        if (length == 0) {
+            // Strings of 64 KB or more take two entries, the second of which holds the length.
+            if (i + 1 >= entryCount) {
+                break;
+            }
+            length = readLittleEndian<quint16>(poolView, (i + 1) * 4) | (quint32(readLittleEndian<quint16>(poolView, (i + 1) * 4 + 2)) << 16);
+            i += 2;
+        } else {
+            ++i;
+        }
+
+        if (offset + length > data.size()) {
+            break;
+        }
+        strings.append(decode(QByteArrayView(data).sliced(offset, length)));
+        offset += length;
+    }
+    return strings;
+}
+}
+
+MsiPropertyReader::MsiPropertyReader(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+bool MsiPropertyReader::read()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open Windows Installer package:" << m_filePath;
+        return false;
+    }
+
+    // Only the pages that are actually read get loaded, however big the file is.
+    const qint64 size = file.size();
+    const uchar *data = size > HEADER_SIZE ? file.map(0, size) : nullptr;
+    if (!data) {
+        return false;
+    }
+
+    m_image = QByteArrayView(reinterpret_cast<const char *>(data), size);
+    const bool result = readImage();
+    // The mapping goes away with the file.
+    m_image = QByteArrayView();
+    return result;
+}
+
+bool MsiPropertyReader::readImage()
+{
+    // Executables and other files that aren't compound files are expected, so they aren't worth a warning.
+    if (!m_image.startsWith(QByteArrayView(COMPOUND_FILE_MAGIC, sizeof(COMPOUND_FILE_MAGIC)))) {
+        return false;
+    }
+
+    m_sectorShift = readLittleEndian<quint16>(m_image, 0x1e);
+    if ((m_sectorShift != 9 && m_sectorShift != 12) || readLittleEndian<quint16>(m_image, 0x20) != 6) {
+        qWarning() << "Unsupported sector size in Windows Installer package:" << m_filePath;
+        return false;
+    }
+
+    const quint32 firstDirectorySector = readLittleEndian<quint32>(m_image, 0x30);
+    m_miniStreamCutoff = readLittleEndian<quint32>(m_image, 0x38);
+    m_firstMiniFatSector = readLittleEndian<quint32>(m_image, 0x3c);
+    m_nextDifatSector = readLittleEndian<quint32>(m_image, 0x44);
+
+    const quint32 fatSectorCount = readLittleEndian<quint32>(m_image, 0x2c);
+    for (int i = 0; i < HEADER_DIFAT_ENTRIES && quint32(i) < fatSectorCount; ++i) {
+        m_fatSectors.append(readLittleEndian<quint32>(m_image, 0x4c + i * 4));
+    }
+
+    // Read the directory. The entries form a red-black tree by name, but MSIs only have a few dozen of them,
+    // so they're simply listed.
+    const qsizetype sectorSize = qsizetype(1) << m_sectorShift;
+    QList<quint32> directoryChain;
+    for (quint32 position = 0;; ++position) {
+        const QByteArrayView directorySector = sector(chainSector(directoryChain, firstDirectorySector, position));
+        if (directorySector.size() != sectorSize) {
+            break;
+        }
+
+        for (qint64 offset = 0; offset < sectorSize; offset += DIRECTORY_ENTRY_SIZE) {
+            const QByteArrayView entryData = directorySector.sliced(offset, DIRECTORY_ENTRY_SIZE);
+            const quint16 nameSize = readLittleEndian<quint16>(entryData, 0x40);
+            const quint8 type = entryData.at(0x42);
+            if ((type != STREAM_OBJECT && type != ROOT_OBJECT) || nameSize < 2 || nameSize > 64) {
+                continue;
+            }
+
+            DirectoryEntry entry;
+            entry.name = decodeStreamName(QString::fromUtf16(reinterpret_cast<const char16_t *>(entryData.constData()), nameSize / 2 - 1));
+            entry.startSector = readLittleEndian<quint32>(entryData, 0x74);
+            // Version 3 files only use the low half of the size.
+            entry.size = m_sectorShift == 9 ? readLittleEndian<quint32>(entryData, 0x78) : readLittleEndian<quint64>(entryData, 0x78);
+            if (type == ROOT_OBJECT) {
+                m_root = entry;
+            } else {
+                m_directory.append(entry);
+            }
+        }
+
+        if (m_directory.size() > MAX_DIRECTORY_ENTRIES) {
+            return false;
+        }
+    }
+
+    const DirectoryEntry *poolEntry = findStream(u"!_StringPool"_s);
+    const DirectoryEntry *dataEntry = findStream(u"!_StringData"_s);
+    const DirectoryEntry *propertyEntry = findStream(u"!Property"_s);
+    if (!poolEntry || !dataEntry || !propertyEntry) {
+        return false;
+    }
+
+    QByteArray pool;
+    QByteArray stringData;
+    QByteArray properties;
+    if (!readStream(*poolEntry, pool) || !readStream(*dataEntry, stringData) || !readStream(*propertyEntry, properties)) {
+        qWarning() << "Corrupt Windows Installer package:" << m_filePath;
+        return false;
+    }
+
+    bool longReferences = false;
+    const QStringList strings = readStringPool(pool, stringData, longReferences);
+
+    // Tables are stored a column at a time. The Property table has two string columns: Property and Value.
+    const qsizetype referenceSize = longReferences ? 3 : 2;
+    const qsizetype rowCount = properties.size() / (2 * referenceSize);
+    const auto stringAt = [&](qsizetype offset) {
+        quint32 index = readLittleEndian<quint16>(properties, offset);
+        if (longReferences) {
+            index |= quint32(quint8(properties.at(offset + 2))) << 16;
+        }
+        return index < quint32(strings.size()) ? strings.at(index) : QString();
+    };
+    for (qsizetype row = 0; row < rowCount; ++row) {
+        const QString property = stringAt(row * referenceSize);
+        const QString value = stringAt((rowCount + row) * referenceSize);
+        if (!property.isEmpty() && !value.trimmed().isEmpty()) {
+            m_properties.insert(property, value.trimmed());
+        }
+    }
+
+    return !m_properties.isEmpty();
+}
+
+QByteArrayView MsiPropertyReader::sector(quint32 index) const
+{
+    const qint64 offset = (qint64(index) + 1) << m_sectorShift;
+    if (index >= END_OF_CHAIN || offset >= m_image.size()) {
+        return QByteArrayView();
+    }
+    return m_image.sliced(offset, qMin<qint64>(qint64(1) << m_sectorShift, m_image.size() - offset));
+}
+
+quint32 MsiPropertyReader::nextSector(quint32 index)
+{
+    // A corrupt index past the end of the file would otherwise have the DIFAT chain walked, maybe round a loop,
+    // for a FAT sector that can't exist.
+    if (index >= quint64(m_image.size()) >> m_sectorShift) {
+        return END_OF_CHAIN;
+    }
+
+    const quint32 entriesPerSector = (1u << m_sectorShift) / 4;
+    const quint32 fatIndex = index / entriesPerSector;
+
+    // Sectors past the first 109 FAT sectors are listed in the DIFAT chain. Each DIFAT sector ends with the next one.
+    while (fatIndex >= quint32(m_fatSectors.size())) {
+        const QByteArrayView difatSector = sector(m_nextDifatSector);
+        if (difatSector.size() != (qsizetype(1) << m_sectorShift)) {
+            return END_OF_CHAIN;
+        }
+        for (quint32 i = 0; i < entriesPerSector - 1; ++i) {
+            m_fatSectors.append(readLittleEndian<quint32>(difatSector, i * 4));
+        }
+        m_nextDifatSector = readLittleEndian<quint32>(difatSector, (entriesPerSector - 1) * 4);
+    }
+
+    const QByteArrayView fatSector = sector(m_fatSectors.at(fatIndex));
+    if (fatSector.size() != (qsizetype(1) << m_sectorShift)) {
+        return END_OF_CHAIN;
+    }
+    return readLittleEndian<quint32>(fatSector, (index % entriesPerSector) * 4);
+}
+
+quint32 MsiPropertyReader::chainSector(QList<quint32> &chain, quint32 start, quint32 position)
+{
+    if (chain.isEmpty()) {
+        chain.append(start);
+    }
+
+    // A chain can't be longer than the file has sectors, so this also stops on loops.
+    const qsizetype sectorCount = m_image.size() >> m_sectorShift;
+    while (quint32(chain.size()) <= position) {
+        if (chain.last() >= END_OF_CHAIN || chain.size() > sectorCount) {
+            return END_OF_CHAIN;
+        }
+        chain.append(nextSector(chain.last()));
+    }
+    return chain.at(position);
+}
+
+bool MsiPropertyReader::readStream(const DirectoryEntry &entry, QByteArray &data)
+{
+    if (entry.size > MAX_STREAM_SIZE) {
+        return false;
+    }
+    data.resize(entry.size);
+
+    // Small streams are stored in 64 byte sectors inside the mini stream, which is itself a regular chain.
+    const bool isMini = entry.size < m_miniStreamCutoff;
+    const quint32 sectorSize = isMini ? MINI_SECTOR_SIZE : 1u << m_sectorShift;
+
+    QList<quint32> chain;
+    quint32 current = entry.startSector;
+    for (qsizetype offset = 0; offset < data.size(); offset += sectorSize) {
+        QByteArrayView sectorData;
+        if (isMini) {
+            const quint64 miniStreamOffset = quint64(current) * MINI_SECTOR_SIZE;
+            if (current >= END_OF_CHAIN || miniStreamOffset + MINI_SECTOR_SIZE > m_root.size) {
+                return false;
+            }
+            const QByteArrayView miniStreamSector = sector(chainSector(m_miniStreamChain, m_root.startSector, miniStreamOffset >> m_sectorShift));
+            const qsizetype offsetInSector = miniStreamOffset & ((1u << m_sectorShift) - 1);
+            if (miniStreamSector.size() < offsetInSector + MINI_SECTOR_SIZE) {
+                return false;
+            }
+            sectorData = miniStreamSector.sliced(offsetInSector, MINI_SECTOR_SIZE);
+        } else {
+            sectorData = sector(current);
+        }
+
+        const qsizetype length = qMin<qsizetype>(sectorSize, data.size() - offset);
+        if (sectorData.size() < length) {
+            return false;
+        }
+        memcpy(data.data() + offset, sectorData.constData(), length);
+
+        if (isMini) {
+            // The mini FAT is a regular chain of 32-bit entries, one for each mini sector.
+            const quint32 entriesPerSector = (1u << m_sectorShift) / 4;
+            const QByteArrayView miniFatSector = sector(chainSector(m_miniFatChain, m_firstMiniFatSector, current / entriesPerSector));
+            if (miniFatSector.size() != (qsizetype(1) << m_sectorShift)) {
+                return false;
+            }
+            current = readLittleEndian<quint32>(miniFatSector, (current % entriesPerSector) * 4);
+        } else {
+            current = chainSector(chain, entry.startSector, offset / sectorSize + 1);
+        }
+    }
+    return true;
+}
+
+const MsiPropertyReader::DirectoryEntry *MsiPropertyReader::findStream(const QString &name) const
+{
+    for (const DirectoryEntry &entry : m_directory) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+QString MsiPropertyReader::productName() const
+{
+    return m_properties.value(u"ProductName"_s);
+}
+
+QString MsiPropertyReader::manufacturer() const
+{
+    return m_properties.value(u"Manufacturer"_s);
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Reads the Property table of a Windows Installer package, which names the product whatever the file is called.
+//
+// MSI packages are OLE compound files: a small FAT-style filesystem of sectors and streams. The file is memory-mapped,
+// and only the sectors of the directory, the string pool and the Property table are read, which are a tiny part of
+// an MSI next to its embedded cabinets.
+// See https://learn.microsoft.com/en-us/openspecs/windows_protocols/ms-cfb/ and
+// https://learn.microsoft.com/en-us/windows/win32/msi/property-table
+class MsiPropertyReader
+{
+public:
+    explicit MsiPropertyReader(const QString &filePath);
+
+    // Reads the Property table. Returns false if the file isn't an MSI package or doesn't have one.
+    bool read();
+
+    // The product the package installs, e.g. "Google Chrome".
+    QString productName() const;
+
+    // The company that made it, e.g. "Google LLC".
+    QString manufacturer() const;
+
+private:
+    struct DirectoryEntry {
+        QString name;
+        quint32 startSector = 0;
+        quint64 size = 0;
+    };
+
+    // Reads the Property table out of m_image.
+    bool readImage();
+
+    // Returns the data of a sector, or an empty view if it's out of bounds.
+    QByteArrayView sector(quint32 index) const;
+
+    // Returns the sector after `index` in its chain, according to the FAT.
+    quint32 nextSector(quint32 index);
+
+    // Returns the sector at `position` in the chain starting at `start`, remembering the chain walked so far in `chain`.
+    quint32 chainSector(QList<quint32> &chain, quint32 start, quint32 position);
+
+    // Reads a whole stream, from the mini stream if it's small. Returns false if its chain is broken.
+    bool readStream(const DirectoryEntry &entry, QByteArray &data);
+
+    // Finds a stream by its decoded name.
+    const DirectoryEntry *findStream(const QString &name) const;
+
+    QString m_filePath;
+    QByteArrayView m_image;
+
+    quint32 m_sectorShift = 0;
+    quint32 m_miniStreamCutoff = 0;
+
+    // The locations of the FAT sectors, read lazily from the header and the DIFAT chain as they're needed.
+    QList<quint32> m_fatSectors;
+    quint32 m_nextDifatSector = 0;
+
+    quint32 m_firstMiniFatSector = 0;
+    QList<quint32> m_miniFatChain;
+    DirectoryEntry m_root;
+    QList<quint32> m_miniStreamChain;
+
+    QList<DirectoryEntry> m_directory;
+    QHash<QString, QString> m_properties;
+};
@@ -1,50 +1,223 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
 
-#include <QDomDocument>
-#include <QProcess>
-#include <QRegularExpression>
+#include <QXmlStreamReader>
 
+#include "AppDatabase.h"
+#include "AppStreamIndex.h"
+#include "CompatibilityHelperFactory.h"
 #include "PackageUtils.h"
+#include "Trace.h"
 
-void matchFlatpakFromMetainfo(QStringList metainfoFilesContent, QString &nativeAppRef, QString &nativeAppName, bool &hasFlatpakApp, bool &isAnApp)
+namespace
 {
-    // Read and parse the extracted metainfo files.
-    for (const QString &metainfoContent : metainfoFilesContent) {
-        if (metainfoContent.isEmpty()) {
-            continue; // Skip empty contents.
+// How closely a Flatpak's name or ID has to resemble a package's for it to be offered when nothing matches exactly.
+// See AppStreamIndex::search(). This is just low enough to accept "Zoom" for "Zoom Workplace".
+constexpr double FUZZY_MATCH_THRESHOLD = 0.55;
+
+// Whether a path inside a package is a file directly inside one of the given directories, with the given suffix.
+template<size_t N>
+bool isFileInDirectories(QStringView path, const QStringView (&directories)[N], QStringView suffix)
+{
+    if (path.startsWith(u"./")) {
+        path = path.mid(2);
+    } else if (path.startsWith(u'/')) {
+        path = path.mid(1);
+    }
+
+    for (const QStringView directory : directories) {
+        if (path.startsWith(directory) && path.endsWith(suffix) && !path.mid(directory.size()).contains(u'/')) {
+            return true;
         }
+    }
 
-        QDomDocument doc;
+    return false;
+}
 
-        auto parseResult = doc.setContent(metainfoContent);
-        if (!parseResult) {
-            qWarning() << "Failed to parse XML on line" << parseResult.errorLine << "column" << parseResult.errorColumn << ":" << parseResult.errorMessage;
-            continue; // Skip this file if parsing fails.
+// Returns the application most like any of `queries`, if it's close enough to be worth offering.
+std::optional<AppStreamIndex::Component> findClosest(const AppStreamIndex &index, const QStringList &queries)
+{
+    std::optional<AppStreamIndex::Match> best;
+    for (const QString &query : queries) {
+        const QList<AppStreamIndex::Match> matches = index.search(query, 1, FUZZY_MATCH_THRESHOLD);
+        if (!matches.isEmpty() && (!best || matches.first().score > best->score)) {
+            best = matches.first();
         }
+    }
+    return best ? std::optional(best->component) : std::nullopt;
+}
 
-        QDomElement root = doc.documentElement();
-        if (!((root.tagName() == u"component"_s && (root.attribute(u"type"_s) == u"desktop"_s || root.attribute(u"type"_s) == u"desktop-application"_s))
-              || root.tagName() == u"application"_s)) {
-            // This isn't an app or is malformed somehow, so skip it.
+// Returns the name of the program an Exec line runs, e.g. "spotify" for "env LANG=C /usr/bin/spotify %U".
+QString execProgramName(QStringView exec)
+{
+    const QList<QStringView> arguments = exec.split(u' ', Qt::SkipEmptyParts);
+    for (QStringView argument : arguments) {
+        if (argument.startsWith(u'"') && argument.endsWith(u'"') && argument.size() >= 2) {
+            argument = argument.sliced(1, argument.size() - 2);
+        }
+        if (argument == u"env" || argument.contains(u'=')) {
             continue;
         }
+        return argument.sliced(argument.lastIndexOf(u'/') + 1).toString();
+    }
+    return QString();
+}
+}
+
+bool isMetainfoPath(QStringView path)
+{
+    static constexpr QStringView metainfoDirectories[] = {u"usr/share/metainfo/", u"usr/local/share/metainfo/"};
+    return isFileInDirectories(path, metainfoDirectories, u".xml");
+}
+
+bool isDesktopEntryPath(QStringView path)
+{
+    static constexpr QStringView applicationDirectories[] = {u"usr/share/applications/", u"usr/local/share/applications/"};
+    return isFileInDirectories(path, applicationDirectories, u".desktop");
+}
+
+bool matchKnownPackage(const QStringList &names, QString &nativeAppRef, QString &nativeAppName, bool &hasFlatpakApp, bool &isAnApp)
+{
+    const std::shared_ptr<const AppDatabase> database = AppDatabase::shared(CompatibilityHelperFactory::appDatabaseLayers());
+    if (!database) {
+        return false;
+    }
+
+    const std::optional<AppDatabase::Entry> entry = database->matchPackage(names);
+    if (!entry) {
+        return false;
+    }
+
+    nativeAppRef = entry->flatpakId;
+    nativeAppName = entry->name;
+    hasFlatpakApp = true;
+    isAnApp = true;
+    return true;
+}
+
+std::optional<MetainfoComponent> readMetainfoComponent(const QByteArray &metainfo)
+{
+    // Some packages have whitespace before the XML declaration, which the parser rejects.
+    const QByteArrayView trimmed = QByteArrayView(metainfo).trimmed();
+    if (trimmed.isEmpty()) {
+        return std::nullopt;
+    }
+
+    // The reader works on the bytes directly, honouring the declared encoding, without copying them.
+    QXmlStreamReader xml(QByteArray::fromRawData(trimmed.constData(), trimmed.size()));
+    if (!xml.readNextStartElement()) {
+        qWarning() << "Failed to parse metainfo on line" << xml.lineNumber() << ":" << xml.errorString();
+        return std::nullopt;
+    }
+
+    const QStringView type = xml.attributes().value(u"type"_s);
+    if (!((xml.name() == u"component"_s && (type == u"desktop"_s || type == u"desktop-application"_s)) || xml.name() == u"application"_s)) {
+        // This isn't an app or is malformed somehow, so skip it.
+        return std::nullopt;
+    }
+
+    // Only the first <id> and untranslated <name> directly under the root are used.
+    MetainfoComponent component;
+    bool hasId = false;
+    bool hasName = false;
+    while (!(hasId && hasName) && xml.readNextStartElement()) {
+        if (!hasId && xml.name() == u"id"_s) {
+            component.id = xml.readElementText();
+            hasId = true;
+        } else if (!hasName && xml.name() == u"name"_s && !xml.attributes().hasAttribute(u"xml:lang"_s)) {
+            component.name = xml.readElementText();
+            hasName = true;
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
 
-        QDomElement idElement = root.firstChildElement(u"id"_s);
-        QDomElement nameElement = root.firstChildElement(u"name"_s);
+    if (xml.hasError() && !hasId && !hasName) {
+        qWarning() << "Failed to parse metainfo on line" << xml.lineNumber() << ":" << xml.errorString();
+        return std::nullopt;
+    }
+
+    // Older metainfo files use the desktop file name as the ID, e.g. "firefox.desktop".
+    if (component.id.endsWith(u".desktop"_s)) {
+        component.id.chop(8);
+    }
+    return component;
+}
+
+std::optional<DesktopEntry> readDesktopEntry(const QString &path, const QByteArray &data)
+{
+    DesktopEntry entry;
+    const QString fileName = path.section(u'/', -1);
+    entry.id = fileName.endsWith(u".desktop"_s) ? fileName.chopped(8) : fileName;
 
-        if (!idElement.isNull()) {
-            nativeAppRef = idElement.text();
-            // Remove the ".desktop" suffix if it exists
-            QString suffix = u".desktop"_s;
-            if (nativeAppRef.endsWith(suffix)) {
-                nativeAppRef.chop(suffix.length());
+    bool inDesktopEntry = false;
+    bool isApplication = false;
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &rawLine : lines) {
+        const QByteArrayView line = QByteArrayView(rawLine).trimmed();
+        if (line.startsWith('[')) {
+            // Only the main group matters, and it comes first, so later groups like desktop actions end the search.
+            if (inDesktopEntry) {
+                break;
             }
+            inDesktopEntry = line == "[Desktop Entry]";
+            continue;
+        }
+
+        const qsizetype equals = line.indexOf('=');
+        if (!inDesktopEntry || equals <= 0) {
+            continue;
+        }
+
+        // Localised keys like "Name[de]" don't match any of these.
+        const QByteArrayView key = line.first(equals).trimmed();
+        const QString value = QString::fromUtf8(line.sliced(equals + 1).trimmed());
+        if (key == "Type") {
+            isApplication = value == u"Application"_s;
+        } else if (key == "Name") {
+            entry.name = value;
+        } else if (key == "Icon") {
+            // Icons can be given as a path, e.g. "/opt/Spotify/icons/spotify-linux-512.png".
+            entry.icon = value.contains(u'/') ? value.section(u'/', -1).section(u'.', 0, 0) : value;
+        } else if (key == "Exec") {
+            entry.exec = execProgramName(value);
+        } else if (key == "StartupWMClass") {
+            entry.startupWmClass = value;
+        } else if ((key == "NoDisplay" || key == "Hidden") && value == u"true"_s) {
+            // Not a launcher, e.g. a URL handler or a settings module.
+            return std::nullopt;
         }
+    }
+
+    if (!isApplication || entry.name.isEmpty()) {
+        return std::nullopt;
+    }
+    return entry;
+}
 
-        if (!nameElement.isNull()) {
+void matchFlatpakFromMetainfo(const QList<QByteArray> &metainfoFiles,
+                              const QString &packageName,
+                              QString &nativeAppRef,
+                              QString &nativeAppName,
+                              bool &hasFlatpakApp,
+                              bool &isAnApp)
+{
+    const Trace::Span span("matchFlatpakFromMetainfo", packageName);
+
+    // Read the ID and name out of each of the extracted metainfo files.
+    for (const QByteArray &metainfo : metainfoFiles) {
+        const std::optional<MetainfoComponent> component = readMetainfoComponent(metainfo);
+        if (!component) {
+            continue;
+        }
+
+        if (!component->id.isEmpty()) {
+            nativeAppRef = component->id;
+        }
+
+        if (!component->name.isEmpty()) {
             isAnApp = true; // If we have a name (and a metainfo file), we consider this an application.
-            nativeAppName = nameElement.text();
+            nativeAppName = component->name;
         }
     }
 
@@ -52,62 +225,137 @@ void matchFlatpakFromMetainfo(QStringList metainfoFilesContent, QString &nativeA
     // Prioritize searching by m_nativeAppRef as a direct ID match first,
     // then fallback to m_nativeAppName for a name match.
     if (!nativeAppRef.isEmpty() && !nativeAppName.isEmpty()) {
-        QProcess flatpakSearchProcess;
-        QStringList flatpakArgs;
+        const std::shared_ptr<const AppStreamIndex> systemIndex = AppStreamIndex::system();
+        const AppStreamIndex &index = *systemIndex;
+        if (index.size() == 0) {
+            qWarning() << "No Flatpak AppStream catalogues were found.";
+            qWarning() << "An alternative native application will not be matched for this package.";
+            return;
+        }
 
-        // Request both Application ID and Name columns.
-        flatpakArgs << u"search"_s << u"--columns=application:f,name:f"_s;
+        // Strategy:
+        // 1. Try to find an exact match where the Flatpak App ID is identical to m_nativeAppRef.
+        //    If we find an exact ID match this is the strongest candidate.
+        std::optional<AppStreamIndex::Component> component = index.findById(nativeAppRef);
 
-        flatpakArgs << nativeAppRef;
+        // 2. If no exact ID match, try to find a match where the Flatpak's name matches m_nativeAppName.
+        //    This is a fallback or alternative primary match if the ID isn't directly transferable.
+        //    e.g. the Discord RPM has ID "discord.desktop" but the Flatpak has "com.discordapp.Discord".
+        if (!component) {
+            component = index.findByName(nativeAppName);
+        }
 
-        flatpakSearchProcess.start(u"flatpak"_s, flatpakArgs);
-        flatpakSearchProcess.waitForFinished(-1);
+        // 3. Finally, try the package name against the Flatpak's name and the last part of its ID.
+        //    e.g. the "obs-studio" package and "com.obsproject.Studio" won't match, but "spotify" and "Spotify" will.
+        if (!component && !packageName.isEmpty()) {
+            component = index.findByName(packageName);
+            if (!component) {
+                component = index.findByIdSuffix(packageName);
+            }
+        }
 
-        if (flatpakSearchProcess.exitCode() != 0) {
-            qWarning() << "Error executing 'flatpak search' for" << nativeAppRef << ":" << flatpakSearchProcess.readAllStandardError();
-            qWarning() << "An alternative native application will not be matched for this package.";
-            return;
-        } else {
-            QString searchOutput = QString::fromLocal8Bit(flatpakSearchProcess.readAllStandardOutput()).trimmed();
-            QStringList lines = searchOutput.split(u"\n"_s, Qt::SkipEmptyParts);
-
-            // Output format with --columns=application:f,name:f will be:
-            // Application ID           Name
-            // org.kde.kdenlive         Kdenlive
-            // com.spotify.Client       Spotify
-            // ...
-
-            // Remove the header line.
-            if (!lines.isEmpty() && lines.first().startsWith(u"Application ID"_s)) {
-                lines.removeFirst();
+        // 4. Failing all that, take the closest name, e.g. "Zoom" for "Zoom Workplace", if it's close enough.
+        if (!component) {
+            component = findClosest(index, {nativeAppName, packageName});
+        }
+
+        if (component) {
+            hasFlatpakApp = true;
+            nativeAppRef = component->id;
+        }
+    }
+}
+
+void matchFlatpakFromDesktopEntries(const QList<DesktopEntry> &entries,
+                                    const QString &packageName,
+                                    QString &nativeAppRef,
+                                    QString &nativeAppName,
+                                    bool &hasFlatpakApp,
+                                    bool &isAnApp)
+{
+    if (entries.isEmpty()) {
+        return;
+    }
+
+    const Trace::Span span("matchFlatpakFromDesktopEntries", packageName);
+
+    // Anything with a launcher is an application, even if it can't be matched.
+    // Metainfo names the application better than a desktop entry does, so don't replace a name it gave.
+    if (!isAnApp) {
+        isAnApp = true;
+        nativeAppName = entries.first().name;
+    }
+
+    const std::shared_ptr<const AppStreamIndex> systemIndex = AppStreamIndex::system();
+    const AppStreamIndex &index = *systemIndex;
+    if (index.size() == 0) {
+        qWarning() << "No Flatpak AppStream catalogues were found.";
+        qWarning() << "An alternative native application will not be matched for this package.";
+        return;
+    }
+
+    for (const DesktopEntry &entry : entries) {
+        // Strategy:
+        // 1. The desktop file ID is the application ID for anything that follows the AppStream conventions.
+        // 2. The name, e.g. "Spotify".
+        // 3. The window class, icon, program and package names against the last part of Flatpak IDs,
+        //    e.g. "code" for "com.visualstudio.code", which vendors tend to keep consistent between packages.
+        std::optional<AppStreamIndex::Component> component = index.findById(entry.id);
+        if (!component) {
+            component = index.findByName(entry.name);
+        }
+        for (const QString &key : {entry.startupWmClass, entry.icon, entry.exec, packageName}) {
+            if (component) {
+                break;
             }
+            if (!key.isEmpty()) {
+                component = index.findByIdSuffix(key);
+            }
+        }
 
-            for (const QString &line : lines) {
-                QStringList parts = line.split(QRegularExpression(u"\t"_s), Qt::SkipEmptyParts);
-                if (parts.size() >= 2) {
-                    QString currentAppId = parts[0].trimmed();
-                    QString currentName = parts[1].trimmed();
-
-                    // Strategy:
-                    // 1. Try to find an exact match where the Flatpak App ID is identical to m_nativeAppRef
-                    if (!nativeAppRef.isEmpty() && currentAppId == nativeAppRef) {
-                        // If we find an exact ID match this is the strongest candidate.
-                        hasFlatpakApp = true;
-                        nativeAppRef = currentAppId;
-                        break;
-                    }
-
-                    // 2. If no exact ID match, try to find a match where the Flatpak's name matches m_nativeAppName exactly.
-                    //    This is a fallback or alternative primary match if the ID isn't directly transferable.
-                    //    e.g. the Discord RPM has ID "discord.desktop" but the Flatpak has "com.discordapp.Discord".
-                    if (!nativeAppName.isEmpty() && currentName.compare(nativeAppName, Qt::CaseInsensitive) == 0) {
-                        // If we already found an exact ID match, prefer it. Otherwise, consider this.
-                        hasFlatpakApp = true;
-                        nativeAppRef = currentAppId;
-                        break;
-                    }
-                }
+        if (component) {
+            hasFlatpakApp = true;
+            nativeAppRef = component->id;
+            return;
+        }
+    }
+
+    // Nothing matched exactly, so take the closest name, if it's close enough.
+    QStringList names;
+    for (const DesktopEntry &entry : entries) {
+        names.append(entry.name);
+    }
+    if (std::optional<AppStreamIndex::Component> component = findClosest(index, names)) {
+        hasFlatpakApp = true;
+        nativeAppRef = component->id;
+    }
+}
+
+void matchFlatpakFromPackageFiles(const QHash<QString, QByteArray> &files,
+                                  const QString &packageName,
+                                  QString &nativeAppRef,
+                                  QString &nativeAppName,
+                                  bool &hasFlatpakApp,
+                                  bool &isAnApp)
+{
+    QList<QByteArray> metainfoFiles;
+    QList<DesktopEntry> desktopEntries;
+    for (auto it = files.cbegin(); it != files.cend(); ++it) {
+        if (isMetainfoPath(it.key())) {
+            metainfoFiles.append(it.value());
+        } else if (isDesktopEntryPath(it.key())) {
+            if (std::optional<DesktopEntry> entry = readDesktopEntry(it.key(), it.value())) {
+                desktopEntries.append(std::move(*entry));
             }
         }
     }
+
+    if (!metainfoFiles.isEmpty()) {
+        matchFlatpakFromMetainfo(metainfoFiles, packageName, nativeAppRef, nativeAppName, hasFlatpakApp, isAnApp);
+    }
+
+    // Many vendor packages only ship a desktop entry, and some have metainfo with an ID no Flatpak uses.
+    if (!hasFlatpakApp) {
+        matchFlatpakFromDesktopEntries(desktopEntries, packageName, nativeAppRef, nativeAppName, hasFlatpakApp, isAnApp);
+    }
 }
@@ -1,11 +1,86 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 // SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
 
+#pragma once
+
+#include <QByteArray>
 #include <QDebug>
+#include <QHash>
+#include <QList>
 #include <QString>
+#include <QStringView>
+
+#include <optional>
 
 using namespace Qt::Literals::StringLiterals;
 
-// Match a Flatpak application based on an app's metainfo file.
-// This is used to find a corresponding Flatpak application for an RPM/DEB package.
-void matchFlatpakFromMetainfo(QStringList metainfoFilesContent, QString &nativeAppRef, QString &nativeAppName, bool &hasFlatpakApp, bool &isAnApp);
+// Whether a path inside a package is an AppStream metainfo file, e.g. "./usr/share/metainfo/org.mozilla.firefox.metainfo.xml".
+// Accepts paths with or without a leading "/" or "./", since package formats don't agree on one.
+bool isMetainfoPath(QStringView path);
+
+// Whether a path inside a package is an application's desktop entry, e.g. "usr/share/applications/spotify.desktop".
+bool isDesktopEntryPath(QStringView path);
+
+// Match a Flatpak application for a package the application database already knows, e.g. "google-chrome-stable".
+// `names` are the package names it goes by, e.g. the one in its file name and the one in its metadata, not file names.
+// This doesn't read the package, so it's worth trying before anything that does. Returns false if there's no match.
+bool matchKnownPackage(const QStringList &names, QString &nativeAppRef, QString &nativeAppName, bool &hasFlatpakApp, bool &isAnApp);
+
+// The parts of a metainfo file used for matching.
+struct MetainfoComponent {
+    // The component ID without any ".desktop" suffix, e.g. "org.mozilla.firefox".
+    QString id;
+    // The untranslated name, e.g. "Firefox".
+    QString name;
+};
+
+// Reads the ID and untranslated name of a desktop application's metainfo file.
+// The file is parsed as a stream, straight from its bytes, and parsing stops as soon as both have been found,
+// so descriptions, screenshots and release histories are usually never read.
+// Returns std::nullopt if the file isn't for a desktop application or is malformed before either was found.
+std::optional<MetainfoComponent> readMetainfoComponent(const QByteArray &metainfo);
+
+// The parts of a desktop entry used for matching.
+struct DesktopEntry {
+    // The desktop file ID, e.g. "spotify" for "usr/share/applications/spotify.desktop".
+    QString id;
+    // The untranslated name, e.g. "Spotify".
+    QString name;
+    // The icon name, or the file name of the icon without its extension if it's given as a path.
+    QString icon;
+    // The name of the program it runs, e.g. "spotify".
+    QString exec;
+    QString startupWmClass;
+};
+
+// Reads the [Desktop Entry] group of a desktop file at `path`.
+// Returns std::nullopt if it isn't a visible application launcher, e.g. a URL handler with NoDisplay=true.
+std::optional<DesktopEntry> readDesktopEntry(const QString &path, const QByteArray &data);
+
+// Match a Flatpak application based on an app's metainfo files.
+// This is used to find a corresponding Flatpak application for an RPM/DEB package or an AppImage.
+// The package name (e.g. "spotify-client"), if known, is used as an extra key when comparing against Flatpak names and IDs.
+void matchFlatpakFromMetainfo(const QList<QByteArray> &metainfoFiles,
+                              const QString &packageName,
+                              QString &nativeAppRef,
+                              QString &nativeAppName,
+                              bool &hasFlatpakApp,
+                              bool &isAnApp);
+
+// Match a Flatpak application based on a package's desktop entries, for packages without usable metainfo.
+// An application name already found in metainfo is kept.
+void matchFlatpakFromDesktopEntries(const QList<DesktopEntry> &entries,
+                                    const QString &packageName,
+                                    QString &nativeAppRef,
+                                    QString &nativeAppName,
+                                    bool &hasFlatpakApp,
+                                    bool &isAnApp);
+
+// Match a Flatpak application based on the metainfo files and desktop entries extracted from a package, keyed by path.
+// Metainfo is tried first, and desktop entries are used if it doesn't lead to a Flatpak.
+void matchFlatpakFromPackageFiles(const QHash<QString, QByteArray> &files,
+                                  const QString &packageName,
+                                  QString &nativeAppRef,
+                                  QString &nativeAppName,
+                                  bool &hasFlatpakApp,
+                                  bool &isAnApp);
@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "PeVersionReader.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+constexpr quint32 PE_POINTER_OFFSET = 0x3c;
+constexpr qint64 COFF_HEADER_SIZE = 20;
+constexpr qint64 SECTION_HEADER_SIZE = 40;
+constexpr quint16 PE32_MAGIC = 0x10b;
+constexpr quint16 PE32_PLUS_MAGIC = 0x20b;
+constexpr quint32 RESOURCE_DIRECTORY_INDEX = 2;
+
+constexpr quint32 RT_VERSION = 16;
+constexpr quint32 RESOURCE_SUBDIRECTORY = 0x80000000;
+
+// Real version resources are a few KB, and resource directories have at most a few thousand entries.
+// Anything beyond these is treated as corrupt rather than read.
+constexpr quint32 MAX_VERSION_RESOURCE_SIZE = 64 * 1024;
+constexpr quint32 MAX_RESOURCE_DIRECTORY_ENTRIES = 4096;
+
+constexpr quint16 VERSION_TEXT_TYPE = 1;
+
+template<typename T>
+bool readLittleEndian(QByteArrayView data, qint64 offset, T &value)
+{
+    if (offset < 0 || offset + qint64(sizeof(T)) > data.size()) {
+        return false;
+    }
+    value = qFromLittleEndian<T>(data.constData() + offset);
+    return true;
+}
+
+qsizetype alignTo4(qsizetype offset)
+{
+    return (offset + 3) & ~qsizetype(3);
+}
+
+// A node of a VS_VERSIONINFO tree: a key, an optional value and a run of child nodes.
+struct VersionBlock {
+    QString key;
+    QByteArrayView value;
+    QByteArrayView children;
+    // The size of the block including the padding after it.
+    qsizetype size = 0;
+};
+
+// Reads the null-terminated UTF-16 string at the start of `data`, returning the number of bytes it took up.
+qsizetype readUtf16String(QByteArrayView data, QString &string)
+{
+    qsizetype length = 0;
+    while ((length + 1) * 2 <= data.size() && (data.at(length * 2) != 0 || data.at(length * 2 + 1) != 0)) {
+        ++length;
+    }
+    string = QString::fromUtf16(reinterpret_cast<const char16_t *>(data.constData()), length);
+    return qMin((length + 1) * 2, data.size());
+}
+
+bool readVersionBlock(QByteArrayView data, VersionBlock &block)
+{
+    quint16 length = 0;
+    quint16 valueLength = 0;
+    quint16 type = 0;
+    if (!readLittleEndian(data, 0, length) || !readLittleEndian(data, 2, valueLength) || !readLittleEndian(data, 4, type) || length < 6
+        || length > data.size()) {
+        return false;
+    }
+
+    const QByteArrayView blockData = data.first(length);
+    const qsizetype keyEnd = 6 + readUtf16String(blockData.sliced(6), block.key);
+    const qsizetype valueStart = qMin(alignTo4(keyEnd), blockData.size());
+
+    // Text values are measured in characters, but some tools write bytes, so the end of the block bounds them instead.
+    // Blocks with text values don't have children.
+    const bool isText = type == VERSION_TEXT_TYPE && valueLength > 0;
+    const qsizetype valueSize = isText ? blockData.size() - valueStart : qMin<qsizetype>(valueLength, blockData.size() - valueStart);
+    block.value = blockData.sliced(valueStart, valueSize);
+
+    const qsizetype childrenStart = isText ? blockData.size() : qMin(alignTo4(valueStart + valueSize), blockData.size());
+    block.children = blockData.sliced(childrenStart);
+    block.size = qMin(alignTo4(length), data.size());
+    return true;
+}
+}
+
+PeVersionReader::PeVersionReader(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+bool PeVersionReader::read()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open Windows executable:" << m_filePath;
+        return false;
+    }
+
+    // Only the pages that are actually read get loaded, however big the file is.
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data) {
+        return false;
+    }
+
+    m_image = QByteArrayView(reinterpret_cast<const char *>(data), size);
+    const bool result = readImage();
+    // The mapping goes away with the file.
+    m_image = QByteArrayView();
+    return result;
+}
+
+bool PeVersionReader::readImage()
+{
+    // Installers that aren't PE executables (e.g. MSI packages) are expected, so they aren't worth a warning.
+    quint32 peOffset = 0;
+    if (!m_image.startsWith("MZ") || !readLittleEndian(m_image, PE_POINTER_OFFSET, peOffset) || qint64(peOffset) + 4 > m_image.size()
+        || m_image.sliced(peOffset, 4) != QByteArrayView("PE\0\0", 4)) {
+        return false;
+    }
+
+    const qint64 coffHeader = qint64(peOffset) + 4;
+    quint16 optionalHeaderSize = 0;
+    if (!readLittleEndian(m_image, coffHeader + 2, m_sectionCount) || !readLittleEndian(m_image, coffHeader + 16, optionalHeaderSize)) {
+        return false;
+    }
+
+    const qint64 optionalHeader = coffHeader + COFF_HEADER_SIZE;
+    m_sectionTableOffset = optionalHeader + optionalHeaderSize;
+
+    quint16 magic = 0;
+    if (!readLittleEndian(m_image, optionalHeader, magic) || (magic != PE32_MAGIC && magic != PE32_PLUS_MAGIC)) {
+        return false;
+    }
+
+    // The data directories come after the fields that differ in size between PE32 and PE32+.
+    const qint64 directoryCountOffset = optionalHeader + (magic == PE32_MAGIC ? 92 : 108);
+    quint32 directoryCount = 0;
+    quint32 resourceRva = 0;
+    quint32 resourceSize = 0;
+    if (!readLittleEndian(m_image, directoryCountOffset, directoryCount) || directoryCount <= RESOURCE_DIRECTORY_INDEX) {
+        return false;
+    }
+    const qint64 resourceDirectory = directoryCountOffset + 4 + RESOURCE_DIRECTORY_INDEX * 8;
+    if (resourceDirectory + 8 > m_sectionTableOffset || !readLittleEndian(m_image, resourceDirectory, resourceRva)
+        || !readLittleEndian(m_image, resourceDirectory + 4, resourceSize) || resourceRva == 0) {
+        return false;
+    }
+
+    const qint64 resourceOffset = fileOffset(resourceRva);
+    if (resourceOffset < 0) {
+        return false;
+    }
+
+    const QByteArrayView versionInfo = findVersionResource(resourceOffset, resourceSize);
+    if (versionInfo.isEmpty()) {
+        return false;
+    }
+
+    readVersionStrings(versionInfo);
+    return !m_strings.isEmpty();
+}
+
+qint64 PeVersionReader::fileOffset(quint32 rva) const
+{
+    for (quint16 i = 0; i < m_sectionCount; ++i) {
+        const qint64 section = m_sectionTableOffset + i * SECTION_HEADER_SIZE;
+        quint32 virtualSize = 0;
+        quint32 virtualAddress = 0;
+        quint32 rawSize = 0;
+        quint32 rawOffset = 0;
+        if (!readLittleEndian(m_image, section + 8, virtualSize) || !readLittleEndian(m_image, section + 12, virtualAddress)
+            || !readLittleEndian(m_image, section + 16, rawSize) || !readLittleEndian(m_image, section + 20, rawOffset)) {
+            return -1;
+        }
+
+        const quint32 extent = qMax(virtualSize, rawSize);
+        if (rva >= virtualAddress && rva - virtualAddress < extent) {
+            const qint64 offset = qint64(rawOffset) + (rva - virtualAddress);
+            return offset < m_image.size() ? offset : -1;
+        }
+    }
+    return -1;
+}
+
+QByteArrayView PeVersionReader::findVersionResource(qint64 resourceOffset, quint32 resourceSize) const
+{
+    const QByteArrayView resources = m_image.sliced(resourceOffset, qMin<qint64>(resourceSize, m_image.size() - resourceOffset));
+
+    // The resource tree has three levels: type, name and language. Take the first name and language of RT_VERSION.
+    quint32 directory = 0;
+    for (int level = 0; level < 3; ++level) {
+        quint16 namedCount = 0;
+        quint16 idCount = 0;
+        if (!readLittleEndian(resources, directory + 12, namedCount) || !readLittleEndian(resources, directory + 14, idCount)
+            || namedCount + idCount > MAX_RESOURCE_DIRECTORY_ENTRIES) {
+            return QByteArrayView();
+        }
+
+        bool found = false;
+        for (quint32 i = 0; i < quint32(namedCount) + idCount && !found; ++i) {
+            const qint64 entry = qint64(directory) + 16 + i * 8;
+            quint32 id = 0;
+            quint32 offset = 0;
+            if (!readLittleEndian(resources, entry, id) || !readLittleEndian(resources, entry + 4, offset)) {
+                return QByteArrayView();
+            }
+            if (level == 0 && (i < namedCount || id != RT_VERSION)) {
+                continue;
+            }
+
+            found = true;
+            if (level < 2) {
+                if (!(offset & RESOURCE_SUBDIRECTORY)) {
+                    return QByteArrayView();
+                }
+                // Subdirectories always come after their parent, so this can't loop.
+                const quint32 subdirectory = offset & ~RESOURCE_SUBDIRECTORY;
+                if (subdirectory <= directory) {
+                    return QByteArrayView();
+                }
+                directory = subdirectory;
+            } else {
+                if (offset & RESOURCE_SUBDIRECTORY) {
+                    return QByteArrayView();
+                }
+                quint32 dataRva = 0;
+                quint32 dataSize = 0;
+                if (!readLittleEndian(resources, offset, dataRva) || !readLittleEndian(resources, offset + 4, dataSize) || dataSize > MAX_VERSION_RESOURCE_SIZE) {
+                    return QByteArrayView();
+                }
+                const qint64 dataOffset = fileOffset(dataRva);
+                if (dataOffset < 0) {
+                    return QByteArrayView();
+                }
+                return m_image.sliced(dataOffset, qMin<qint64>(dataSize, m_image.size() - dataOffset));
+            }
+        }
+        if (!found) {
+            return QByteArrayView();
+        }
+    }
+    return QByteArrayView();
+}
+
+void PeVersionReader::readVersionStrings(QByteArrayView versionInfo)
+{
+    VersionBlock root;
+    if (!readVersionBlock(versionInfo, root) || root.key != u"VS_VERSION_INFO"_s) {
+        return;
+    }
+
+    // VS_VERSIONINFO -> StringFileInfo -> StringTable (one per language) -> String.
+    for (QByteArrayView children = root.children; !children.isEmpty();) {
+        VersionBlock fileInfo;
+        if (!readVersionBlock(children, fileInfo)) {
+            return;
+        }
+        children = children.sliced(fileInfo.size);
+
+        if (fileInfo.key != u"StringFileInfo"_s) {
+            continue;
+        }
+
+        VersionBlock table;
+        if (!readVersionBlock(fileInfo.children, table)) {
+            return;
+        }
+        for (QByteArrayView strings = table.children; !strings.isEmpty();) {
+            VersionBlock string;
+            if (!readVersionBlock(strings, string)) {
+                return;
+            }
+            strings = strings.sliced(string.size);
+
+            QString value;
+            readUtf16String(string.value, value);
+            if (!value.trimmed().isEmpty()) {
+                m_strings.insert(string.key, value.trimmed());
+            }
+        }
+        return;
+    }
+}
+
+QString PeVersionReader::productName() const
+{
+    return m_strings.value(u"ProductName"_s);
+}
+
+QString PeVersionReader::companyName() const
+{
+    return m_strings.value(u"CompanyName"_s);
+}
+
+QString PeVersionReader::originalFilename() const
+{
+    return m_strings.value(u"OriginalFilename"_s);
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArrayView>
+#include <QHash>
+#include <QString>
+
+// Reads the version resource of a Windows executable, which names the product it belongs to whatever the file is called.
+//
+// The file is memory-mapped, and only the headers, the section table, the resource directory and the version
+// resource itself are read, so this touches a few KB even of installers that are gigabytes in size.
+// See https://learn.microsoft.com/en-us/windows/win32/debug/pe-format and
+// https://learn.microsoft.com/en-us/windows/win32/menurc/vs-versioninfo
+class PeVersionReader
+{
+public:
+    explicit PeVersionReader(const QString &filePath);
+
+    // Reads the version resource. Returns false if the file isn't a PE executable or doesn't have one.
+    bool read();
+
+    // The product the executable belongs to, e.g. "Firefox".
+    QString productName() const;
+
+    // The company that made it, e.g. "Mozilla Corporation".
+    QString companyName() const;
+
+    // The name the executable was built with, e.g. "DiscordSetup.exe".
+    QString originalFilename() const;
+
+private:
+    // Reads the version resource out of m_image.
+    bool readImage();
+
+    // Maps a relative virtual address to a file offset using the section table, returning -1 if no section holds it.
+    qint64 fileOffset(quint32 rva) const;
+
+    // Finds the version resource and returns its data, or an empty view if there isn't one.
+    QByteArrayView findVersionResource(qint64 resourceOffset, quint32 resourceSize) const;
+
+    // Reads the strings of the first string table in a VS_VERSIONINFO block.
+    void readVersionStrings(QByteArrayView versionInfo);
+
+    QString m_filePath;
+    QByteArrayView m_image;
+
+    qint64 m_sectionTableOffset = 0;
+    quint16 m_sectionCount = 0;
+
+    QHash<QString, QString> m_strings;
+};
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "ResultCache.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <sys/stat.h>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+constexpr quint32 CACHE_MAGIC = 0x41434852; // "ACHR"
+// Bump this whenever the format or the meaning of the stored results changes, e.g. when matching gets smarter.
+constexpr quint32 CACHE_VERSION = 1;
+}
+
+ResultCache::ResultCache(const QString &filePath, qsizetype capacity)
+    : m_filePath(filePath)
+    , m_capacity(capacity)
+{
+}
+
+ResultCache &ResultCache::instance()
+{
+    static ResultCache cache(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + u"/appcompatibilityhelper/results"_s);
+    return cache;
+}
+
+QByteArray ResultCache::fileIdentity(const QString &filePath)
+{
+    struct stat info;
+    if (stat(QFile::encodeName(filePath).constData(), &info) != 0) {
+        return QByteArray();
+    }
+
+    QByteArray identity;
+    QDataStream stream(&identity, QIODevice::WriteOnly);
+    stream << quint64(info.st_dev) << quint64(info.st_ino) << qint64(info.st_size) << qint64(info.st_mtim.tv_sec) << qint64(info.st_mtim.tv_nsec);
+    return identity;
+}
+
+QByteArray ResultCache::key(const QString &filePath, const QByteArray &inputsVersion)
+{
+    const QByteArray identity = fileIdentity(filePath);
+    if (identity.isEmpty()) {
+        return QByteArray();
+    }
+    return identity + inputsVersion;
+}
+
+std::optional<QVariantMap> ResultCache::lookup(const QString &filePath, const QByteArray &inputsVersion)
+{
+    const QByteArray entryKey = key(filePath, inputsVersion);
+    if (entryKey.isEmpty()) {
+        return std::nullopt;
+    }
+
+    const QMutexLocker locker(&m_mutex);
+    loadLocked();
+
+    for (qsizetype i = m_entries.size() - 1; i >= 0; --i) {
+        if (m_entries.at(i).key == entryKey) {
+            // Move it to the most recently used end. The new order is only written out with the next stored result,
+            // as rewriting the whole cache for every hit would cost more than the hit saved.
+            Entry entry = m_entries.takeAt(i);
+            const QVariantMap result = entry.result;
+            m_entries.append(std::move(entry));
+            return result;
+        }
+    }
+    return std::nullopt;
+}
+
+void ResultCache::store(const QString &filePath, const QByteArray &inputsVersion, const QVariantMap &result)
+{
+    const QByteArray entryKey = key(filePath, inputsVersion);
+    if (entryKey.isEmpty()) {
+        return;
+    }
+
+    const QMutexLocker locker(&m_mutex);
+    loadLocked();
+
+    m_entries.removeIf([&entryKey](const Entry &entry) {
+        return entry.key == entryKey;
+    });
+    m_entries.append({entryKey, result});
+    if (m_entries.size() > m_capacity) {
+        m_entries.remove(0, m_entries.size() - m_capacity);
+    }
+    m_dirty = true;
+}
+
+void ResultCache::loadLocked()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+        return;
+    }
+
+    QList<Entry> entries;
+    for (quint32 i = 0; i < count; ++i) {
+        Entry entry;
+        stream >> entry.key >> entry.result;
+        if (stream.status() != QDataStream::Ok) {
+            qWarning() << "Ignoring corrupt result cache:" << m_filePath;
+            return;
+        }
+        entries.append(std::move(entry));
+    }
+
+    // The capacity may have shrunk since the cache was written.
+    if (entries.size() > m_capacity) {
+        entries.remove(0, entries.size() - m_capacity);
+    }
+    m_entries = std::move(entries);
+}
+
+void ResultCache::save()
+{
+    const QMutexLocker locker(&m_mutex);
+    if (!m_dirty) {
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(m_filePath).absolutePath());
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write result cache:" << m_filePath << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << CACHE_MAGIC << CACHE_VERSION << quint32(m_entries.size());
+    for (const Entry &entry : std::as_const(m_entries)) {
+        stream << entry.key << entry.result;
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Could not write result cache:" << m_filePath << file.errorString();
+        return;
+    }
+    m_dirty = false;
+}
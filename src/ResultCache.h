@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+#include <optional>
+
+// A small on-disk cache of analysis results, so opening the same package twice doesn't mean reading it twice.
+//
+// Results are keyed by the file's device, inode, size and modification time, along with a version string for the
+// databases the result was worked out from (e.g. the AppStream catalogues), so any change to either misses the cache.
+// The least recently used results are evicted once the cache is full.
+class ResultCache
+{
+public:
+    explicit ResultCache(const QString &filePath, qsizetype capacity = 512);
+
+    // The cache shared by the whole process, at ~/.cache/appcompatibilityhelper/results.
+    static ResultCache &instance();
+
+    // Returns the result stored for the file, if it hasn't changed and was analysed against the same `inputsVersion`.
+    std::optional<QVariantMap> lookup(const QString &filePath, const QByteArray &inputsVersion);
+
+    void store(const QString &filePath, const QByteArray &inputsVersion, const QVariantMap &result);
+
+    // Writes the cache to disk if results have been stored or evicted. Lookups only reorder the cache in memory.
+    // If several instances write the cache at once, the last one wins.
+    void save();
+
+    // Identifies a file by its device, inode, size and modification time, without reading it.
+    // Returns an empty array if the file can't be found.
+    static QByteArray fileIdentity(const QString &filePath);
+
+private:
+    struct Entry {
+        QByteArray key;
+        QVariantMap result;
+    };
+
+    void loadLocked();
+
+    // Returns the key for a file, or an empty array if it can't be found.
+    static QByteArray key(const QString &filePath, const QByteArray &inputsVersion);
+
+    QMutex m_mutex;
+    QString m_filePath;
+    qsizetype m_capacity;
+    bool m_loaded = false;
+    bool m_dirty = false;
+
+    // Ordered from least to most recently used.
+    QList<Entry> m_entries;
+};
@@ -2,69 +2,117 @@
 // SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
 
 #include "RpmCompatibilityHelper.h"
+#include "AppStreamIndex.h"
+#include "ArchiveReaders.h"
+#include "CompatibilityHelperFactory.h"
 #include "PackageUtils.h"
+#include "RpmHeaderReader.h"
+#include "StreamDecompressor.h"
 
 #include <KIO/ApplicationLauncherJob>
 #include <KIO/CommandLauncherJob>
 #include <KIO/JobUiDelegateFactory>
 #include <KLocalizedContext>
 #include <KLocalizedString>
-#include <QProcess>
+#include <QFile>
+#include <QSet>
 
 RpmCompatibilityHelper::RpmCompatibilityHelper(const QUrl &filePath, QObject *parent)
     : ICompatibilityHelper(filePath, parent)
 {
     // Initialize the native app name to the file name of the RPM package.
     m_nativeAppName = m_filePath.fileName();
-    QProcess findProcess;
-
-    const QString findCommand = u"rpm2cpio %1 | cpio -t --quiet \"%2\" \"%3\""_s.arg(m_filePath.toLocalFile())
-                                    .arg(u"./usr/share/metainfo/*.xml"_s)
-                                    .arg(u"./usr/local/share/metainfo/*.xml"_s);
-
-    findProcess.start(u"/bin/sh"_s, QStringList() << u"-c"_s << findCommand);
-    findProcess.waitForFinished(-1);
+}
 
-    if (findProcess.exitCode() != 0) {
-        qWarning() << "Error during metainfo file search:" << findProcess.readAllStandardError();
+void RpmCompatibilityHelper::analyze()
+{
+    // The file list lives in the header, so we can find the metainfo files without decompressing the payload.
+    RpmHeaderReader header(m_filePath.toLocalFile());
+    if (!header.read()) {
         qWarning() << "An alternative native application will not be matched for this RPM package.";
         return;
     }
 
-    // Read the filename and trim whitespace (like the trailing newline)
-    QStringList specificFilesToExtract = QString::fromLocal8Bit(findProcess.readAllStandardOutput()).trimmed().split(u"\n"_s, Qt::SkipEmptyParts);
-
-    if (specificFilesToExtract.isEmpty()) {
-        m_isAnApp = false; // No metainfo files found, so this is not an application.
+    // Well-known vendor packages are in the application database, so there's no need to read their payload.
+    if (matchKnownPackage({header.name()}, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp)) {
         return;
     }
 
-    // Extract the metainfo files from the RPM package
-    QStringList metainfoFilesContent;
-    for (QString &file : specificFilesToExtract) {
-        QProcess extractProcess;
-
-        const QString extractCommand = u"rpm2cpio %1 | cpio -i --to-stdout --no-absolute-filenames \"%2\""_s.arg(m_filePath.toLocalFile()).arg(file);
+    // Desktop entries are extracted too, for packages that don't have metainfo or whose metainfo doesn't match.
+    QSet<QString> specificFilesToExtract;
+    const QStringList fileNames = header.fileNames();
+    for (const QString &fileName : fileNames) {
+        if (isMetainfoPath(fileName) || isDesktopEntryPath(fileName)) {
+            // Archive member paths are matched without the leading "/", e.g. "usr/share/metainfo/foo.xml".
+            specificFilesToExtract.insert(fileName.mid(1));
+        }
+    }
 
-        extractProcess.start(u"/bin/sh"_s, QStringList() << u"-c"_s << extractCommand);
-        extractProcess.waitForFinished(-1);
+    if (specificFilesToExtract.isEmpty()) {
+        m_isAnApp = false; // No metainfo or desktop files found, so this is not an application.
+        return;
+    }
 
-        if (extractProcess.exitCode() != 0) {
-            qWarning() << "Error extracting metainfo file:" << extractProcess.readAllStandardError();
-            continue;
-        }
+    // Extract all metainfo and desktop files in a single pass over the payload, stopping as soon as the last one has been seen.
+    QFile packageFile(m_filePath.toLocalFile());
+    if (!packageFile.open(QIODevice::ReadOnly) || !packageFile.seek(header.payloadOffset())) {
+        qWarning() << "Could not read the payload of RPM package:" << m_filePath.toLocalFile();
+        return;
+    }
 
-        metainfoFilesContent.append(QString::fromLocal8Bit(extractProcess.readAllStandardOutput()).trimmed());
+    StreamDecompressor payload(&packageFile, StreamDecompressor::formatForName(header.payloadCompressor()));
+    if (!payload.isValid()) {
+        qWarning() << "Unsupported RPM payload compressor:" << header.payloadCompressor();
+        qWarning() << "An alternative native application will not be matched for this RPM package.";
+        return;
     }
 
-    if (metainfoFilesContent.isEmpty()) {
+    ArchiveMembers extractedFiles;
+    walkCpioArchive(
+        payload,
+        [&](const QString &path) {
+            if (extractedFiles.size() == specificFilesToExtract.size()) {
+                return ArchiveMemberAction::Stop;
+            }
+            return specificFilesToExtract.contains(path) ? ArchiveMemberAction::Extract : ArchiveMemberAction::Skip;
+        },
+        extractedFiles);
+
+    if (extractedFiles.isEmpty()) {
         qWarning() << "An alternative native application will not be matched for this RPM package.";
-        m_isAnApp = false; // No metainfo files found, so this is not an application.
+        m_isAnApp = false; // No metainfo or desktop files found, so this is not an application.
         return;
     }
 
     // See if it exists on Flatpak.
-    matchFlatpakFromMetainfo(metainfoFilesContent, m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp);
+    matchFlatpakFromPackageFiles(extractedFiles, header.name(), m_nativeAppRef, m_nativeAppName, m_hasFlatpakApp, m_isAnApp);
+}
+
+QVariantMap RpmCompatibilityHelper::analysisResult() const
+{
+    QVariantMap result = ICompatibilityHelper::analysisResult();
+    result.insert(u"type"_s, u"rpm"_s);
+    result.insert(u"isAnApp"_s, m_isAnApp);
+    result.insert(u"hasFlatpakApp"_s, m_hasFlatpakApp);
+    return result;
+}
+
+QByteArray RpmCompatibilityHelper::analysisInputsVersion() const
+{
+    return AppStreamIndex::system()->version() + CompatibilityHelperFactory::appDatabaseVersion();
+}
+
+bool RpmCompatibilityHelper::restoreAnalysisResult(const QVariantMap &result)
+{
+    if (result.value(u"type"_s).toString() != u"rpm"_s) {
+        return false;
+    }
+
+    m_nativeAppName = result.value(u"nativeAppName"_s).toString();
+    m_nativeAppRef = result.value(u"nativeAppRef"_s).toString();
+    m_hasFlatpakApp = result.value(u"hasFlatpakApp"_s).toBool();
+    m_isAnApp = result.value(u"isAnApp"_s).toBool();
+    return true;
 }
 
 QString RpmCompatibilityHelper::windowTitle() const
@@ -75,12 +123,12 @@ QString RpmCompatibilityHelper::windowTitle() const
 QString RpmCompatibilityHelper::heading() const
 {
     if (hasNativeApp()) {
-        if (isNativeAppInstalled()) {
+        if (installState().nativeAppInstalled) {
             return i18n("Open the native version of %1 instead", nativeAppName());
         } else if (m_hasFlatpakApp) {
-            return i18n("Install %1 from %2 instead", nativeAppName(), appStoreName());
+            return i18n("Install %1 from %2 instead", nativeAppName(), installState().appStoreName);
         } else if (m_isAnApp) {
-            return i18n("Search for %1 in %2 instead", nativeAppName(), appStoreName());
+            return i18n("Search for %1 in %2 instead", nativeAppName(), installState().appStoreName);
         }
     } else {
         return i18n("RPM packages are not natively supported on %1", distroName());
@@ -91,7 +139,7 @@ QString RpmCompatibilityHelper::heading() const
 
 QString RpmCompatibilityHelper::icon() const
 {
-    if (hasNativeApp() && hasIcon(nativeAppRef())) {
+    if (hasNativeApp() && installState().nativeAppHasIcon) {
         return nativeAppRef();
     }
     return u"application-x-rpm"_s;
@@ -102,18 +150,18 @@ QString RpmCompatibilityHelper::description() const
     QString desc;
 
     if (hasNativeApp()) {
-        if (isNativeAppInstalled()) {
+        if (installState().nativeAppInstalled) {
             desc = i18n("A native %1 version of %2 is already installed on your system. ", distroName(), nativeAppName());
             desc += i18n("It's recommended to use the native version for better system integration.");
         } else if (m_hasFlatpakApp) {
             desc = i18n("A native %1 version of %2 is available for installation. ", distroName(), nativeAppName());
             desc += i18n("Installing the native version is recommended for better system integration.");
         } else if (m_isAnApp) {
-            desc += i18n("A native %1 version of %2 may be available for installation from %3. ", distroName(), nativeAppName(), appStoreName());
+            desc += i18n("A native %1 version of %2 may be available for installation from %3. ", distroName(), nativeAppName(), installState().appStoreName);
             desc += i18n("Installing the native version is recommended for better system integration.");
         }
     } else {
-        desc = i18n("You can search for alternatives online or in %1.", appStoreName());
+        desc = i18n("You can search for alternatives online or in %1.", installState().appStoreName);
     }
 
     desc += u"<br><br>"_s;
@@ -147,12 +195,12 @@ bool RpmCompatibilityHelper::isNativeAppInstalled() const
 
 QString RpmCompatibilityHelper::nativeAppActionText() const
 {
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         return i18n("Open %1", nativeAppName());
     } else if (m_hasFlatpakApp) {
         return i18n("Install %1", nativeAppName());
     } else if (m_isAnApp) {
-        return i18n("Search for %1 in %2", nativeAppName(), appStoreName());
+        return i18n("Search for %1 in %2", nativeAppName(), installState().appStoreName);
     }
 
     return QString();
@@ -160,10 +208,10 @@ QString RpmCompatibilityHelper::nativeAppActionText() const
 
 QString RpmCompatibilityHelper::nativeAppActionIcon() const
 {
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         return nativeAppRef();
     } else {
-        return appStoreIcon();
+        return installState().appStoreIcon;
     }
 }
 
@@ -174,7 +222,7 @@ void RpmCompatibilityHelper::nativeAppAction() const
         return;
     }
 
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         openApp(nativeAppRef());
     } else if (m_hasFlatpakApp) {
         openAppInAppStore(nativeAppRef());
@@ -40,6 +40,8 @@ public:
         return QString();
     }
 
+    QVariantMap analysisResult() const override;
+
     Q_INVOKABLE void nativeAppAction() const override;
     Q_INVOKABLE void compatibilityToolAction() const override
     {
@@ -47,6 +49,11 @@ public:
         qWarning() << "Invalid operation: No compatibility tool action is available for RPM files.";
     }
 
+protected:
+    void analyze() override;
+    QByteArray analysisInputsVersion() const override;
+    bool restoreAnalysisResult(const QVariantMap &result) override;
+
 private:
     QString m_nativeAppName;
     QString m_nativeAppRef;
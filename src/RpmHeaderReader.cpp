@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "RpmHeaderReader.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+constexpr qint64 LEAD_SIZE = 96;
+constexpr qint64 HEADER_INTRO_SIZE = 16;
+constexpr qint64 INDEX_ENTRY_SIZE = 16;
+
+// Real headers are at most a few MB even for packages with tens of thousands of files.
+// Anything beyond this is treated as corrupt rather than allocated.
+constexpr quint32 MAX_HEADER_INDEX_ENTRIES = 0x10000;
+constexpr quint32 MAX_HEADER_STORE_SIZE = 256 * 1024 * 1024;
+
+constexpr quint32 RPM_INT32_TYPE = 4;
+constexpr quint32 RPM_STRING_TYPE = 6;
+constexpr quint32 RPM_STRING_ARRAY_TYPE = 8;
+constexpr quint32 RPM_I18NSTRING_TYPE = 9;
+
+constexpr quint32 RPMTAG_NAME = 1000;
+constexpr quint32 RPMTAG_OLDFILENAMES = 1027;
+constexpr quint32 RPMTAG_DIRINDEXES = 1116;
+constexpr quint32 RPMTAG_BASENAMES = 1117;
+constexpr quint32 RPMTAG_DIRNAMES = 1118;
+constexpr quint32 RPMTAG_PAYLOADCOMPRESSOR = 1125;
+
+// Reads the 16 byte intro of a header structure, returning the number of index entries and the size of the data store.
+bool readHeaderIntro(QFile &file, quint32 &indexCount, quint32 &storeSize)
+{
+    const QByteArray intro = file.read(HEADER_INTRO_SIZE);
+    if (intro.size() != HEADER_INTRO_SIZE) {
+        return false;
+    }
+
+    const auto *data = reinterpret_cast<const uchar *>(intro.constData());
+    if (data[0] != 0x8e || data[1] != 0xad || data[2] != 0xe8 || data[3] != 0x01) {
+        return false;
+    }
+
+    indexCount = qFromBigEndian<quint32>(data + 8);
+    storeSize = qFromBigEndian<quint32>(data + 12);
+    return indexCount <= MAX_HEADER_INDEX_ENTRIES && storeSize <= MAX_HEADER_STORE_SIZE;
+}
+}
+
+RpmHeaderReader::RpmHeaderReader(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+bool RpmHeaderReader::read()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open RPM package:" << m_filePath;
+        return false;
+    }
+
+    const QByteArray lead = file.read(LEAD_SIZE);
+    if (lead.size() != LEAD_SIZE || !lead.startsWith("\xed\xab\xee\xdb")) {
+        qWarning() << m_filePath << "is not an RPM package.";
+        return false;
+    }
+
+    // The signature header only holds digests, so skip straight past it.
+    // Unlike the main header, it is padded to an 8 byte boundary.
+    quint32 indexCount = 0;
+    quint32 storeSize = 0;
+    if (!readHeaderIntro(file, indexCount, storeSize)) {
+        qWarning() << "Invalid signature header in RPM package:" << m_filePath;
+        return false;
+    }
+
+    const qint64 signatureSize = indexCount * INDEX_ENTRY_SIZE + storeSize;
+    const qint64 signaturePadding = (8 - (signatureSize % 8)) % 8;
+    if (!file.seek(file.pos() + signatureSize + signaturePadding)) {
+        qWarning() << "Truncated signature header in RPM package:" << m_filePath;
+        return false;
+    }
+
+    if (!readHeaderIntro(file, indexCount, storeSize)) {
+        qWarning() << "Invalid main header in RPM package:" << m_filePath;
+        return false;
+    }
+
+    m_index = file.read(indexCount * INDEX_ENTRY_SIZE);
+    m_store = file.read(storeSize);
+    if (m_index.size() != qsizetype(indexCount * INDEX_ENTRY_SIZE) || m_store.size() != qsizetype(storeSize)) {
+        qWarning() << "Truncated main header in RPM package:" << m_filePath;
+        m_index.clear();
+        m_store.clear();
+        return false;
+    }
+
+    m_payloadOffset = file.pos();
+    return true;
+}
+
+bool RpmHeaderReader::findTag(quint32 tag, IndexEntry &entry) const
+{
+    const auto *index = reinterpret_cast<const uchar *>(m_index.constData());
+    const qsizetype entryCount = m_index.size() / INDEX_ENTRY_SIZE;
+
+    for (qsizetype i = 0; i < entryCount; ++i) {
+        const uchar *current = index + i * INDEX_ENTRY_SIZE;
+        if (qFromBigEndian<quint32>(current) != tag) {
+            continue;
+        }
+
+        entry.type = qFromBigEndian<quint32>(current + 4);
+        entry.offset = qFromBigEndian<quint32>(current + 8);
+        entry.count = qFromBigEndian<quint32>(current + 12);
+        return entry.offset < quint32(m_store.size());
+    }
+
+    return false;
+}
+
+QString RpmHeaderReader::stringTag(quint32 tag) const
+{
+    IndexEntry entry;
+    if (!findTag(tag, entry) || (entry.type != RPM_STRING_TYPE && entry.type != RPM_I18NSTRING_TYPE)) {
+        return QString();
+    }
+
+    // For I18NSTRING, the first string is the untranslated one.
+    const char *start = m_store.constData() + entry.offset;
+    const qsizetype length = qstrnlen(start, m_store.size() - entry.offset);
+    return QString::fromUtf8(start, length);
+}
+
+QStringList RpmHeaderReader::stringArrayTag(quint32 tag) const
+{
+    IndexEntry entry;
+    if (!findTag(tag, entry) || entry.type != RPM_STRING_ARRAY_TYPE) {
+        return QStringList();
+    }
+
+    QStringList strings;
+    strings.reserve(qMin<quint32>(entry.count, m_store.size()));
+
+    qsizetype offset = entry.offset;
+    for (quint32 i = 0; i < entry.count && offset < m_store.size(); ++i) {
+        const char *start = m_store.constData() + offset;
+        const qsizetype length = qstrnlen(start, m_store.size() - offset);
+        strings.append(QString::fromUtf8(start, length));
+        offset += length + 1;
+    }
+
+    return strings;
+}
+
+QList<quint32> RpmHeaderReader::int32ArrayTag(quint32 tag) const
+{
+    IndexEntry entry;
+    if (!findTag(tag, entry) || entry.type != RPM_INT32_TYPE) {
+        return QList<quint32>();
+    }
+
+    if (entry.count > (quint32(m_store.size()) - entry.offset) / sizeof(quint32)) {
+        return QList<quint32>();
+    }
+
+    QList<quint32> values;
+    values.reserve(entry.count);
+
+    const auto *data = reinterpret_cast<const uchar *>(m_store.constData() + entry.offset);
+    for (quint32 i = 0; i < entry.count; ++i) {
+        values.append(qFromBigEndian<quint32>(data + i * sizeof(quint32)));
+    }
+
+    return values;
+}
+
+QString RpmHeaderReader::name() const
+{
+    return stringTag(RPMTAG_NAME);
+}
+
+QStringList RpmHeaderReader::fileNames() const
+{
+    // Packages built with rpm < 4.0 store full paths rather than splitting them into directories and base names.
+    const QStringList oldFileNames = stringArrayTag(RPMTAG_OLDFILENAMES);
+    if (!oldFileNames.isEmpty()) {
+        return oldFileNames;
+    }
+
+    const QStringList baseNames = stringArrayTag(RPMTAG_BASENAMES);
+    const QStringList dirNames = stringArrayTag(RPMTAG_DIRNAMES);
+    const QList<quint32> dirIndexes = int32ArrayTag(RPMTAG_DIRINDEXES);
+
+    if (baseNames.size() != dirIndexes.size()) {
+        qWarning() << "Mismatched file list in RPM package:" << m_filePath;
+        return QStringList();
+    }
+
+    QStringList fileNames;
+    fileNames.reserve(baseNames.size());
+    for (qsizetype i = 0; i < baseNames.size(); ++i) {
+        const quint32 dirIndex = dirIndexes.at(i);
+        if (dirIndex >= quint32(dirNames.size())) {
+            continue;
+        }
+        fileNames.append(dirNames.at(dirIndex) + baseNames.at(i));
+    }
+
+    return fileNames;
+}
+
+QString RpmHeaderReader::payloadCompressor() const
+{
+    // Packages without the tag predate the others and always use gzip.
+    const QString compressor = stringTag(RPMTAG_PAYLOADCOMPRESSOR);
+    return compressor.isEmpty() ? u"gzip"_s : compressor;
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Reads the lead, signature and main header of an RPM package without touching the payload.
+// The main header already stores the full file list and package metadata, so this is enough to find out
+// which files a package contains without decompressing anything.
+// See https://rpm-software-management.github.io/rpm/manual/format_v4.html
+class RpmHeaderReader
+{
+public:
+    explicit RpmHeaderReader(const QString &filePath);
+
+    // Reads and validates the headers.
+    // Returns false if the file couldn't be read or isn't a valid RPM package.
+    bool read();
+
+    // The package name, e.g. "google-chrome-stable".
+    QString name() const;
+
+    // The absolute paths of all files in the package, e.g. "/usr/share/metainfo/org.mozilla.firefox.metainfo.xml".
+    QStringList fileNames() const;
+
+    // The compressor used for the payload, e.g. "zstd", "xz" or "gzip".
+    QString payloadCompressor() const;
+
+    // The offset of the compressed payload from the start of the file.
+    qint64 payloadOffset() const
+    {
+        return m_payloadOffset;
+    }
+
+private:
+    struct IndexEntry {
+        quint32 type = 0;
+        quint32 offset = 0;
+        quint32 count = 0;
+    };
+
+    // Looks up a tag in the main header, returning false if it isn't present.
+    bool findTag(quint32 tag, IndexEntry &entry) const;
+    QString stringTag(quint32 tag) const;
+    QStringList stringArrayTag(quint32 tag) const;
+    QList<quint32> int32ArrayTag(quint32 tag) const;
+
+    QString m_filePath;
+
+    // The raw index entries and data store of the main header.
+    QByteArray m_index;
+    QByteArray m_store;
+
+    qint64 m_payloadOffset = -1;
+};
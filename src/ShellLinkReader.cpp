@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "ShellLinkReader.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <utility>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+constexpr quint32 HEADER_SIZE = 0x4c;
+constexpr qint64 LINK_FLAGS_OFFSET = 0x14;
+// 00021401-0000-0000-C000-000000000046, as stored on disk.
+constexpr QByteArrayView LINK_CLSID("\x01\x14\x02\x00\x00\x00\x00\x00\xc0\x00\x00\x00\x00\x00\x00\x46", 16);
+
+// Real shortcuts are a few KB. Anything bigger isn't read, so most executables are turned away by their size alone.
+constexpr qint64 MAX_LINK_SIZE = 64 * 1024;
+
+enum LinkFlag : quint32 {
+    HasLinkTargetIdList = 0x1,
+    HasLinkInfo = 0x2,
+    HasName = 0x4,
+    HasRelativePath = 0x8,
+    HasWorkingDir = 0x10,
+    HasArguments = 0x20,
+    HasIconLocation = 0x40,
+    IsUnicode = 0x80,
+    ForceNoLinkInfo = 0x100,
+};
+
+enum LinkInfoFlag : quint32 {
+    VolumeIdAndLocalBasePath = 0x1,
+    CommonNetworkRelativeLinkAndPathSuffix = 0x2,
+};
+
+// LinkInfo headers this big or bigger also hold the offsets of Unicode versions of the paths.
+constexpr quint32 LINK_INFO_UNICODE_HEADER_SIZE = 0x24;
+// The same goes for CommonNetworkRelativeLink structures whose net name starts after this.
+constexpr quint32 NETWORK_LINK_UNICODE_NET_NAME_OFFSET = 0x14;
+
+constexpr quint32 ENVIRONMENT_VARIABLE_DATA_BLOCK = 0xa0000001;
+constexpr quint32 ICON_ENVIRONMENT_DATA_BLOCK = 0xa0000007;
+// Both blocks hold a path of up to MAX_PATH characters, first in the system code page and then in UTF-16.
+constexpr qint64 ENVIRONMENT_BLOCK_SIZE = 0x314;
+constexpr qint64 ENVIRONMENT_ANSI_TARGET_OFFSET = 8;
+constexpr qint64 ENVIRONMENT_UNICODE_TARGET_OFFSET = 8 + 260;
+
+template<typename T>
+bool readLittleEndian(QByteArrayView data, qint64 offset, T &value)
+{
+    if (offset < 0 || offset + qint64(sizeof(T)) > data.size()) {
+        return false;
+    }
+    value = qFromLittleEndian<T>(data.constData() + offset);
+    return true;
+}
+
+// Strings in the system code page are read as Latin-1, which is right for Western code pages bar a few punctuation marks.
+QString readAnsiString(QByteArrayView data, qint64 offset)
+{
+    if (offset <= 0 || offset >= data.size()) {
+        return QString();
+    }
+    const QByteArrayView string = data.sliced(offset);
+    const qsizetype end = string.indexOf('\0');
+    return QString::fromLatin1(end < 0 ? string : string.first(end));
+}
+
+QString readUtf16String(QByteArrayView data, qint64 offset)
+{
+    if (offset <= 0 || offset >= data.size()) {
+        return QString();
+    }
+    const QByteArrayView string = data.sliced(offset);
+    qsizetype length = 0;
+    while ((length + 1) * 2 <= string.size() && (string.at(length * 2) != 0 || string.at(length * 2 + 1) != 0)) {
+        ++length;
+    }
+    return QString::fromUtf16(reinterpret_cast<const char16_t *>(string.constData()), length);
+}
+
+// Reads a counted string from the StringData section, returning the offset after it, or -1 if it runs off the end.
+qint64 readCountedString(QByteArrayView data, qint64 offset, bool isUnicode, QString &string)
+{
+    quint16 count = 0;
+    if (!readLittleEndian(data, offset, count)) {
+        return -1;
+    }
+    offset += 2;
+
+    const qint64 size = isUnicode ? qint64(count) * 2 : qint64(count);
+    if (offset + size > data.size()) {
+        return -1;
+    }
+    if (isUnicode) {
+        string = QString::fromUtf16(reinterpret_cast<const char16_t *>(data.constData() + offset), count);
+    } else {
+        string = QString::fromLatin1(data.sliced(offset, size));
+    }
+    return offset + size;
+}
+
+QString joinWindowsPath(const QString &base, const QString &suffix)
+{
+    if (suffix.isEmpty() || base.endsWith(u'\\')) {
+        return base + suffix;
+    }
+    return base + u'\\' + suffix;
+}
+}
+
+ShellLinkReader::ShellLinkReader(const QString &filePath)
+    : m_filePath(filePath)
+{
+}
+
+bool ShellLinkReader::read()
+{
+    // Executables are tried too, so failing to open the file isn't worth a warning here.
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size < HEADER_SIZE || size > MAX_LINK_SIZE) {
+        return false;
+    }
+
+    return readImage(file.read(size));
+}
+
+bool ShellLinkReader::readImage(QByteArrayView image)
+{
+    quint32 headerSize = 0;
+    quint32 flags = 0;
+    if (!readLittleEndian(image, 0, headerSize) || headerSize != HEADER_SIZE || image.sliced(4, LINK_CLSID.size()) != LINK_CLSID
+        || !readLittleEndian(image, LINK_FLAGS_OFFSET, flags)) {
+        return false;
+    }
+    m_isUnicode = flags & IsUnicode;
+
+    qint64 offset = HEADER_SIZE;
+    if (flags & HasLinkTargetIdList) {
+        // The item ID list describes the target as shell namespace objects, which can't be resolved outside of Windows.
+        quint16 idListSize = 0;
+        if (!readLittleEndian(image, offset, idListSize)) {
+            return false;
+        }
+        offset += 2 + idListSize;
+    }
+
+    if (flags & HasLinkInfo) {
+        quint32 linkInfoSize = 0;
+        if (!readLittleEndian(image, offset, linkInfoSize) || linkInfoSize < 4 || offset + linkInfoSize > image.size()) {
+            return false;
+        }
+        if (!(flags & ForceNoLinkInfo)) {
+            readLinkInfo(image.sliced(offset, linkInfoSize));
+        }
+        offset += linkInfoSize;
+    }
+
+    // The strings are stored in this order, each only if its flag is set.
+    QString workingDir;
+    QString arguments;
+    const std::pair<LinkFlag, QString *> strings[] = {
+        {HasName, &m_name},
+        {HasRelativePath, &m_relativePath},
+        {HasWorkingDir, &workingDir},
+        {HasArguments, &arguments},
+        {HasIconLocation, &m_iconLocation},
+    };
+    for (const auto &[flag, string] : strings) {
+        if (!(flags & flag)) {
+            continue;
+        }
+        offset = readCountedString(image, offset, m_isUnicode, *string);
+        if (offset < 0) {
+            return false;
+        }
+    }
+
+    readExtraData(image.sliced(qMin<qint64>(offset, image.size())));
+    return true;
+}
+
+void ShellLinkReader::readLinkInfo(QByteArrayView linkInfo)
+{
+    quint32 headerSize = 0;
+    quint32 flags = 0;
+    quint32 localBasePathOffset = 0;
+    quint32 networkLinkOffset = 0;
+    quint32 pathSuffixOffset = 0;
+    if (!readLittleEndian(linkInfo, 4, headerSize) || !readLittleEndian(linkInfo, 8, flags) || !readLittleEndian(linkInfo, 16, localBasePathOffset)
+        || !readLittleEndian(linkInfo, 20, networkLinkOffset) || !readLittleEndian(linkInfo, 24, pathSuffixOffset)) {
+        return;
+    }
+
+    quint32 localBasePathOffsetUnicode = 0;
+    quint32 pathSuffixOffsetUnicode = 0;
+    if (headerSize >= LINK_INFO_UNICODE_HEADER_SIZE) {
+        readLittleEndian(linkInfo, 28, localBasePathOffsetUnicode);
+        readLittleEndian(linkInfo, 32, pathSuffixOffsetUnicode);
+    }
+
+    const QString pathSuffix = pathSuffixOffsetUnicode ? readUtf16String(linkInfo, pathSuffixOffsetUnicode) : readAnsiString(linkInfo, pathSuffixOffset);
+
+    if (flags & VolumeIdAndLocalBasePath) {
+        const QString basePath =
+            localBasePathOffsetUnicode ? readUtf16String(linkInfo, localBasePathOffsetUnicode) : readAnsiString(linkInfo, localBasePathOffset);
+        if (!basePath.isEmpty()) {
+            m_targetPath = joinWindowsPath(basePath, pathSuffix);
+            return;
+        }
+    }
+
+    if ((flags & CommonNetworkRelativeLinkAndPathSuffix) && networkLinkOffset < linkInfo.size()) {
+        const QByteArrayView networkLink = linkInfo.sliced(networkLinkOffset);
+        quint32 netNameOffset = 0;
+        quint32 netNameOffsetUnicode = 0;
+        if (!readLittleEndian(networkLink, 8, netNameOffset)) {
+            return;
+        }
+        if (netNameOffset > NETWORK_LINK_UNICODE_NET_NAME_OFFSET) {
+            readLittleEndian(networkLink, 20, netNameOffsetUnicode);
+        }
+        const QString netName = netNameOffsetUnicode ? readUtf16String(networkLink, netNameOffsetUnicode) : readAnsiString(networkLink, netNameOffset);
+        if (!netName.isEmpty()) {
+            m_targetPath = joinWindowsPath(netName, pathSuffix);
+        }
+    }
+}
+
+void ShellLinkReader::readExtraData(QByteArrayView extraData)
+{
+    qint64 offset = 0;
+    quint32 blockSize = 0;
+    // The list ends with a block smaller than 4 bytes.
+    while (readLittleEndian(extraData, offset, blockSize) && blockSize >= 8 && offset + blockSize <= extraData.size()) {
+        const QByteArrayView block = extraData.sliced(offset, blockSize);
+        offset += blockSize;
+
+        quint32 signature = 0;
+        readLittleEndian(block, 4, signature);
+        if ((signature != ENVIRONMENT_VARIABLE_DATA_BLOCK && signature != ICON_ENVIRONMENT_DATA_BLOCK) || block.size() < ENVIRONMENT_BLOCK_SIZE) {
+            continue;
+        }
+
+        QString path = readUtf16String(block.first(ENVIRONMENT_BLOCK_SIZE), ENVIRONMENT_UNICODE_TARGET_OFFSET);
+        if (path.isEmpty()) {
+            path = readAnsiString(block.first(ENVIRONMENT_UNICODE_TARGET_OFFSET), ENVIRONMENT_ANSI_TARGET_OFFSET);
+        }
+
+        // Environment variables can't be expanded here, but the file name at the end is all that's matched on.
+        if (signature == ENVIRONMENT_VARIABLE_DATA_BLOCK && m_targetPath.isEmpty()) {
+            m_targetPath = path;
+        } else if (signature == ICON_ENVIRONMENT_DATA_BLOCK && m_iconLocation.isEmpty()) {
+            m_iconLocation = path;
+        }
+    }
+}
+
+QString ShellLinkReader::targetPath() const
+{
+    // The relative path is from the shortcut to its target, e.g. "..\..\Program Files\Mozilla Firefox\firefox.exe".
+    return m_targetPath.isEmpty() ? m_relativePath : m_targetPath;
+}
+
+QString ShellLinkReader::targetFileName() const
+{
+    const QString path = targetPath();
+    return path.sliced(qMax(path.lastIndexOf(u'\\'), path.lastIndexOf(u'/')) + 1);
+}
+
+QString ShellLinkReader::name() const
+{
+    return m_name;
+}
+
+QString ShellLinkReader::iconLocation() const
+{
+    return m_iconLocation;
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QByteArrayView>
+#include <QString>
+
+// Reads a Windows shortcut (.lnk), which names the executable it launches, e.g. "C:\Program Files\Mozilla Firefox\firefox.exe".
+//
+// Shortcuts are a few KB, so the whole file is read at once and parsed in place.
+// See https://learn.microsoft.com/en-us/openspecs/windows_protocols/ms-shllink
+class ShellLinkReader
+{
+public:
+    explicit ShellLinkReader(const QString &filePath);
+
+    // Reads the shortcut with a single read of the whole file. Returns false if the file isn't a shell link.
+    bool read();
+
+    // The path of the file the shortcut launches. Empty if it doesn't say, e.g. for shortcuts to Control Panel items.
+    QString targetPath() const;
+
+    // The file name of the target, e.g. "firefox.exe".
+    QString targetFileName() const;
+
+    // The description of the shortcut, e.g. "Access the Internet".
+    QString name() const;
+
+    // The path of the icon file, e.g. "%ProgramFiles%\Mozilla Firefox\firefox.exe".
+    QString iconLocation() const;
+
+private:
+    bool readImage(QByteArrayView image);
+
+    // Reads the target path out of a LinkInfo structure.
+    void readLinkInfo(QByteArrayView linkInfo);
+
+    // Reads the blocks after the string data, which hold the target and icon paths with environment variables left in.
+    void readExtraData(QByteArrayView extraData);
+
+    QString m_filePath;
+    bool m_isUnicode = false;
+
+    QString m_targetPath;
+    QString m_relativePath;
+    QString m_name;
+    QString m_iconLocation;
+};
@@ -0,0 +1,539 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "SquashFsReader.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+constexpr QByteArrayView SQUASHFS_MAGIC("hsqs", 4);
+constexpr qint64 SUPERBLOCK_SIZE = 96;
+constexpr quint16 SQUASHFS_MAJOR_VERSION = 4;
+
+enum Compressor : quint16 {
+    Zlib = 1,
+    Lzma = 2,
+    Lzo = 3,
+    Xz = 4,
+    Lz4 = 5,
+    Zstd = 6,
+};
+
+enum InodeType : quint16 {
+    BasicDirectory = 1,
+    BasicFile = 2,
+    BasicSymlink = 3,
+    ExtendedDirectory = 8,
+    ExtendedFile = 9,
+    ExtendedSymlink = 10,
+};
+
+constexpr qint64 METADATA_BLOCK_SIZE = 8192;
+constexpr quint16 METADATA_UNCOMPRESSED = 0x8000;
+constexpr quint32 DATA_BLOCK_UNCOMPRESSED = 1 << 24;
+constexpr quint32 NO_FRAGMENT = 0xffffffff;
+constexpr qint64 FRAGMENT_ENTRY_SIZE = 16;
+constexpr qint64 DIRECTORY_HEADER_SIZE = 12;
+constexpr qint64 DIRECTORY_ENTRY_SIZE = 8;
+constexpr quint32 MAX_DIRECTORY_HEADER_ENTRIES = 256;
+
+// Only metadata is read out of AppImages, i.e. metainfo and desktop files, so anything bigger is left alone.
+constexpr quint64 MAX_FILE_SIZE = 4 * 1024 * 1024;
+constexpr qint64 MAX_SYMLINK_SIZE = 4096;
+constexpr int MAX_SYMLINK_DEPTH = 8;
+
+template<typename T>
+T readLittleEndian(QByteArrayView data, qint64 offset)
+{
+    return qFromLittleEndian<T>(data.constData() + offset);
+}
+
+template<typename T>
+bool readElfValue(QByteArrayView data, qint64 offset, bool bigEndian, T &value)
+{
+    if (offset < 0 || offset + qint64(sizeof(T)) > data.size()) {
+        return false;
+    }
+    value = bigEndian ? qFromBigEndian<T>(data.constData() + offset) : qFromLittleEndian<T>(data.constData() + offset);
+    return true;
+}
+
+// AppImages are an ELF runtime with the image appended, so the image starts where the ELF file ends,
+// which is after its section header table. This is how the AppImage runtime finds it too.
+qint64 elfSize(QByteArrayView data)
+{
+    if (data.size() < 6 || !data.startsWith("\x7f" "ELF")) {
+        return -1;
+    }
+
+    const bool is64Bit = data.at(4) == 2;
+    const bool bigEndian = data.at(5) == 2;
+
+    quint64 sectionHeaderOffset = 0;
+    quint16 sectionHeaderSize = 0;
+    quint16 sectionHeaderCount = 0;
+    if (is64Bit) {
+        if (!readElfValue(data, 0x28, bigEndian, sectionHeaderOffset) || !readElfValue(data, 0x3a, bigEndian, sectionHeaderSize)
+            || !readElfValue(data, 0x3c, bigEndian, sectionHeaderCount)) {
+            return -1;
+        }
+    } else {
+        quint32 sectionHeaderOffset32 = 0;
+        if (!readElfValue(data, 0x20, bigEndian, sectionHeaderOffset32) || !readElfValue(data, 0x2e, bigEndian, sectionHeaderSize)
+            || !readElfValue(data, 0x30, bigEndian, sectionHeaderCount)) {
+            return -1;
+        }
+        sectionHeaderOffset = sectionHeaderOffset32;
+    }
+
+    const quint64 size = sectionHeaderOffset + quint64(sectionHeaderSize) * sectionHeaderCount;
+    return size <= quint64(data.size()) ? qint64(size) : -1;
+}
+
+StreamDecompressor::Format formatForCompressor(quint16 compressor)
+{
+    switch (compressor) {
+    case Zlib:
+        return StreamDecompressor::Format::Gzip;
+    case Lzma:
+        return StreamDecompressor::Format::Lzma;
+    case Xz:
+        return StreamDecompressor::Format::Xz;
+    case Zstd:
+        return StreamDecompressor::Format::Zstd;
+    default:
+        return StreamDecompressor::Format::Invalid;
+    }
+}
+}
+
+bool SquashFsReader::Inode::isDirectory() const
+{
+    return type == BasicDirectory || type == ExtendedDirectory;
+}
+
+bool SquashFsReader::Inode::isFile() const
+{
+    return type == BasicFile || type == ExtendedFile;
+}
+
+bool SquashFsReader::Inode::isSymlink() const
+{
+    return type == BasicSymlink || type == ExtendedSymlink;
+}
+
+SquashFsReader::SquashFsReader(const QString &filePath)
+    : m_filePath(filePath)
+    , m_file(filePath)
+{
+}
+
+bool SquashFsReader::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open AppImage:" << m_filePath;
+        return false;
+    }
+
+    // Only the pages that are actually read get loaded, however big the file is.
+    const qint64 size = m_file.size();
+    const uchar *data = size > 0 ? m_file.map(0, size) : nullptr;
+    if (!data) {
+        return false;
+    }
+    m_image = QByteArrayView(reinterpret_cast<const char *>(data), size);
+
+    m_offset = elfSize(m_image);
+    if (m_offset < 0 || m_offset + SUPERBLOCK_SIZE > size || m_image.sliced(m_offset, SQUASHFS_MAGIC.size()) != SQUASHFS_MAGIC) {
+        qWarning() << "No SquashFS image was found in AppImage:" << m_filePath;
+        return false;
+    }
+
+    const QByteArrayView superblock = m_image.sliced(m_offset, SUPERBLOCK_SIZE);
+    m_fragmentCount = readLittleEndian<quint32>(superblock, 16);
+    m_blockSize = readLittleEndian<quint32>(superblock, 12);
+    const quint16 compressor = readLittleEndian<quint16>(superblock, 20);
+    const quint16 blockLog = readLittleEndian<quint16>(superblock, 22);
+    const quint16 majorVersion = readLittleEndian<quint16>(superblock, 28);
+    m_rootInode = readLittleEndian<quint64>(superblock, 32);
+    m_inodeTableStart = readLittleEndian<quint64>(superblock, 64);
+    m_directoryTableStart = readLittleEndian<quint64>(superblock, 72);
+    m_fragmentTableStart = readLittleEndian<quint64>(superblock, 80);
+
+    if (majorVersion != SQUASHFS_MAJOR_VERSION || blockLog < 12 || blockLog > 20 || m_blockSize != 1u << blockLog) {
+        qWarning() << "Unsupported or corrupt SquashFS image in AppImage:" << m_filePath;
+        return false;
+    }
+
+    m_format = formatForCompressor(compressor);
+    if (m_format == StreamDecompressor::Format::Invalid) {
+        qWarning() << "Unsupported SquashFS compressor" << compressor << "in AppImage:" << m_filePath;
+        return false;
+    }
+
+    return true;
+}
+
+std::optional<QByteArrayView> SquashFsReader::imageData(quint64 position, quint64 size) const
+{
+    const quint64 available = quint64(m_image.size() - m_offset);
+    if (position > available || size > available - position) {
+        return std::nullopt;
+    }
+    return m_image.sliced(m_offset + qint64(position), qint64(size));
+}
+
+bool SquashFsReader::decompress(QByteArrayView compressed, qint64 maxSize, QByteArray &data) const
+{
+    QByteArray input = QByteArray::fromRawData(compressed.constData(), compressed.size());
+    QBuffer buffer(&input);
+    buffer.open(QIODevice::ReadOnly);
+
+    StreamDecompressor stream(&buffer, m_format);
+    if (!stream.isValid()) {
+        return false;
+    }
+
+    data.resize(maxSize);
+    qint64 size = 0;
+    while (size < maxSize) {
+        const qint64 bytesRead = stream.read(data.data() + size, maxSize - size);
+        if (bytesRead < 0) {
+            return false;
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+        size += bytesRead;
+    }
+    data.truncate(size);
+    return true;
+}
+
+const SquashFsReader::MetadataBlock *SquashFsReader::metadataBlock(quint64 position)
+{
+    if (const auto it = m_metadataBlocks.constFind(position); it != m_metadataBlocks.constEnd()) {
+        return &it.value();
+    }
+
+    const std::optional<QByteArrayView> header = imageData(position, 2);
+    if (!header) {
+        return nullptr;
+    }
+    const quint16 sizeField = readLittleEndian<quint16>(*header, 0);
+    const quint16 size = sizeField & ~METADATA_UNCOMPRESSED;
+    const std::optional<QByteArrayView> contents = imageData(position + 2, size);
+    if (!contents || size > METADATA_BLOCK_SIZE) {
+        return nullptr;
+    }
+
+    MetadataBlock block;
+    if (sizeField & METADATA_UNCOMPRESSED) {
+        block.data = contents->toByteArray();
+    } else if (!decompress(*contents, METADATA_BLOCK_SIZE, block.data)) {
+        return nullptr;
+    }
+    block.next = position + 2 + size;
+    return &m_metadataBlocks.insert(position, std::move(block)).value();
+}
+
+bool SquashFsReader::readMetadata(MetadataCursor &cursor, char *data, qint64 size)
+{
+    while (size > 0) {
+        const MetadataBlock *block = metadataBlock(cursor.block);
+        if (!block || block->data.isEmpty()) {
+            return false;
+        }
+
+        // Entries can run on into the next block.
+        if (cursor.offset >= quint32(block->data.size())) {
+            cursor.offset -= block->data.size();
+            cursor.block = block->next;
+            continue;
+        }
+
+        const qint64 chunk = qMin<qint64>(size, block->data.size() - cursor.offset);
+        memcpy(data, block->data.constData() + cursor.offset, chunk);
+        data += chunk;
+        size -= chunk;
+        cursor.offset += chunk;
+    }
+    return true;
+}
+
+bool SquashFsReader::readInode(quint64 reference, Inode &inode)
+{
+    MetadataCursor cursor{m_inodeTableStart + (reference >> 16), quint32(reference & 0xffff)};
+
+    std::array<char, 40> buffer;
+    const QByteArrayView fields(buffer.data(), buffer.size());
+    if (!readMetadata(cursor, buffer.data(), 16)) {
+        return false;
+    }
+    inode.type = readLittleEndian<quint16>(fields, 0);
+
+    switch (inode.type) {
+    case BasicDirectory:
+        if (!readMetadata(cursor, buffer.data(), 16)) {
+            return false;
+        }
+        inode.listingBlock = readLittleEndian<quint32>(fields, 0);
+        // Directory sizes count three bytes for the implicit "." and ".." entries.
+        inode.listingSize = qMax(readLittleEndian<quint16>(fields, 8), quint16(3)) - 3;
+        inode.listingOffset = readLittleEndian<quint16>(fields, 10);
+        return true;
+    case ExtendedDirectory:
+        if (!readMetadata(cursor, buffer.data(), 24)) {
+            return false;
+        }
+        inode.listingSize = qMax(readLittleEndian<quint32>(fields, 4), quint32(3)) - 3;
+        inode.listingBlock = readLittleEndian<quint32>(fields, 8);
+        inode.listingOffset = readLittleEndian<quint16>(fields, 18);
+        return true;
+    case BasicFile:
+        if (!readMetadata(cursor, buffer.data(), 16)) {
+            return false;
+        }
+        inode.blocksStart = readLittleEndian<quint32>(fields, 0);
+        inode.fragment = readLittleEndian<quint32>(fields, 4);
+        inode.fragmentOffset = readLittleEndian<quint32>(fields, 8);
+        inode.fileSize = readLittleEndian<quint32>(fields, 12);
+        break;
+    case ExtendedFile:
+        if (!readMetadata(cursor, buffer.data(), 40)) {
+            return false;
+        }
+        inode.blocksStart = readLittleEndian<quint64>(fields, 0);
+        inode.fileSize = readLittleEndian<quint64>(fields, 8);
+        inode.fragment = readLittleEndian<quint32>(fields, 28);
+        inode.fragmentOffset = readLittleEndian<quint32>(fields, 32);
+        break;
+    case BasicSymlink:
+    case ExtendedSymlink: {
+        if (!readMetadata(cursor, buffer.data(), 8)) {
+            return false;
+        }
+        const quint32 targetSize = readLittleEndian<quint32>(fields, 4);
+        if (targetSize > MAX_SYMLINK_SIZE) {
+            return false;
+        }
+        QByteArray target(targetSize, Qt::Uninitialized);
+        if (!readMetadata(cursor, target.data(), target.size())) {
+            return false;
+        }
+        inode.target = QFile::decodeName(target);
+        return true;
+    }
+    default:
+        // Devices, FIFOs and sockets have nothing worth reading.
+        return true;
+    }
+
+    // The size of each data block follows a file's inode. The tail end of the file may be in a fragment instead of a block of its own.
+    if (inode.fileSize > MAX_FILE_SIZE) {
+        return true;
+    }
+    const quint64 blockCount = inode.fragment == NO_FRAGMENT ? (inode.fileSize + m_blockSize - 1) / m_blockSize : inode.fileSize / m_blockSize;
+    inode.blockSizes.resize(blockCount);
+    for (quint32 &blockSize : inode.blockSizes) {
+        if (!readMetadata(cursor, buffer.data(), 4)) {
+            return false;
+        }
+        blockSize = readLittleEndian<quint32>(fields, 0);
+    }
+    return true;
+}
+
+std::optional<QList<SquashFsReader::DirectoryEntry>> SquashFsReader::readDirectory(const Inode &directory)
+{
+    MetadataCursor cursor{m_directoryTableStart + directory.listingBlock, directory.listingOffset};
+
+    // The listing is a run of headers, each followed by up to 256 entries whose inodes are in the same metadata block.
+    QList<DirectoryEntry> entries;
+    std::array<char, DIRECTORY_HEADER_SIZE> buffer;
+    const QByteArrayView fields(buffer.data(), buffer.size());
+    qint64 remaining = directory.listingSize;
+    while (remaining >= DIRECTORY_HEADER_SIZE) {
+        if (!readMetadata(cursor, buffer.data(), DIRECTORY_HEADER_SIZE)) {
+            return std::nullopt;
+        }
+        remaining -= DIRECTORY_HEADER_SIZE;
+
+        const quint32 count = readLittleEndian<quint32>(fields, 0) + 1;
+        const quint64 inodeBlock = readLittleEndian<quint32>(fields, 4);
+        if (count > MAX_DIRECTORY_HEADER_ENTRIES) {
+            return std::nullopt;
+        }
+
+        for (quint32 i = 0; i < count; ++i) {
+            if (remaining < DIRECTORY_ENTRY_SIZE || !readMetadata(cursor, buffer.data(), DIRECTORY_ENTRY_SIZE)) {
+                return std::nullopt;
+            }
+            const quint16 inodeOffset = readLittleEndian<quint16>(fields, 0);
+            const qint64 nameSize = readLittleEndian<quint16>(fields, 6) + 1;
+            remaining -= DIRECTORY_ENTRY_SIZE + nameSize;
+
+            QByteArray name(nameSize, Qt::Uninitialized);
+            if (remaining < 0 || !readMetadata(cursor, name.data(), name.size())) {
+                return std::nullopt;
+            }
+            entries.append({QFile::decodeName(name), (inodeBlock << 16) | inodeOffset});
+        }
+    }
+    return entries;
+}
+
+std::optional<SquashFsReader::Inode> SquashFsReader::lookup(const QString &path, int linkDepth)
+{
+    if (linkDepth > MAX_SYMLINK_DEPTH) {
+        return std::nullopt;
+    }
+
+    Inode inode;
+    if (!readInode(m_rootInode, inode)) {
+        return std::nullopt;
+    }
+
+    const QStringList components = path.split(u'/', Qt::SkipEmptyParts);
+    for (qsizetype i = 0; i < components.size(); ++i) {
+        if (!inode.isDirectory()) {
+            return std::nullopt;
+        }
+
+        const std::optional<QList<DirectoryEntry>> entries = readDirectory(inode);
+        if (!entries) {
+            return std::nullopt;
+        }
+        const auto entry = std::find_if(entries->cbegin(), entries->cend(), [&](const DirectoryEntry &entry) {
+            return entry.name == components.at(i);
+        });
+        if (entry == entries->cend() || !readInode(entry->inodeReference, inode)) {
+            return std::nullopt;
+        }
+
+        if (inode.isSymlink()) {
+            // Resolve the link against the directory holding it, and carry on from there with the rest of the path.
+            const QString directory = components.first(i).join(u'/');
+            const QString target = inode.target.startsWith(u'/') ? inode.target : directory + u'/' + inode.target;
+            const QString remainder = components.sliced(i + 1).join(u'/');
+            const QString resolved = QDir::cleanPath(u'/' + target + u'/' + remainder);
+            // Links that climb out of the image can't be followed.
+            if (resolved.startsWith(u"/.."_s)) {
+                return std::nullopt;
+            }
+            return lookup(resolved, linkDepth + 1);
+        }
+    }
+    return inode;
+}
+
+std::optional<QStringList> SquashFsReader::entryNames(const QString &directoryPath)
+{
+    const std::optional<Inode> directory = lookup(directoryPath);
+    if (!directory || !directory->isDirectory()) {
+        return std::nullopt;
+    }
+
+    const std::optional<QList<DirectoryEntry>> entries = readDirectory(*directory);
+    if (!entries) {
+        return std::nullopt;
+    }
+
+    QStringList names;
+    names.reserve(entries->size());
+    for (const DirectoryEntry &entry : *entries) {
+        names.append(entry.name);
+    }
+    return names;
+}
+
+std::optional<QByteArray> SquashFsReader::readFile(const QString &path)
+{
+    const std::optional<Inode> file = lookup(path);
+    if (!file || !file->isFile() || file->fileSize > MAX_FILE_SIZE) {
+        return std::nullopt;
+    }
+
+    QByteArray contents;
+    contents.reserve(file->fileSize);
+
+    quint64 position = file->blocksStart;
+    QByteArray block;
+    for (const quint32 blockSize : file->blockSizes) {
+        const quint32 size = blockSize & ~DATA_BLOCK_UNCOMPRESSED;
+
+        // A block size of 0 is a sparse block of zeroes.
+        if (size == 0) {
+            contents.append(qMin<qint64>(m_blockSize, file->fileSize - contents.size()), '\0');
+            continue;
+        }
+
+        const std::optional<QByteArrayView> data = imageData(position, size);
+        if (!data) {
+            return std::nullopt;
+        }
+        position += size;
+
+        if (blockSize & DATA_BLOCK_UNCOMPRESSED) {
+            contents.append(*data);
+        } else if (decompress(*data, m_blockSize, block)) {
+            contents.append(block);
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    if (file->fragment != NO_FRAGMENT) {
+        if (file->fragment >= m_fragmentCount) {
+            return std::nullopt;
+        }
+
+        // The fragment table is a list of pointers to the metadata blocks holding the fragment entries.
+        const quint64 entryPosition = quint64(file->fragment) * FRAGMENT_ENTRY_SIZE;
+        const std::optional<QByteArrayView> pointer = imageData(m_fragmentTableStart + entryPosition / METADATA_BLOCK_SIZE * 8, 8);
+        if (!pointer) {
+            return std::nullopt;
+        }
+
+        std::array<char, FRAGMENT_ENTRY_SIZE> entry;
+        MetadataCursor cursor{readLittleEndian<quint64>(*pointer, 0), quint32(entryPosition % METADATA_BLOCK_SIZE)};
+        if (!readMetadata(cursor, entry.data(), entry.size())) {
+            return std::nullopt;
+        }
+        const QByteArrayView entryFields(entry.data(), entry.size());
+        const quint64 fragmentStart = readLittleEndian<quint64>(entryFields, 0);
+        const quint32 fragmentSizeField = readLittleEndian<quint32>(entryFields, 8);
+        const quint32 fragmentSize = fragmentSizeField & ~DATA_BLOCK_UNCOMPRESSED;
+
+        const std::optional<QByteArrayView> data = imageData(fragmentStart, fragmentSize);
+        if (!data) {
+            return std::nullopt;
+        }
+        if (fragmentSizeField & DATA_BLOCK_UNCOMPRESSED) {
+            block = data->toByteArray();
+        } else if (!decompress(*data, m_blockSize, block)) {
+            return std::nullopt;
+        }
+
+        const qint64 tailSize = file->fileSize - contents.size();
+        if (tailSize < 0 || file->fragmentOffset > quint64(block.size()) || quint64(tailSize) > quint64(block.size()) - file->fragmentOffset) {
+            return std::nullopt;
+        }
+        contents.append(QByteArrayView(block).sliced(file->fragmentOffset, tailSize));
+    }
+
+    if (quint64(contents.size()) != file->fileSize) {
+        return std::nullopt;
+    }
+    return contents;
+}
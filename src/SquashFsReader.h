@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include "StreamDecompressor.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+// Reads files out of the SquashFS image embedded in an AppImage, without mounting or extracting it.
+//
+// The AppImage is memory-mapped, and only the metadata blocks on the way to the files asked for are decompressed:
+// the inodes and directory listings of each directory on the path, and then the file's own data blocks.
+// Opening a few small files in an AppImage of hundreds of MB reads a few dozen KB of it.
+// See https://dr-emann.github.io/squashfs/squashfs.html
+class SquashFsReader
+{
+public:
+    explicit SquashFsReader(const QString &filePath);
+
+    // Finds the SquashFS image after the AppImage's ELF runtime and reads its superblock.
+    // Returns false if there isn't one, e.g. for older ISO 9660 AppImages, or if it uses an unsupported compressor.
+    bool open();
+
+    // Returns the names of the entries of a directory, e.g. "usr/share/metainfo", or "" for the root of the image.
+    // Returns std::nullopt if the path isn't a directory.
+    std::optional<QStringList> entryNames(const QString &directoryPath);
+
+    // Reads a regular file, following symbolic links within the image.
+    // Returns std::nullopt if the path isn't a regular file, or if the file is too big to be metadata.
+    std::optional<QByteArray> readFile(const QString &path);
+
+private:
+    struct Inode {
+        quint16 type = 0;
+
+        // For directories, where their listing starts in the directory table and its size.
+        quint32 listingBlock = 0;
+        quint16 listingOffset = 0;
+        quint32 listingSize = 0;
+
+        // For regular files, where their data blocks start and the size of each, and the fragment holding their tail.
+        quint64 blocksStart = 0;
+        quint64 fileSize = 0;
+        QList<quint32> blockSizes;
+        quint32 fragment = 0;
+        quint32 fragmentOffset = 0;
+
+        // For symbolic links.
+        QString target;
+
+        bool isDirectory() const;
+        bool isFile() const;
+        bool isSymlink() const;
+    };
+
+    struct DirectoryEntry {
+        QString name;
+        quint64 inodeReference = 0;
+    };
+
+    // A position in a metadata table: the position of a block within the image, and an offset into its decompressed contents.
+    struct MetadataCursor {
+        quint64 block = 0;
+        quint32 offset = 0;
+    };
+
+    struct MetadataBlock {
+        QByteArray data;
+        // The position of the block after this one.
+        quint64 next = 0;
+    };
+
+    // Returns the part of the image at `position`, relative to the start of the SquashFS image, or std::nullopt if it's out of bounds.
+    std::optional<QByteArrayView> imageData(quint64 position, quint64 size) const;
+
+    bool decompress(QByteArrayView compressed, qint64 maxSize, QByteArray &data) const;
+
+    // Decompresses the metadata block at `position`, reusing it if it has been decompressed before.
+    const MetadataBlock *metadataBlock(quint64 position);
+
+    // Reads `size` bytes of metadata, moving the cursor past them.
+    bool readMetadata(MetadataCursor &cursor, char *data, qint64 size);
+
+    bool readInode(quint64 reference, Inode &inode);
+    std::optional<QList<DirectoryEntry>> readDirectory(const Inode &directory);
+
+    // Finds the inode at a path from the root of the image, following symbolic links.
+    std::optional<Inode> lookup(const QString &path, int linkDepth = 0);
+
+    QString m_filePath;
+    QFile m_file;
+    QByteArrayView m_image;
+
+    // Where the SquashFS image starts within the AppImage.
+    qint64 m_offset = 0;
+    StreamDecompressor::Format m_format = StreamDecompressor::Format::Invalid;
+    quint32 m_blockSize = 0;
+    quint32 m_fragmentCount = 0;
+    quint64 m_rootInode = 0;
+    quint64 m_inodeTableStart = 0;
+    quint64 m_directoryTableStart = 0;
+    quint64 m_fragmentTableStart = 0;
+
+    QHash<quint64, MetadataBlock> m_metadataBlocks;
+};
@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "StreamDecompressor.h"
+
+#include <QDebug>
+
+#include <bzlib.h>
+#include <lzma.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+constexpr qsizetype INPUT_BUFFER_SIZE = 64 * 1024;
+}
+
+struct StreamDecompressor::Private {
+    QIODevice *device = nullptr;
+    Format format = Format::Invalid;
+    qint64 remainingInput = -1;
+
+    bool valid = false;
+    bool finished = false;
+    // zstd has no end-of-stream marker, so the stream may only end between frames.
+    bool atFrameBoundary = false;
+
+    std::array<char, INPUT_BUFFER_SIZE> input;
+    qsizetype inputOffset = 0;
+    qsizetype inputSize = 0;
+    bool inputExhausted = false;
+
+    z_stream zlib = {};
+    bz_stream bzip2 = {};
+    lzma_stream lzma = LZMA_STREAM_INIT;
+    ZSTD_DStream *zstd = nullptr;
+
+    // Refills the input buffer once everything in it has been consumed.
+    bool fillInput();
+    qint64 decompress(char *data, qint64 maxSize);
+};
+
+bool StreamDecompressor::Private::fillInput()
+{
+    if (inputOffset < inputSize) {
+        return true;
+    }
+    if (inputExhausted) {
+        return false;
+    }
+
+    qint64 toRead = INPUT_BUFFER_SIZE;
+    if (remainingInput >= 0) {
+        toRead = qMin(toRead, remainingInput);
+    }
+
+    const qint64 bytesRead = toRead > 0 ? device->read(input.data(), toRead) : 0;
+    if (bytesRead <= 0) {
+        inputExhausted = true;
+        return false;
+    }
+
+    if (remainingInput >= 0) {
+        remainingInput -= bytesRead;
+    }
+    inputOffset = 0;
+    inputSize = bytesRead;
+    return true;
+}
+
+qint64 StreamDecompressor::Private::decompress(char *data, qint64 maxSize)
+{
+    qint64 produced = 0;
+
+    while (produced < maxSize && !finished) {
+        if (!fillInput()) {
+            // Plain streams simply end, but a compressed stream that runs out of input before its end marker is truncated.
+            if (format != Format::None && !(format == Format::Zstd && atFrameBoundary)) {
+                qWarning() << "Compressed stream ended unexpectedly.";
+                return -1;
+            }
+            finished = true;
+            break;
+        }
+
+        char *out = data + produced;
+        const qint64 outSize = maxSize - produced;
+        const char *in = input.data() + inputOffset;
+        const qsizetype inSize = inputSize - inputOffset;
+        qint64 written = 0;
+        qsizetype consumed = 0;
+
+        switch (format) {
+        case Format::None: {
+            written = qMin<qint64>(outSize, inSize);
+            memcpy(out, in, written);
+            consumed = written;
+            break;
+        }
+        case Format::Gzip: {
+            zlib.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+            zlib.avail_in = uInt(inSize);
+            zlib.next_out = reinterpret_cast<Bytef *>(out);
+            zlib.avail_out = uInt(qMin<qint64>(outSize, std::numeric_limits<uInt>::max()));
+            const uInt availOut = zlib.avail_out;
+
+            const int result = inflate(&zlib, Z_NO_FLUSH);
+            if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                qWarning() << "Failed to decompress gzip stream:" << zlib.msg;
+                return -1;
+            }
+
+            written = availOut - zlib.avail_out;
+            consumed = inSize - zlib.avail_in;
+            finished = result == Z_STREAM_END;
+            break;
+        }
+        case Format::Bzip2: {
+            bzip2.next_in = const_cast<char *>(in);
+            bzip2.avail_in = uint(inSize);
+            bzip2.next_out = out;
+            bzip2.avail_out = uint(qMin<qint64>(outSize, std::numeric_limits<uint>::max()));
+            const uint availOut = bzip2.avail_out;
+
+            const int result = BZ2_bzDecompress(&bzip2);
+            if (result != BZ_OK && result != BZ_STREAM_END) {
+                qWarning() << "Failed to decompress bzip2 stream:" << result;
+                return -1;
+            }
+
+            written = availOut - bzip2.avail_out;
+            consumed = inSize - bzip2.avail_in;
+            finished = result == BZ_STREAM_END;
+            break;
+        }
+        case Format::Xz:
+        case Format::Lzma: {
+            lzma.next_in = reinterpret_cast<const uint8_t *>(in);
+            lzma.avail_in = size_t(inSize);
+            lzma.next_out = reinterpret_cast<uint8_t *>(out);
+            lzma.avail_out = size_t(outSize);
+
+            const lzma_ret result = lzma_code(&lzma, LZMA_RUN);
+            if (result != LZMA_OK && result != LZMA_STREAM_END && result != LZMA_BUF_ERROR) {
+                qWarning() << "Failed to decompress xz stream:" << result;
+                return -1;
+            }
+
+            written = outSize - qint64(lzma.avail_out);
+            consumed = inSize - qsizetype(lzma.avail_in);
+            finished = result == LZMA_STREAM_END;
+            break;
+        }
+        case Format::Zstd: {
+            ZSTD_inBuffer inBuffer = {in, size_t(inSize), 0};
+            ZSTD_outBuffer outBuffer = {out, size_t(outSize), 0};
+
+            const size_t result = ZSTD_decompressStream(zstd, &outBuffer, &inBuffer);
+            if (ZSTD_isError(result)) {
+                qWarning() << "Failed to decompress zstd stream:" << ZSTD_getErrorName(result);
+                return -1;
+            }
+
+            written = qint64(outBuffer.pos);
+            consumed = qsizetype(inBuffer.pos);
+            // zstd happily continues into a following frame, so the stream only finishes once the input runs out.
+            atFrameBoundary = result == 0;
+            break;
+        }
+        case Format::Invalid:
+            return -1;
+        }
+
+        inputOffset += consumed;
+        produced += written;
+
+        if (written == 0 && consumed == 0 && !finished) {
+            // The decoder had both input and output space but made no progress, so the data is corrupt.
+            qWarning() << "Compressed stream is corrupt.";
+            return -1;
+        }
+    }
+
+    return produced;
+}
+
+StreamDecompressor::Format StreamDecompressor::formatForName(QStringView name)
+{
+    if (name.endsWith(u"zstd") || name.endsWith(u".zst")) {
+        return Format::Zstd;
+    }
+    if (name.endsWith(u"xz")) {
+        return Format::Xz;
+    }
+    if (name.endsWith(u"lzma")) {
+        return Format::Lzma;
+    }
+    if (name.endsWith(u"gzip") || name.endsWith(u".gz")) {
+        return Format::Gzip;
+    }
+    if (name.endsWith(u"bzip2") || name.endsWith(u".bz2")) {
+        return Format::Bzip2;
+    }
+    if (name.endsWith(u".tar") || name == u"identity") {
+        return Format::None;
+    }
+    return Format::Invalid;
+}
+
+StreamDecompressor::StreamDecompressor(QIODevice *device, Format format, qint64 limit)
+    : d(std::make_unique<Private>())
+{
+    d->device = device;
+    d->format = format;
+    d->remainingInput = limit;
+
+    switch (format) {
+    case Format::None:
+        d->valid = true;
+        break;
+    case Format::Gzip:
+        // 15 window bits plus 32 enables automatic gzip/zlib header detection.
+        d->valid = inflateInit2(&d->zlib, 15 + 32) == Z_OK;
+        break;
+    case Format::Bzip2:
+        d->valid = BZ2_bzDecompressInit(&d->bzip2, 0, 0) == BZ_OK;
+        break;
+    case Format::Xz:
+        d->valid = lzma_stream_decoder(&d->lzma, UINT64_MAX, 0) == LZMA_OK;
+        break;
+    case Format::Lzma:
+        d->valid = lzma_alone_decoder(&d->lzma, UINT64_MAX) == LZMA_OK;
+        break;
+    case Format::Zstd:
+        d->zstd = ZSTD_createDStream();
+        d->valid = d->zstd && !ZSTD_isError(ZSTD_initDStream(d->zstd));
+        break;
+    case Format::Invalid:
+        break;
+    }
+
+    if (!d->valid) {
+        qWarning() << "Could not set up decompressor for format" << int(format);
+    }
+}
+
+StreamDecompressor::~StreamDecompressor()
+{
+    if (!d->valid) {
+        return;
+    }
+
+    switch (d->format) {
+    case Format::Gzip:
+        inflateEnd(&d->zlib);
+        break;
+    case Format::Bzip2:
+        BZ2_bzDecompressEnd(&d->bzip2);
+        break;
+    case Format::Xz:
+    case Format::Lzma:
+        lzma_end(&d->lzma);
+        break;
+    case Format::Zstd:
+        ZSTD_freeDStream(d->zstd);
+        break;
+    case Format::None:
+    case Format::Invalid:
+        break;
+    }
+}
+
+bool StreamDecompressor::isValid() const
+{
+    return d->valid;
+}
+
+qint64 StreamDecompressor::read(char *data, qint64 maxSize)
+{
+    if (!d->valid) {
+        return -1;
+    }
+    return d->decompress(data, maxSize);
+}
+
+bool StreamDecompressor::readExactly(char *data, qint64 size)
+{
+    while (size > 0) {
+        const qint64 bytesRead = read(data, size);
+        if (bytesRead <= 0) {
+            return false;
+        }
+        data += bytesRead;
+        size -= bytesRead;
+    }
+    return true;
+}
+
+bool StreamDecompressor::skip(qint64 size)
+{
+    std::array<char, INPUT_BUFFER_SIZE> scratch;
+    while (size > 0) {
+        const qint64 bytesRead = read(scratch.data(), qMin<qint64>(size, scratch.size()));
+        if (bytesRead <= 0) {
+            return false;
+        }
+        size -= bytesRead;
+    }
+    return true;
+}
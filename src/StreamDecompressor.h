@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QIODevice>
+#include <QStringView>
+
+#include <memory>
+
+// Incrementally decompresses data read from a QIODevice, so archives can be walked without
+// spawning external tools or holding the whole decompressed stream in memory.
+class StreamDecompressor
+{
+public:
+    enum class Format {
+        Invalid,
+        None,
+        Gzip,
+        Bzip2,
+        Xz,
+        Lzma,
+        Zstd,
+    };
+
+    // Maps a compressor name (e.g. RPM's "zstd") or a file name suffix (e.g. "data.tar.zst") to a format.
+    // Returns Format::Invalid for anything that isn't supported.
+    static Format formatForName(QStringView name);
+
+    // The device must already be open and positioned at the start of the compressed data.
+    // At most `limit` bytes are read from it, or everything up to the end if `limit` is negative.
+    StreamDecompressor(QIODevice *device, Format format, qint64 limit = -1);
+    ~StreamDecompressor();
+
+    StreamDecompressor(const StreamDecompressor &) = delete;
+    StreamDecompressor &operator=(const StreamDecompressor &) = delete;
+
+    // Whether the decompressor was set up successfully.
+    bool isValid() const;
+
+    // Reads up to `maxSize` decompressed bytes.
+    // Returns the number of bytes read, 0 at the end of the stream, or -1 on error.
+    qint64 read(char *data, qint64 maxSize);
+
+    // Reads exactly `size` bytes, returning false if the stream ended early or is corrupt.
+    bool readExactly(char *data, qint64 size);
+
+    // Discards `size` bytes of decompressed data, returning false if the stream ended early or is corrupt.
+    bool skip(qint64 size);
+
+private:
+    struct Private;
+    std::unique_ptr<Private> d;
+};
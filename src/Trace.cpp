@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QSaveFile>
+
+using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+struct Event {
+    const char *name;
+    QString detail;
+    qint64 start;
+    qint64 duration;
+    int thread;
+};
+
+struct Recorder {
+    QMutex mutex;
+    QString filePath;
+    QElapsedTimer clock;
+    QList<Event> events;
+};
+
+Recorder &recorder()
+{
+    static Recorder instance;
+    return instance;
+}
+
+// Numbers threads in the order they first record something, which reads better in trace viewers than thread handles.
+int currentThreadNumber()
+{
+    static std::atomic_int nextNumber = 1;
+    thread_local const int number = nextNumber++;
+    return number;
+}
+}
+
+namespace Trace
+{
+namespace Private
+{
+std::atomic_bool enabled = false;
+
+qint64 now()
+{
+    return recorder().clock.nsecsElapsed() / 1000;
+}
+
+void record(const char *name, const QString &detail, qint64 start)
+{
+    const qint64 end = now();
+    const int thread = currentThreadNumber();
+
+    Recorder &state = recorder();
+    QMutexLocker locker(&state.mutex);
+    if (isEnabled()) {
+        state.events.append({name, detail, start, end - start, thread});
+    }
+}
+}
+
+void start(const QString &filePath)
+{
+    Recorder &state = recorder();
+    {
+        QMutexLocker locker(&state.mutex);
+        state.filePath = filePath;
+        state.events.clear();
+        state.clock.start();
+    }
+
+    // The thread that starts tracing is numbered first, so finish() can label it as the main thread.
+    currentThreadNumber();
+    Private::enabled.store(true, std::memory_order_release);
+}
+
+void startFromArguments(int argc, char *argv[])
+{
+    QString filePath = qEnvironmentVariable("APPCOMPATIBILITYHELPER_TRACE");
+    for (int i = 1; i < argc; ++i) {
+        if (qstrncmp(argv[i], "--trace=", 8) == 0) {
+            filePath = QFile::decodeName(argv[i] + 8);
+        } else if (qstrcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            filePath = QFile::decodeName(argv[++i]);
+        }
+    }
+
+    if (!filePath.isEmpty()) {
+        start(filePath);
+    }
+}
+
+bool finish()
+{
+    if (!isEnabled()) {
+        return true;
+    }
+
+    Recorder &state = recorder();
+    QMutexLocker locker(&state.mutex);
+    Private::enabled.store(false, std::memory_order_release);
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    events.append(QJsonObject{
+        {u"name"_s, u"thread_name"_s},
+        {u"ph"_s, u"M"_s},
+        {u"pid"_s, pid},
+        {u"tid"_s, 1},
+        {u"args"_s, QJsonObject{{u"name"_s, u"main"_s}}},
+    });
+
+    for (const Event &event : std::as_const(state.events)) {
+        QJsonObject object{
+            {u"name"_s, QString::fromLatin1(event.name)},
+            {u"cat"_s, u"appcompatibilityhelper"_s},
+            {u"ph"_s, u"X"_s},
+            {u"ts"_s, event.start},
+            {u"dur"_s, event.duration},
+            {u"pid"_s, pid},
+            {u"tid"_s, event.thread},
+        };
+        if (!event.detail.isEmpty()) {
+            object.insert(u"args"_s, QJsonObject{{u"detail"_s, event.detail}});
+        }
+        events.append(object);
+    }
+    state.events.clear();
+
+    const QJsonObject trace{
+        {u"traceEvents"_s, events},
+        {u"displayTimeUnit"_s, u"ms"_s},
+    };
+
+    QSaveFile file(state.filePath);
+    const QByteArray json = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        qWarning() << "Could not write trace:" << state.filePath << file.errorString();
+        return false;
+    }
+    return true;
+}
+}
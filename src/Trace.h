@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+
+// Timing spans for finding out where the time goes between opening a file and the window showing its result.
+//
+// Tracing is off unless APPCOMPATIBILITYHELPER_TRACE or --trace=<file> names a file to write to. Spans are then kept
+// in memory and written by finish() as Chrome trace-event JSON, which chrome://tracing and https://ui.perfetto.dev open.
+// While tracing is off, a span costs an atomic load when it starts and a comparison when it ends.
+namespace Trace
+{
+namespace Private
+{
+extern std::atomic_bool enabled;
+
+// Microseconds since tracing started.
+qint64 now();
+
+void record(const char *name, const QString &detail, qint64 start);
+}
+
+inline bool isEnabled()
+{
+    return Private::enabled.load(std::memory_order_acquire);
+}
+
+// Starts recording spans, to be written to `filePath` by finish().
+void start(const QString &filePath);
+
+// Starts recording spans if APPCOMPATIBILITYHELPER_TRACE or a --trace=<file> or --trace <file> argument names a file,
+// the argument winning.
+void startFromArguments(int argc, char *argv[]);
+
+// Stops recording and writes the spans recorded so far. Returns false if they couldn't be written.
+bool finish();
+
+// Records the time from its construction to its destruction, e.g. `const Trace::Span span("AppStreamIndex::system");`.
+// `name` must outlive the trace, which string literals do.
+class Span
+{
+public:
+    explicit Span(const char *name)
+        : m_name(name)
+    {
+        if (isEnabled()) {
+            m_start = Private::now();
+        }
+    }
+
+    // `detail` is shown alongside the span, e.g. the file being analysed.
+    Span(const char *name, const QString &detail)
+        : Span(name)
+    {
+        if (m_start >= 0) {
+            m_detail = detail;
+        }
+    }
+
+    ~Span()
+    {
+        if (m_start >= 0) {
+            Private::record(m_name, m_detail, m_start);
+        }
+    }
+
+    Q_DISABLE_COPY_MOVE(Span)
+
+private:
+    const char *m_name;
+    QString m_detail;
+    qint64 m_start = -1;
+};
+}
@@ -2,6 +2,11 @@
 // SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
 
 #include "WindowsCompatibilityHelper.h"
+#include "AppDatabase.h"
+#include "CompatibilityHelperFactory.h"
+#include "MsiPropertyReader.h"
+#include "PeVersionReader.h"
+#include "ShellLinkReader.h"
 
 #include <KIO/ApplicationLauncherJob>
 #include <KIO/CommandLauncherJob>
@@ -12,84 +17,142 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
 #include <QIcon>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QRegularExpression>
 #include <QStandardPaths>
 
-WindowsCompatibilityHelper::WindowsCompatibilityHelper(const QUrl &databaseFilePath, const QUrl &openedExePath, QObject *parent)
+namespace
+{
+// The names an installer gives itself, whatever the file is called.
+struct InstallerNames {
+    QString productName;
+    QString companyName;
+    QString originalFilename;
+};
+
+// Reads the version resource of an executable, or the Property table of an MSI package.
+std::optional<InstallerNames> readInstallerNames(const QString &filePath)
+{
+    PeVersionReader versionResource(filePath);
+    if (versionResource.read()) {
+        return InstallerNames{versionResource.productName(), versionResource.companyName(), versionResource.originalFilename()};
+    }
+
+    MsiPropertyReader properties(filePath);
+    if (properties.read()) {
+        return InstallerNames{properties.productName(), properties.manufacturer(), QString()};
+    }
+
+    return std::nullopt;
+}
+
+// Renamed installers, e.g. "setup(3).exe" or "download.msi", can still be identified by the names they give themselves.
+std::optional<AppDatabase::Entry> matchInstallerNames(const AppDatabase &database, const QString &filePath)
+{
+    const std::optional<InstallerNames> names = readInstallerNames(filePath);
+    if (!names) {
+        return std::nullopt;
+    }
+
+    if (!names->originalFilename.isEmpty()) {
+        if (std::optional<AppDatabase::Entry> entry = database.matchWindowsFileName(names->originalFilename)) {
+            return entry;
+        }
+    }
+
+    if (names->productName.isEmpty()) {
+        return std::nullopt;
+    }
+    if (std::optional<AppDatabase::Entry> entry = database.findByName(names->productName)) {
+        return entry;
+    }
+
+    // Product names often leave out the company, e.g. "Firefox" by "Mozilla Corporation" is "Mozilla Firefox" in the database.
+    const QString company = names->companyName.section(u' ', 0, 0);
+    if (company.isEmpty()) {
+        return std::nullopt;
+    }
+    return database.findByName(company + u' ' + names->productName);
+}
+}
+
+WindowsCompatibilityHelper::WindowsCompatibilityHelper(const QStringList &databaseLayers, const QUrl &openedExePath, QObject *parent)
     : ICompatibilityHelper(openedExePath, parent)
 {
     m_nativeAppName = m_filePath.fileName();
-    m_hasNativeApp = false;
-    m_needsAlternativeApp = false;
-
-    QFile databaseFile(databaseFilePath.toLocalFile());
+    m_databaseLayers = databaseLayers;
+}
 
-    if (!databaseFile.open(QIODevice::ReadOnly | QIODevice::Text) || !databaseFile.exists()) {
-        qWarning() << "Failed to open database file:" << databaseFilePath.toLocalFile();
+void WindowsCompatibilityHelper::analyze()
+{
+    const std::shared_ptr<const AppDatabase> database = AppDatabase::shared(m_databaseLayers);
+    if (!database) {
         qWarning() << "The application database is required for matching Windows applications to their native alternatives.";
         return;
     }
 
-    QByteArray databaseData = databaseFile.readAll();
-    databaseFile.close();
+    const QString fileName = m_filePath.fileName();
+    QString exeFileName = fileName;
 
-    QJsonDocument doc = QJsonDocument::fromJson(databaseData);
-    QJsonArray appDb = doc.array();
-    const QString exeFileName = m_filePath.fileName();
-
-    // Search for matching application in database
-    for (const QJsonValue &value : appDb) {
-        QJsonObject appEntry = value.toObject();
+    // A shortcut is named whatever its creator liked, so match on the executable it launches first.
+    ShellLinkReader shortcut(m_filePath.toLocalFile());
+    const bool isShortcut = shortcut.read();
+    if (isShortcut && !shortcut.targetFileName().isEmpty()) {
+        exeFileName = shortcut.targetFileName();
+    }
 
-        // Ignore any entry without a Flatpak reference
-        if (!appEntry.contains(u"flatpak"_s) || !appEntry[u"flatpak"_s].isObject()) {
-            continue;
+    std::optional<AppDatabase::Entry> entry = database->matchWindowsFileName(exeFileName);
+    if (isShortcut) {
+        // Then the shortcut's own file name, and the names the application goes by, e.g. "Discord" for "Discord.exe".
+        if (!entry && exeFileName != fileName) {
+            entry = database->matchWindowsFileName(fileName);
         }
-
-        if (!appEntry.contains(u"regex"_s) || !appEntry[u"regex"_s].isObject()) {
-            continue;
+        if (!entry && !shortcut.targetFileName().isEmpty()) {
+            entry = database->findByName(QFileInfo(shortcut.targetFileName()).completeBaseName());
         }
-
-        QJsonObject regexObject = appEntry[u"regex"_s].toObject();
-        if (!regexObject.contains(u"windows"_s) || !regexObject[u"windows"_s].isString()) {
-            continue;
+        if (!entry && !shortcut.name().isEmpty()) {
+            entry = database->findByName(shortcut.name());
         }
+    } else if (!entry) {
+        entry = matchInstallerNames(*database, m_filePath.toLocalFile());
+    }
+    if (!entry) {
+        return;
+    }
 
-        QString regexPattern = regexObject[u"windows"_s].toString();
-        QRegularExpression regex(regexPattern, QRegularExpression::CaseInsensitiveOption);
-        QRegularExpressionMatch match = regex.match(exeFileName);
-
-        if (match.hasMatch()) {
-            m_hasNativeApp = true;
-            m_nativeAppName = appEntry[u"name"_s].toString(exeFileName);
-
-            QJsonObject flatpakObject = appEntry[u"flatpak"_s].toObject();
-            if (flatpakObject.contains(u"id"_s) && flatpakObject[u"id"_s].isString()) {
-                m_nativeAppRef = flatpakObject[u"id"_s].toString();
-            }
-
-            if (appEntry.contains(u"alternative"_s) && appEntry[u"alternative"_s].isObject()) {
-                m_needsAlternativeApp = true;
-                QJsonObject alternativeObject = appEntry[u"alternative"_s].toObject();
-                m_alternativeAppName = alternativeObject[u"name"_s].toString(m_nativeAppName);
-            } else {
-                m_needsAlternativeApp = false;
-                m_alternativeAppName = m_nativeAppName;
-            }
-
-            if (appEntry.contains(u"desktopLauncher"_s) && appEntry[u"desktopLauncher"_s].isString()) {
-                QString desktopFile = appEntry[u"desktopLauncher"_s].toString();
-                if (desktopFile.endsWith(u".desktop"_s)) {
-                    desktopFile.chop(8);
-                }
-            }
-            break;
-        }
+    m_hasNativeApp = true;
+    m_nativeAppName = entry->name.isEmpty() ? exeFileName : entry->name;
+    m_nativeAppRef = entry->flatpakId;
+    m_needsAlternativeApp = entry->isAlternative;
+    m_alternativeAppName = entry->alternativeName.isEmpty() ? m_nativeAppName : entry->alternativeName;
+}
+
+QVariantMap WindowsCompatibilityHelper::analysisResult() const
+{
+    QVariantMap result = ICompatibilityHelper::analysisResult();
+    result.insert(u"type"_s, u"windows"_s);
+    result.insert(u"needsAlternativeApp"_s, m_needsAlternativeApp);
+    result.insert(u"alternativeAppName"_s, m_alternativeAppName);
+    return result;
+}
+
+QByteArray WindowsCompatibilityHelper::analysisInputsVersion() const
+{
+    return CompatibilityHelperFactory::appDatabaseVersion();
+}
+
+bool WindowsCompatibilityHelper::restoreAnalysisResult(const QVariantMap &result)
+{
+    if (result.value(u"type"_s).toString() != u"windows"_s) {
+        return false;
     }
+
+    m_hasNativeApp = result.value(u"hasNativeApp"_s).toBool();
+    m_nativeAppName = result.value(u"nativeAppName"_s).toString();
+    m_nativeAppRef = result.value(u"nativeAppRef"_s).toString();
+    m_needsAlternativeApp = result.value(u"needsAlternativeApp"_s).toBool();
+    m_alternativeAppName = result.value(u"alternativeAppName"_s).toString();
+    return true;
 }
 
 QString WindowsCompatibilityHelper::windowTitle() const
@@ -100,10 +163,10 @@ QString WindowsCompatibilityHelper::windowTitle() const
 QString WindowsCompatibilityHelper::heading() const
 {
     if (hasNativeApp()) {
-        if (isNativeAppInstalled()) {
+        if (installState().nativeAppInstalled) {
             return i18n("Open the native version of %1 instead", m_alternativeAppName);
         } else {
-            return i18n("Install %1 from %2 instead", m_alternativeAppName, appStoreName());
+            return i18n("Install %1 from %2 instead", m_alternativeAppName, installState().appStoreName);
         }
     } else {
         return i18n("Windows applications are not natively supported on %1", distroName());
@@ -112,7 +175,7 @@ QString WindowsCompatibilityHelper::heading() const
 
 QString WindowsCompatibilityHelper::icon() const
 {
-    if (hasNativeApp() && hasIcon(nativeAppRef())) {
+    if (hasNativeApp() && installState().nativeAppHasIcon) {
         return nativeAppRef();
     }
     return u"application-x-ms-dos-executable"_s;
@@ -123,10 +186,10 @@ QString WindowsCompatibilityHelper::description() const
     QString desc;
 
     if (hasNativeApp()) {
-        if (isNativeAppInstalled() && !m_needsAlternativeApp) {
+        if (installState().nativeAppInstalled && !m_needsAlternativeApp) {
             desc = i18n("A native %1 version of %2 is already installed on your system. ", distroName(), m_alternativeAppName);
             desc += i18n("It's recommended to use the native version for better performance and system integration.");
-        } else if (!isNativeAppInstalled() && m_needsAlternativeApp) {
+        } else if (!installState().nativeAppInstalled && m_needsAlternativeApp) {
             desc = i18n("%1, a native %2 alternative to %3, is available for installation. ", m_alternativeAppName, distroName(), nativeAppName());
             desc += i18n("Installing the native version is recommended for better performance and system integration.");
         } else {
@@ -134,12 +197,12 @@ QString WindowsCompatibilityHelper::description() const
             desc += i18n("Installing the native version is recommended for better performance and system integration.");
         }
     } else {
-        desc = i18n("You can search for alternatives online or in %1.", appStoreName());
+        desc = i18n("You can search for alternatives online or in %1.", installState().appStoreName);
     }
 
     if (hasCompatibilityTool()) {
         desc += u"<br><br>"_s;
-        if (isCompatibilityToolInstalled()) {
+        if (installState().compatibilityToolInstalled) {
             desc += i18n("Alternatively, you can run the Windows version using Bottles. ");
         } else {
             desc += i18n("Alternatively, you can install Bottles to run Windows applications. ");
@@ -159,7 +222,7 @@ bool WindowsCompatibilityHelper::isNativeAppInstalled() const
 
 QString WindowsCompatibilityHelper::nativeAppActionText() const
 {
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         return i18n("Open %1", m_alternativeAppName);
     } else {
         return i18n("Install %1", m_alternativeAppName);
@@ -168,10 +231,10 @@ QString WindowsCompatibilityHelper::nativeAppActionText() const
 
 QString WindowsCompatibilityHelper::nativeAppActionIcon() const
 {
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         return nativeAppRef();
     } else {
-        return appStoreIcon();
+        return installState().appStoreIcon;
     }
 }
 
@@ -182,7 +245,7 @@ void WindowsCompatibilityHelper::nativeAppAction() const
         return;
     }
 
-    if (isNativeAppInstalled()) {
+    if (installState().nativeAppInstalled) {
         openApp(nativeAppRef());
     } else {
         openAppInAppStore(nativeAppRef());
@@ -197,7 +260,7 @@ bool WindowsCompatibilityHelper::isCompatibilityToolInstalled() const
 QString WindowsCompatibilityHelper::compatibilityToolActionText() const
 {
     // TODO: Make this compatibility tool agnostic.
-    if (isCompatibilityToolInstalled()) {
+    if (installState().compatibilityToolInstalled) {
         return i18n("Run with Bottles");
     } else {
         return i18n("Install Bottles");
@@ -207,7 +270,7 @@ QString WindowsCompatibilityHelper::compatibilityToolActionText() const
 QString WindowsCompatibilityHelper::compatibilityToolActionIcon() const
 {
     // TODO: Make this compatibility tool agnostic.
-    if (isCompatibilityToolInstalled() && hasIcon(BOTTLES_ID)) {
+    if (installState().compatibilityToolInstalled && installState().compatibilityToolHasIcon) {
         return BOTTLES_ID;
     } else {
         return u"plasmadiscover"_s;
@@ -217,7 +280,7 @@ QString WindowsCompatibilityHelper::compatibilityToolActionIcon() const
 void WindowsCompatibilityHelper::compatibilityToolAction() const
 {
     // TODO: Make this compatibility tool agnostic.
-    if (isCompatibilityToolInstalled()) {
+    if (installState().compatibilityToolInstalled) {
         openApp(BOTTLES_ID, {m_filePath});
     } else {
         openAppInAppStore(BOTTLES_ID);
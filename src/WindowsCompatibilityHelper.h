@@ -19,7 +19,7 @@ class WindowsCompatibilityHelper : public ICompatibilityHelper
     Q_OBJECT
 
 public:
-    explicit WindowsCompatibilityHelper(const QUrl &databaseFilePath, const QUrl &openedExePath, QObject *parent = nullptr);
+    explicit WindowsCompatibilityHelper(const QStringList &databaseLayers, const QUrl &openedExePath, QObject *parent = nullptr);
     ~WindowsCompatibilityHelper() override = default;
 
     QString windowTitle() const override;
@@ -29,7 +29,7 @@ public:
     bool hasNativeApp() const override
     {
         // If it's in the database, it has a native app.
-        // The database is read in the constructor, which is where this member is set.
+        // The database is read in analyze(), which is where this member is set.
         return m_hasNativeApp;
     };
     QString nativeAppActionText() const override;
@@ -43,10 +43,18 @@ public:
     QString compatibilityToolActionText() const override;
     QString compatibilityToolActionIcon() const override;
 
+    QVariantMap analysisResult() const override;
+
     Q_INVOKABLE void nativeAppAction() const override;
     Q_INVOKABLE void compatibilityToolAction() const override;
 
+protected:
+    void analyze() override;
+    QByteArray analysisInputsVersion() const override;
+    bool restoreAnalysisResult(const QVariantMap &result) override;
+
 private:
+    QStringList m_databaseLayers;
     QString m_nativeAppName;
     QString m_alternativeAppName;
     QString m_nativeAppRef;
@@ -60,6 +68,10 @@ private:
         return m_nativeAppRef;
     }
     bool isCompatibilityToolInstalled() const override;
+    QString compatibilityToolRef() const override
+    {
+        return BOTTLES_ID;
+    }
     bool isNativeAppInstalled() const override;
 
     bool m_hasNativeApp = false;
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+// Resident analysis service, started on demand through D-Bus activation. See AnalysisService.
+
+#include "AnalysisService.h"
+#include "AppDatabase.h"
+#include "AppStreamIndex.h"
+#include "CompatibilityHelperFactory.h"
+#include "ResultCache.h"
+#include "Trace.h"
+
+#include <KLocalizedString>
+#include <QCoreApplication>
+#include <QThreadPool>
+
+int main(int argc, char *argv[])
+{
+    Trace::startFromArguments(argc, argv);
+
+    QCoreApplication app(argc, argv);
+    KLocalizedString::setApplicationDomain("appcompatibilityhelper");
+    QCoreApplication::setOrganizationName(u"Filotimo Project"_s);
+
+    AnalysisService service;
+    if (!service.registerService()) {
+        return 1;
+    }
+
+    // Load the databases straight away, so the request that started the daemon doesn't have to wait for both.
+    QThreadPool::globalInstance()->start([]() {
+        AppDatabase::shared(CompatibilityHelperFactory::appDatabaseLayers());
+    });
+    QThreadPool::globalInstance()->start([]() {
+        AppStreamIndex::system();
+    });
+
+    // The daemon can run for a whole session, so pick up database and catalogue updates without a restart.
+    AppDatabase::watch(CompatibilityHelperFactory::appDatabaseLayers());
+    AppStreamIndex::watch();
+
+    const int result = app.exec();
+
+    QThreadPool::globalInstance()->waitForDone();
+    ResultCache::instance().save();
+    Trace::finish();
+
+    return result;
+}
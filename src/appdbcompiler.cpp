@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2025 Thomas Duckworth <tduck@filotimoproject.org>
+
+// Build-time tool that validates app_db.json and compiles it into the image AppDatabase memory-maps at runtime.
+// Usage: appdbcompiler <app_db.json> <app_db.bin>
+
+#include "AppDatabase.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream err(stderr);
+
+    const QStringList arguments = app.arguments();
+    if (arguments.size() != 3) {
+        err << "Usage: appdbcompiler <app_db.json> <app_db.bin>\n";
+        return 1;
+    }
+
+    QFile input(arguments.at(1));
+    if (!input.open(QIODevice::ReadOnly)) {
+        err << "Could not open " << input.fileName() << ": " << input.errorString() << '\n';
+        return 1;
+    }
+
+    QStringList problems;
+    const QByteArray image = AppDatabase::compile(input.readAll(), problems);
+
+    // Anything that would be skipped at runtime is an error here, so mistakes are caught when the database is edited.
+    for (const QString &problem : std::as_const(problems)) {
+        err << input.fileName() << ": " << problem << '\n';
+    }
+    if (image.isEmpty() || !problems.isEmpty()) {
+        return 1;
+    }
+
+    QSaveFile output(arguments.at(2));
+    if (!output.open(QIODevice::WriteOnly) || output.write(image) != image.size() || !output.commit()) {
+        err << "Could not write " << output.fileName() << ": " << output.errorString() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -10,16 +10,16 @@ import org.filotimoproject.appcompatibilityhelper
 Kirigami.ApplicationWindow {
     id: root
 
-    title: AppCompatibilityHelper.windowTitle
+    title: AppCompatibilityHelper.ready ? AppCompatibilityHelper.windowTitle : i18nc("@title:window", "App Compatibility Support")
 
     // This is uniquely moronic, but so is QML.
     // FIXME: In some rare cases, this may clip the content.
     // This looks "good enough", but it would be better to have a proper minimum height determined. Unfortunately, I tried, but QML layouting sucks.
-    minimumHeight: pageContent.Layout.minimumHeight + Kirigami.Units.largeSpacing * 10
+    minimumHeight: (pageContent.item ? pageContent.item.Layout.minimumHeight : busyIndicator.implicitHeight) + Kirigami.Units.largeSpacing * 10
     height: minimumHeight
     maximumHeight: height
 
-    minimumWidth: Math.max(Kirigami.Units.gridUnit * 30, icon.width + actionButtons.width + Kirigami.Units.largeSpacing * 4 + Kirigami.Units.smallSpacing * 2)
+    minimumWidth: Math.max(Kirigami.Units.gridUnit * 30, pageContent.item ? pageContent.item.requiredWidth : 0)
     width: minimumWidth
     maximumWidth: width
 
@@ -33,96 +33,112 @@ Kirigami.ApplicationWindow {
     pageStack.initialPage: Kirigami.Page {
         padding: Kirigami.Units.largeSpacing
 
-        ColumnLayout {
+        QQC2.BusyIndicator {
+            id: busyIndicator
+
+            anchors.centerIn: parent
+            running: !AppCompatibilityHelper.ready
+            visible: running
+        }
+
+        Loader {
             id: pageContent
 
-            spacing: Kirigami.Units.smallSpacing
             anchors.fill: parent
+            // The helper's properties are only meaningful once it has finished analysing the file.
+            active: AppCompatibilityHelper.ready
 
-            RowLayout {
-                Layout.alignment: Qt.AlignLeft | Qt.AlignTop
-                Layout.fillWidth: true
-                Layout.margins: Kirigami.Units.largeSpacing
-
-                Kirigami.Icon {
-                    id: icon
-                    Layout.rightMargin: Kirigami.Units.largeSpacing * 2
-                    Layout.preferredWidth: Kirigami.Units.iconSizes.large * 2
-                    Layout.preferredHeight: Kirigami.Units.iconSizes.large * 2
-                    Layout.alignment: Qt.AlignCenter
-                    source: AppCompatibilityHelper.icon
-                }
+            sourceComponent: ColumnLayout {
+                // The width needed to fit the icon and all of the buttons.
+                readonly property real requiredWidth: icon.width + actionButtons.width + Kirigami.Units.largeSpacing * 4 + Kirigami.Units.smallSpacing * 2
 
-                ColumnLayout {
-                    spacing: Kirigami.Units.largeSpacing
+                spacing: Kirigami.Units.smallSpacing
+
+                RowLayout {
                     Layout.alignment: Qt.AlignLeft | Qt.AlignTop
                     Layout.fillWidth: true
+                    Layout.margins: Kirigami.Units.largeSpacing
+
+                    Kirigami.Icon {
+                        id: icon
+                        Layout.rightMargin: Kirigami.Units.largeSpacing * 2
+                        Layout.preferredWidth: Kirigami.Units.iconSizes.large * 2
+                        Layout.preferredHeight: Kirigami.Units.iconSizes.large * 2
+                        Layout.alignment: Qt.AlignCenter
+                        source: AppCompatibilityHelper.icon
+                    }
 
-                    Kirigami.Heading {
+                    ColumnLayout {
+                        spacing: Kirigami.Units.largeSpacing
                         Layout.alignment: Qt.AlignLeft | Qt.AlignTop
                         Layout.fillWidth: true
-                        wrapMode: Text.WordWrap
-                        text: AppCompatibilityHelper.heading
-                    }
 
-                    QQC2.Label {
-                        wrapMode: Text.WordWrap
-                        Layout.fillWidth: true
-                        Layout.fillHeight: true
-                        text: AppCompatibilityHelper.description
+                        Kirigami.Heading {
+                            Layout.alignment: Qt.AlignLeft | Qt.AlignTop
+                            Layout.fillWidth: true
+                            wrapMode: Text.WordWrap
+                            text: AppCompatibilityHelper.heading
+                        }
+
+                        QQC2.Label {
+                            wrapMode: Text.WordWrap
+                            Layout.fillWidth: true
+                            Layout.fillHeight: true
+                            text: AppCompatibilityHelper.description
+                        }
                     }
                 }
-            }
 
-            RowLayout {
-                id: actionButtons
-                Layout.alignment: Qt.AlignRight | Qt.AlignBottom
-                Layout.fillWidth: true
-
-                QQC2.Button {
-                    icon.name: "system-run-symbolic"
-                    text: i18n("Open With…")
-                    onClicked: {
-                        AppCompatibilityHelper.openWithAction()
-                        root.close()
+                RowLayout {
+                    id: actionButtons
+                    Layout.alignment: Qt.AlignRight | Qt.AlignBottom
+                    Layout.fillWidth: true
+
+                    QQC2.Button {
+                        icon.name: "system-run-symbolic"
+                        text: i18n("Open With…")
+                        onClicked: {
+                            AppCompatibilityHelper.openWithAction()
+                            root.close()
+                        }
                     }
-                }
 
-                QQC2.Button {
-                    id: compatibilityToolActionButton
+                    QQC2.Button {
+                        id: compatibilityToolActionButton
 
-                    highlighted: !nativeAppActionButton.visible
-                    visible: AppCompatibilityHelper.hasCompatibilityTool
+                        highlighted: !nativeAppActionButton.visible
+                        visible: AppCompatibilityHelper.hasCompatibilityTool
 
-                    icon.name: AppCompatibilityHelper.compatibilityToolActionIcon
-                    text: AppCompatibilityHelper.compatibilityToolActionText
+                        icon.name: AppCompatibilityHelper.compatibilityToolActionIcon
+                        text: AppCompatibilityHelper.compatibilityToolActionText
 
-                    onClicked: {
-                        AppCompatibilityHelper.compatibilityToolAction()
-                        root.close()
+                        onClicked: {
+                            AppCompatibilityHelper.compatibilityToolAction()
+                            root.close()
+                        }
                     }
-                }
 
-                QQC2.Button {
-                    id: nativeAppActionButton
+                    QQC2.Button {
+                        id: nativeAppActionButton
 
-                    highlighted: true
-                    visible: AppCompatibilityHelper.hasNativeApp
+                        highlighted: true
+                        visible: AppCompatibilityHelper.hasNativeApp
 
-                    icon.name: AppCompatibilityHelper.nativeAppActionIcon
-                    text: AppCompatibilityHelper.nativeAppActionText
+                        icon.name: AppCompatibilityHelper.nativeAppActionIcon
+                        text: AppCompatibilityHelper.nativeAppActionText
 
-                    onClicked: {
-                        AppCompatibilityHelper.nativeAppAction()
-                        root.close()
+                        onClicked: {
+                            AppCompatibilityHelper.nativeAppAction()
+                            root.close()
+                        }
                     }
-                }
 
-                QQC2.Button {
-                    icon.name: "dialog-cancel"
-                    text: i18n("Cancel")
-                    onClicked: {
-                        root.close()
+                    QQC2.Button {
+                        icon.name: "dialog-cancel"
+                        text: i18n("Cancel")
+                        onClicked: {
+                            root.close()
+                        }
                     }
                 }
             }
@@ -4,10 +4,12 @@
 #include <QtGlobal>
 #include <QApplication>
 
+#include <QCommandLineParser>
 #include <QIcon>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQuickStyle>
+#include <QThreadPool>
 #include <QUrl>
 
 #include "ICompatibilityHelper.h"
@@ -17,18 +19,66 @@
 #include <KLocalizedString>
 #include <qcoreapplication.h>
 
+#include "BatchAnalyzer.h"
 #include "CompatibilityHelperFactory.h"
+#include "ResultCache.h"
+#include "Trace.h"
+
+#include <algorithm>
 
 using namespace Qt::Literals::StringLiterals;
 
+// Analyses files in bulk without any GUI, for `appcompatibilityhelper --batch [--json] <dir|files...>`.
+static int runBatch(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    KLocalizedString::setApplicationDomain("appcompatibilityhelper");
+    QCoreApplication::setOrganizationName(u"Filotimo Project"_s);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(u"batch"_s, i18n("Analyse the given files and directories without showing a window.")));
+    parser.addOption(QCommandLineOption(u"json"_s, i18n("Print a JSON object for each file.")));
+    parser.addOption(QCommandLineOption(u"trace"_s, i18n("Write timing spans to <file> as Chrome trace-event JSON."), u"file"_s));
+    parser.addPositionalArgument(u"paths"_s, i18n("The files and directories to analyse."), u"<dir|files...>"_s);
+    parser.process(app);
+
+    const int result = BatchAnalyzer::run(parser.positionalArguments(), parser.isSet(u"json"_s));
+
+    // Let any background cache writes finish.
+    QThreadPool::globalInstance()->waitForDone();
+    ResultCache::instance().save();
+    Trace::finish();
+
+    return result;
+}
+
 int main(int argc, char *argv[])
 {
+    // Start tracing before anything else, so the spans cover startup too.
+    Trace::startFromArguments(argc, argv);
+
+    if (std::any_of(argv + 1, argv + argc, [](const char *arg) {
+            return qstrcmp(arg, "--batch") == 0;
+        })) {
+        return runBatch(argc, argv);
+    }
+
     QApplication app(argc, argv);
 
-    // Ensure there's actually something to run.
-    if (argc < 2) {
+    // Ensure there's actually something to run. The file is the first argument that isn't --trace or its value.
+    const char *fileArgument = nullptr;
+    for (int i = 1; i < argc && !fileArgument; ++i) {
+        if (qstrcmp(argv[i], "--trace") == 0) {
+            ++i;
+        } else if (qstrncmp(argv[i], "--trace=", 8) != 0) {
+            fileArgument = argv[i];
+        }
+    }
+    if (!fileArgument) {
         qWarning() << "No executable file provided.";
-        qWarning() << "Usage: appcompatibilityhelper <path to file>";
+        qWarning() << "Usage: appcompatibilityhelper [--trace=<file>] <path to file>";
+        qWarning() << "       appcompatibilityhelper --batch [--json] [--trace=<file>] <dir|files...>";
         return -1;
     }
 
@@ -64,7 +114,7 @@ int main(int argc, char *argv[])
     QQmlApplicationEngine engine;
 
     // Register the correct compatibility helper as a QML singleton.
-    QUrl filePath = QUrl::fromLocalFile(QString::fromLatin1(argv[1]));
+    QUrl filePath = QUrl::fromLocalFile(QString::fromLatin1(fileArgument));
     qmlRegisterSingletonType<ICompatibilityHelper>("org.filotimoproject.appcompatibilityhelper",
                                                    1,
                                                    0,
@@ -78,16 +128,30 @@ int main(int argc, char *argv[])
                                                            qWarning() << "No compatible helper found for the provided file type.";
                                                            qWarning() << "The application will now exit.";
                                                            QCoreApplication::exit(-1);
+                                                           return nullptr;
                                                        }
+
+                                                       // Analyse the file in the background, so the window shows up straight away.
+                                                       helper->startAnalysis();
                                                        return helper;
                                                    });
 
     engine.rootContext()->setContextObject(new KLocalizedContext(&engine));
-    engine.loadFromModule("org.filotimoproject.appcompatibilityhelper", u"Main");
+    {
+        const Trace::Span span("QQmlApplicationEngine::loadFromModule");
+        engine.loadFromModule("org.filotimoproject.appcompatibilityhelper", u"Main");
+    }
 
     if (engine.rootObjects().isEmpty()) {
         return -1;
     }
 
-    return app.exec();
+    const int result = app.exec();
+
+    // Let any analysis still running finish before the helper is destroyed, along with any background cache writes.
+    QThreadPool::globalInstance()->waitForDone();
+    ResultCache::instance().save();
+    Trace::finish();
+
+    return result;
 }